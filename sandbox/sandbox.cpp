@@ -2,6 +2,10 @@
 #include "SDL.h"
 #include "SDL_vulkan.h"
 #include <SDL_video.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <memory>
 
 // If you have selected SDL2 component when installed Vulkan SDK
 // The following codes will work
@@ -12,7 +16,45 @@
 constexpr uint32_t WindowWidth = 1024;
 constexpr uint32_t WindowHeight = 720;
 
+// binary PPM, enough for diffing a frame against a reference image
+void WritePPM(const std::string& filename, const toy2d::ReadbackResult& result) {
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        SDL_Log("open %s failed", filename.c_str());
+        return;
+    }
+    bool bgra = result.format == vk::Format::eB8G8R8A8Unorm || result.format == vk::Format::eB8G8R8A8Srgb;
+    fprintf(file, "P6\n%u %u\n255\n", result.width, result.height);
+    for (uint32_t y = 0; y < result.height; y++) {
+        const uint8_t* row = result.Data() + y * result.RowPitch();
+        for (uint32_t x = 0; x < result.width; x++) {
+            const uint8_t* p = row + x * 4;
+            uint8_t rgb[3] = {bgra ? p[2] : p[0], p[1], bgra ? p[0] : p[2]};
+            fwrite(rgb, 1, 3, file);
+        }
+    }
+    fclose(file);
+}
+
 int main(int argc, char** argv) {
+    // --frames N quits after N frames and prints frame statistics,
+    // --capture FILE writes the last frame to FILE,
+    // --damage redraws only the animated parts
+    uint64_t maxFrames = 0;
+    std::string captureFile;
+    bool damage = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--damage") == 0) {
+            damage = true;
+        } else if (i + 1 == argc) {
+            break;
+        } else if (strcmp(argv[i], "--frames") == 0) {
+            maxFrames = std::stoull(argv[++i]);
+        } else if (strcmp(argv[i], "--capture") == 0) {
+            captureFile = argv[++i];
+        }
+    }
+
     SDL_Init(SDL_INIT_EVERYTHING);
 
     SDL_Window* window = SDL_CreateWindow("sandbox",
@@ -45,12 +87,53 @@ int main(int argc, char** argv) {
     toy2d::Texture* texture1 = toy2d::LoadTexture("resources/role.png");
     toy2d::Texture* texture2 = toy2d::LoadTexture("resources/texture.jpg");
 
+    auto fountain = std::make_unique<toy2d::ParticleSystem>(20000);
+    fountain->emitter.position = toy2d::Vec{850, 700};
+    fountain->emitter.area = toy2d::Vec{20, 0};
+    fountain->emitter.rate = 4000;
+    fountain->emitter.lifetime = 2;
+    fountain->emitter.lifetimeVariance = 0.5;
+    fountain->emitter.velocity = toy2d::Vec{0, -500};
+    fountain->emitter.spread = 0.4;
+    fountain->emitter.speedVariance = 0.2;
+    fountain->emitter.gravity = toy2d::Vec{0, 400};
+    fountain->emitter.startSize = 6;
+    fountain->emitter.endSize = 2;
+    fountain->emitter.startColor = toy2d::Color{0.4, 0.7, 1};
+    fountain->emitter.endColor = toy2d::Color{0.1, 0.2, 1};
+    uint32_t lastTicks = SDL_GetTicks();
+
+    auto font = std::make_unique<toy2d::Font>("resources/DejaVuSansMono.ttf");
+
+    // drawn once and reused until it is marked dirty
+    auto panel = std::make_unique<toy2d::RenderTarget>(200, 120);
+    panel->SetClearColor(toy2d::Color{0.2, 0.2, 0.3}, 1);
+
+    // a world of small sprites much larger than the window, only the visible ones are drawn
+    toy2d::SpriteScene scene(128);
+    for (uint32_t i = 0; i < 20000; i++) {
+        float px = static_cast<float>((i * 7919) % 8192) - 3584;
+        float py = static_cast<float>((i * 104729) % 5760) - 2520;
+        scene.Add(*texture2, toy2d::Rect{toy2d::Vec{px, py}, toy2d::Size{16, 16}}, 0, toy2d::Color{0.3, 0.3, 0.3});
+    }
+
+    // starts on the window center, so the scene looks as without a camera. The wheel zooms
+    toy2d::Camera camera;
+    camera.SetPosition(toy2d::Vec{WindowWidth * 0.5f, WindowHeight * 0.5f});
+    renderer->SetCamera(&camera);
+    renderer->SetDamageTracking(damage);
+    float lastX = x, lastY = y;
+
+    uint64_t frameCount = 0;
+    double cpuMsTotal = 0;
+
     while (!shouldClose) {
         while (SDL_PollEvent(&event)) {
             if (event.type == SDL_QUIT) {
                 shouldClose = true;
             }
             if (event.type == SDL_KEYDOWN) {
+                renderer->MarkInput();
                 if (event.key.keysym.sym == SDLK_a) {
                     x -= 10;
                 }
@@ -64,6 +147,9 @@ int main(int argc, char** argv) {
                     y += 10;
                 }
             }
+            if (event.type == SDL_MOUSEWHEEL && event.wheel.y != 0) {
+                camera.Zoom(event.wheel.y > 0 ? 1.1f : 1 / 1.1f);
+            }
             if (event.type == SDL_WINDOWEVENT) {
                 if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
 					toy2d::ResizeSwapchainImage(event.window.data1, event.window.data2);
@@ -71,16 +157,89 @@ int main(int argc, char** argv) {
             }
         }
 
-		renderer->StartRender();
+        // minimized, StartRender already slept
+        if (!renderer->StartRender()) {
+            continue;
+        }
+        if (damage) {
+            // the turning sprite, the fountain and where the role was and is
+            renderer->AddDamage(toy2d::Rect{toy2d::Vec{850, 150}, toy2d::Size{190, 190}});
+            renderer->AddDamage(toy2d::Rect{toy2d::Vec{850, 540}, toy2d::Size{1000, 360}});
+            renderer->AddDamage(toy2d::Rect{toy2d::Vec{lastX, lastY}, toy2d::Size{200, 300}});
+            renderer->AddDamage(toy2d::Rect{toy2d::Vec{x, y}, toy2d::Size{200, 300}});
+            lastX = x;
+            lastY = y;
+        }
+        if (panel->IsDirty()) {
+            renderer->BeginTarget(*panel);
+            renderer->SetDrawColor(toy2d::Color{1, 0.5, 0});
+            renderer->FillCircle(toy2d::Vec{60, 60}, 40);
+            renderer->SetDrawColor(toy2d::Color{0, 0.8, 0.4});
+            renderer->FillRect(toy2d::Rect{toy2d::Vec{150, 60}, toy2d::Size{60, 80}});
+            renderer->EndTarget();
+        }
+        renderer->SetDrawColor(toy2d::Color{1, 1, 1});
+        renderer->DrawSpriteScene(scene);
         renderer->SetDrawColor(toy2d::Color{1, 0, 0});
 		renderer->DrawTexture(toy2d::Rect{toy2d::Vec{x, y}, toy2d::Size{200, 300}}, *texture1);
         renderer->SetDrawColor(toy2d::Color{0, 1, 0});
 		renderer->DrawTexture(toy2d::Rect{toy2d::Vec{500, 100}, toy2d::Size{200, 300}}, *texture2);
+        // the left half of the texture, mirrored and turning
+        float halfWidth = texture1->width * 0.5f;
+        renderer->DrawTextureEx(*texture1,
+                                toy2d::Rect{toy2d::Vec{halfWidth * 0.5f, texture1->height * 0.5f},
+                                            toy2d::Size{halfWidth, static_cast<float>(texture1->height)}},
+                                toy2d::Rect{toy2d::Vec{850, 150}, toy2d::Size{100, 150}},
+                                SDL_GetTicks() / 1000.0f, toy2d::Vec{0, 0}, toy2d::Flip::Horizontal);
         renderer->SetDrawColor(toy2d::Color{0, 0, 1});
 		renderer->DrawLine(toy2d::Vec{0, 0}, toy2d::Vec{WindowWidth, WindowHeight});
+        renderer->SetDrawColor(toy2d::Color{1, 1, 0});
+        renderer->FillCircle(toy2d::Vec{850, 550}, 60);
+        renderer->FillPolygon({{100, 500}, {300, 500}, {300, 650}, {200, 580}, {100, 650}});
+        renderer->SetDrawColor(toy2d::Color{1, 1, 1});
+        renderer->DrawTexture(toy2d::Rect{toy2d::Vec{150, 80}, toy2d::Size{200, 120}}, panel->GetTexture());
+        renderer->DrawRect(toy2d::Rect{toy2d::Vec{850, 550}, toy2d::Size{140, 140}}, 2);
+        renderer->SetLineWidth(6);
+        renderer->SetLineCap(toy2d::LineCap::Round);
+        renderer->DrawPolyline({{400, 650}, {480, 560}, {560, 640}, {640, 580}});
+        renderer->SetLineWidth(0);
+        renderer->SetDrawColor(toy2d::Color{1, 1, 1});
+        renderer->DrawString(*font, "WASD moves the role, the wheel zooms", toy2d::Vec{20, 20}, 20);
+
+        uint32_t ticks = SDL_GetTicks();
+        fountain->Update((ticks - lastTicks) / 1000.0f);
+        lastTicks = ticks;
+        renderer->DrawParticles(*fountain);
+
+        frameCount ++;
+        bool lastFrame = maxFrames != 0 && frameCount >= maxFrames;
+        if (lastFrame && !captureFile.empty()) {
+            renderer->RequestReadback([&](const toy2d::ReadbackResult& result) {
+                WritePPM(captureFile, result);
+            });
+        }
 		renderer->EndRender();
+
+        cpuMsTotal += renderer->GetFrameStats().cpuMs;
+        if (lastFrame) {
+            shouldClose = true;
+        }
+    }
+
+    if (maxFrames != 0) {
+        SDL_Log("frames: %llu, average cpu ms: %.3f, draw calls: %u",
+                static_cast<unsigned long long>(frameCount),
+                frameCount ? cpuMsTotal / frameCount : 0.0,
+                renderer->GetFrameStats().drawCalls);
+        SDL_Log("scene sprites drawn: %u, culled: %u",
+                scene.GetStats().drawn, scene.GetStats().culled);
+        SDL_Log("redrawn pixels in the last frame: %u", renderer->GetFrameStats().redrawnPixels);
     }
 
+    renderer->SetCamera(nullptr);
+    fountain.reset();
+    panel.reset();
+    font.reset();
     toy2d::DestroyTexture(texture1);
     toy2d::DestroyTexture(texture2);
 
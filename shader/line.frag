@@ -0,0 +1,61 @@
+#version 450
+
+layout(location = 0) out vec4 outColor;
+
+layout(location = 0) in vec2 Local;
+layout(location = 1) in flat float Length;
+layout(location = 2) in flat float HalfWidth;
+layout(location = 3) in flat vec2 Caps;
+layout(location = 4) in flat vec4 Color;
+layout(location = 5) in flat vec4 JoinStart;
+layout(location = 6) in flat vec4 JoinEnd;
+layout(location = 7) in flat vec2 Bevel;
+
+const float JoinCap = 3.0;
+const float BevelJoin = 4.0;
+const float RoundJoin = 5.0;
+
+layout(push_constant) uniform PushConstant {
+    layout(offset = 32) vec3 color;
+} pc;
+
+void main() {
+    vec2 fromStart = Local;
+    vec2 fromEnd = Local - vec2(Length, 0.0);
+    // the neighbour draws the other side of a join
+    if ((Caps.x > JoinCap - 0.5 && dot(fromStart, JoinStart.xy) <= 0.0) ||
+        (Caps.y > JoinCap - 0.5 && dot(fromEnd, JoinEnd.xy) > 0.0)) {
+        discard;
+    }
+
+    float y = abs(Local.y);
+
+    // signed distance to the outline in pixels, negative inside
+    float dist = y - HalfWidth;
+    if (Local.x < 0.0 || Local.x > Length) {
+        float cap = Local.x < 0.0 ? Caps.x : Caps.y;
+        float x = Local.x < 0.0 ? -Local.x : Local.x - Length;
+        if (abs(cap - 2.0) < 0.5 || abs(cap - RoundJoin) < 0.5) {
+            dist = length(vec2(x, y)) - HalfWidth;
+        } else if (cap > JoinCap - 0.5) {
+            // miters and bevels continue the sides up to the join plane
+        } else if (cap > 0.5) {
+            dist = max(x, y) - HalfWidth;
+        } else {
+            dist = max(x, dist);
+        }
+    }
+    if (abs(Caps.x - BevelJoin) < 0.5) {
+        dist = max(dist, dot(fromStart, JoinStart.zw) - Bevel.x);
+    }
+    if (abs(Caps.y - BevelJoin) < 0.5) {
+        dist = max(dist, dot(fromEnd, JoinEnd.zw) - Bevel.y);
+    }
+
+    float coverage = clamp(0.5 - dist, 0.0, 1.0) * Color.a;
+    if (coverage <= 0.0) {
+        discard;
+    }
+    // premultiplied, as the blend state expects
+    outColor = vec4(pc.color * Color.rgb * coverage, coverage);
+}
@@ -0,0 +1,132 @@
+#version 450
+
+// one instance per segment, expanded into a screen aligned quad drawn as a 4 vertex strip
+layout(location = 0) in vec2 inP0;
+layout(location = 1) in vec2 inP1;
+layout(location = 2) in vec3 inColor;
+layout(location = 3) in float inWidth;
+layout(location = 4) in vec2 inCaps; // at p0 and p1: 0 butt, 1 square, 2 round, 3 + LineJoin joins
+layout(location = 5) in vec2 inPrev; // start of the previous segment if p0 is a join
+layout(location = 6) in vec2 inNext; // end of the next segment if p1 is a join
+
+layout(location = 0) out vec2 outLocal; // pixels from p0, x along the segment and y across it
+layout(location = 1) out flat float outLength;
+layout(location = 2) out flat float outHalfWidth;
+layout(location = 3) out flat vec2 outCaps;
+layout(location = 4) out flat vec4 outColor;
+// per join at p0 and p1: normal of the plane splitting it with the neighbour in xy,
+// direction away from the corner in zw, in the local frame
+layout(location = 5) out flat vec4 outJoinStart;
+layout(location = 6) out flat vec4 outJoinEnd;
+layout(location = 7) out flat vec2 outBevel; // distance of the bevel edges from p0 and p1
+
+layout(set = 0, binding = 0) uniform UniformBuffer {
+    mat4 project;
+    mat4 view;
+} ubo;
+
+layout(push_constant) uniform PushConstant {
+    mat3x2 model;
+    vec2 viewport;
+} pc;
+
+// room for the anti-aliased edge
+const float Fringe = 1.0;
+
+const float JoinCap = 3.0;
+const float MiterJoin = 3.0;
+const float BevelJoin = 4.0;
+const float RoundJoin = 5.0;
+// longest miter tip in half widths, longer ones are beveled
+const float MiterLimit = 4.0;
+
+vec2 toScreen(vec2 p) {
+    vec2 position = pc.model * vec3(p, 1.0);
+    vec4 clip = ubo.project * ubo.view * vec4(position, 0.0, 1.0);
+    return (clip.xy / clip.w * 0.5 + 0.5) * pc.viewport;
+}
+
+vec2 direction(vec2 from, vec2 to) {
+    vec2 delta = to - from;
+    float len = length(delta);
+    return len > 0.0 ? delta / len : vec2(0.0);
+}
+
+// `dirIn` arrives at the corner and `dirOut` leaves it. Both segments split the join
+// at the plane through the corner with normal dirIn + dirOut, where their outlines
+// meet with the same distance, so every pixel is drawn once and the edge is seamless
+vec4 joinFrame(vec2 dirIn, vec2 dirOut, vec2 dir, vec2 normal, inout float cap, out float bevel) {
+    bevel = 0.0;
+    if (cap < JoinCap - 0.5) {
+        return vec4(0.0);
+    }
+    if (dirIn == vec2(0.0) || dirOut == vec2(0.0)) {
+        cap = 2.0; // a degenerate neighbour gets a round cap
+        return vec4(0.0);
+    }
+    vec2 plane = dirIn + dirOut;
+    plane = dot(plane, plane) > 1e-8 ? normalize(plane) : dirIn;
+    vec2 outward = dirIn - dirOut;
+    if (dot(outward, outward) > 1e-8) {
+        outward = normalize(outward);
+        // cosine of half the turn, the miter tip is 1 / cosine half widths from the corner
+        float cosine = abs(dot(vec2(-dirIn.y, dirIn.x), outward));
+        if (abs(cap - MiterJoin) < 0.5 && cosine * MiterLimit < 1.0) {
+            cap = BevelJoin;
+        }
+        bevel = cosine;
+    } else {
+        outward = vec2(0.0); // straight, nothing to cut
+        bevel = 1.0;
+    }
+    return vec4(dot(plane, dir), dot(plane, normal), dot(outward, dir), dot(outward, normal));
+}
+
+float extension(float cap, float halfWidth) {
+    if (abs(cap - MiterJoin) < 0.5) {
+        return halfWidth * MiterLimit;
+    }
+    return cap > 0.5 ? halfWidth : 0.0;
+}
+
+void main() {
+    vec2 a = toScreen(inP0);
+    vec2 b = toScreen(inP1);
+    vec2 delta = b - a;
+    float len = length(delta);
+    vec2 dir = len > 0.0 ? delta / len : vec2(1.0, 0.0);
+    vec2 normal = vec2(-dir.y, dir.x);
+
+    // thinner than a pixel: draw a pixel wide line with less coverage
+    float halfWidth = max(inWidth, 1.0) * 0.5;
+    float alpha = clamp(inWidth, 0.0, 1.0);
+
+    vec2 caps = inCaps;
+    vec2 bevel;
+    if (len > 0.0) {
+        // the neighbours compute the shared direction the same way, so they agree on the plane
+        outJoinStart = joinFrame(direction(toScreen(inPrev), a), dir, dir, normal, caps.x, bevel.x);
+        outJoinEnd = joinFrame(dir, direction(b, toScreen(inNext)), dir, normal, caps.y, bevel.y);
+    } else {
+        // a dot, the neighbours see a degenerate segment as well
+        caps = vec2(min(caps.x, 2.0), min(caps.y, 2.0));
+        outJoinStart = vec4(0.0);
+        outJoinEnd = vec4(0.0);
+        bevel = vec2(0.0);
+    }
+
+    bool end = (gl_VertexIndex & 1) == 1;
+    float side = gl_VertexIndex < 2 ? -1.0 : 1.0;
+    float extend = extension(end ? caps.y : caps.x, halfWidth) + Fringe;
+
+    vec2 local = vec2(end ? len + extend : -extend, side * (halfWidth + Fringe));
+    vec2 screen = a + dir * local.x + normal * local.y;
+
+    outLocal = local;
+    outLength = len;
+    outHalfWidth = halfWidth;
+    outCaps = caps;
+    outBevel = bevel * halfWidth;
+    outColor = vec4(inColor, alpha);
+    gl_Position = vec4(screen / pc.viewport * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,16 @@
+#version 450
+
+layout(location = 0) out vec4 outColor;
+layout(location = 0) in vec2 Texcoord;
+layout(location = 1) in vec4 Color;
+
+layout(set = 1, binding = 0) uniform sampler2D Sampler;
+
+layout(push_constant) uniform PushConstant {
+    layout(offset = 32) vec3 color;
+} pc;
+
+void main() {
+    // premultiplied like the blend state expects
+    outColor = vec4(pc.color * Color.rgb, 1.0) * Color.a * texture(Sampler, Texcoord);
+}
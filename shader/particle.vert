@@ -0,0 +1,26 @@
+#version 450
+
+// one instance per live particle, expanded into a quad drawn as a 4 vertex strip
+layout(location = 0) in vec4 inColor;
+layout(location = 1) in vec2 inPosition;
+layout(location = 2) in float inSize;
+
+layout(location = 0) out vec2 outTexcoord;
+layout(location = 1) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform UniformBuffer {
+    mat4 project;
+    mat4 view;
+} ubo;
+
+layout(push_constant) uniform PushConstant {
+    mat3x2 model;
+} pc;
+
+void main() {
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+    vec2 position = pc.model * vec3(inPosition + (corner - 0.5) * inSize, 1.0);
+    gl_Position = ubo.project * ubo.view * vec4(position, 0.0, 1.0);
+    outTexcoord = corner;
+    outColor = inColor;
+}
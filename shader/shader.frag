@@ -2,13 +2,14 @@
 
 layout(location = 0) out vec4 outColor;
 layout(location = 0) in vec2 Texcoord;
+layout(location = 1) in vec3 Color;
 
 layout(set = 1, binding = 0) uniform sampler2D Sampler;
 
 layout(push_constant) uniform PushConstant {
-    layout(offset = 64) vec3 color;
+    layout(offset = 32) vec3 color;
 } pc;
 
 void main() {
-    outColor = vec4(pc.color, 1.0) * texture(Sampler, Texcoord);
+    outColor = vec4(pc.color * Color, 1.0) * texture(Sampler, Texcoord);
 }
@@ -2,8 +2,10 @@
 
 layout(location = 0) in vec2 inPosition;
 layout(location = 1) in vec2 inTexcoord;
+layout(location = 2) in vec3 inColor;
 
 layout(location = 0) out vec2 outTexcoord;
+layout(location = 1) out vec3 outColor;
 
 layout(set = 0, binding = 0) uniform UniformBuffer {
     mat4 project;
@@ -11,10 +13,12 @@ layout(set = 0, binding = 0) uniform UniformBuffer {
 } ubo;
 
 layout(push_constant) uniform PushConstant {
-    mat4 model;
+    mat3x2 model;
 } pc;
 
 void main() {
-    gl_Position = ubo.project * ubo.view * pc.model * vec4(inPosition, 0.0, 1.0);
+    vec2 position = pc.model * vec3(inPosition, 1.0);
+    gl_Position = ubo.project * ubo.view * vec4(position, 0.0, 1.0);
     outTexcoord = inTexcoord;
+    outColor = inColor;
 }
@@ -0,0 +1,20 @@
+#version 450
+
+layout(location = 0) out vec4 outColor;
+layout(location = 0) in vec2 Texcoord; // in atlas pixels
+layout(location = 1) in vec3 Color;
+
+// R8 signed distance field, 0.5 is the outline
+layout(set = 1, binding = 0) uniform sampler2D Sampler;
+
+layout(push_constant) uniform PushConstant {
+    layout(offset = 32) vec3 color;
+} pc;
+
+void main() {
+    float dist = texture(Sampler, Texcoord / vec2(textureSize(Sampler, 0))).r;
+    // about one screen pixel of smoothing whatever the text size is
+    float width = max(fwidth(dist) * 0.5, 1e-4);
+    float alpha = smoothstep(0.5 - width, 0.5 + width, dist);
+    outColor = vec4(pc.color * Color * alpha, alpha);
+}
@@ -1,15 +1,25 @@
 #include "toy2d/buffer.hpp"
+#include <algorithm>
 
 namespace toy2d {
 
-Buffer::Buffer(vk::BufferUsageFlags usage, size_t size, vk::MemoryPropertyFlags memProperty) {
+Buffer::Buffer(vk::BufferUsageFlags usage, size_t size, vk::MemoryPropertyFlags memProperty,
+               const std::vector<uint32_t>& queueFamilies) {
     auto& device = Context::Instance().device;
 
     this->size = size;
+    std::vector<uint32_t> families = queueFamilies;
+    std::sort(families.begin(), families.end());
+    families.erase(std::unique(families.begin(), families.end()), families.end());
+
     vk::BufferCreateInfo createInfo;
     createInfo.setUsage(usage)
               .setSize(size)
               .setSharingMode(vk::SharingMode::eExclusive);
+    if (families.size() > 1) {
+        createInfo.setSharingMode(vk::SharingMode::eConcurrent)
+                  .setQueueFamilyIndices(families);
+    }
 
     buffer = device.createBuffer(createInfo);
 
@@ -42,6 +52,14 @@ Buffer::~Buffer() {
 std::uint32_t QueryBufferMemTypeIndex(std::uint32_t type, vk::MemoryPropertyFlags flag) {
     auto property = Context::Instance().phyDevice.getMemoryProperties();
 
+    // prefer a type with all the properties, e.g. HostVisible|HostCached isn't available everywhere
+    for (std::uint32_t i = 0; i < property.memoryTypeCount; i++) {
+        if ((1 << i) & type &&
+            (property.memoryTypes[i].propertyFlags & flag) == flag) {
+                return i;
+        }
+    }
+
     for (std::uint32_t i = 0; i < property.memoryTypeCount; i++) {
         if ((1 << i) & type &&
             property.memoryTypes[i].propertyFlags & flag) {
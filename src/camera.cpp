@@ -0,0 +1,40 @@
+#include "toy2d/camera.hpp"
+#include <cmath>
+#include <stdexcept>
+
+namespace toy2d {
+
+void Camera::Move(const Vec& delta) {
+    position_.x += delta.x;
+    position_.y += delta.y;
+}
+
+void Camera::SetZoom(float zoom) {
+    if (zoom <= 0) {
+        throw std::runtime_error("camera zoom must be positive");
+    }
+    zoom_ = zoom;
+}
+
+void Camera::Zoom(float factor) {
+    SetZoom(zoom_ * factor);
+}
+
+void Camera::Follow(const Vec& target, float dt, float halfLife) {
+    if (halfLife <= 0) {
+        position_ = target;
+        return;
+    }
+    float t = 1 - std::exp2(-dt / halfLife);
+    position_.x += (target.x - position_.x) * t;
+    position_.y += (target.y - position_.y) * t;
+}
+
+Transform2D Camera::GetViewTransform(const Vec& center) const {
+    return Transform2D::CreateTranslate(center)
+           .Mul(Transform2D::CreateRotate(-rotation_))
+           .Mul(Transform2D::CreateScale(Vec{zoom_, zoom_}))
+           .Mul(Transform2D::CreateTranslate(Vec{-position_.x, -position_.y}));
+}
+
+}
@@ -3,8 +3,10 @@
 
 namespace toy2d {
 
-CommandManager::CommandManager() {
-    pool_ = createCommandPool();
+CommandManager::CommandManager(): CommandManager(Context::Instance().queueInfo.graphicsIndex.value()) {}
+
+CommandManager::CommandManager(uint32_t queueFamily) {
+    pool_ = createCommandPool(queueFamily);
 }
 
 CommandManager::~CommandManager() {
@@ -16,12 +18,12 @@ void CommandManager::ResetCmds() {
     Context::Instance().device.resetCommandPool(pool_);
 }
 
-vk::CommandPool CommandManager::createCommandPool() {
+vk::CommandPool CommandManager::createCommandPool(uint32_t queueFamily) {
     auto& ctx = Context::Instance();
 
     vk::CommandPoolCreateInfo createInfo;
 
-    createInfo.setQueueFamilyIndex(ctx.queueInfo.graphicsIndex.value())
+    createInfo.setQueueFamilyIndex(queueFamily)
               .setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
 
     return ctx.device.createCommandPool(createInfo);
@@ -32,12 +34,23 @@ std::vector<vk::CommandBuffer> CommandManager::CreateCommandBuffers(std::uint32_
 
     vk::CommandBufferAllocateInfo allocInfo;
     allocInfo.setCommandPool(pool_)
-             .setCommandBufferCount(1)
+             .setCommandBufferCount(count)
              .setLevel(vk::CommandBufferLevel::ePrimary);
 
     return ctx.device.allocateCommandBuffers(allocInfo);
 }
 
+std::vector<vk::CommandBuffer> CommandManager::CreateSecondaryCommandBuffers(std::uint32_t count) {
+    auto& ctx = Context::Instance();
+
+    vk::CommandBufferAllocateInfo allocInfo;
+    allocInfo.setCommandPool(pool_)
+             .setCommandBufferCount(count)
+             .setLevel(vk::CommandBufferLevel::eSecondary);
+
+    return ctx.device.allocateCommandBuffers(allocInfo);
+}
+
 vk::CommandBuffer CommandManager::CreateOneCommandBuffer() {
     return CreateCommandBuffers(1)[0];
 }
@@ -46,7 +59,12 @@ void CommandManager::FreeCmd(const vk::CommandBuffer& cmdBuf) {
     Context::Instance().device.freeCommandBuffers(pool_, cmdBuf);
 }
 
-void CommandManager::ExecuteCmd(vk::Queue queue, RecordCmdFunc func) {
+void CommandManager::ExecuteCmd(Timeline& timeline, RecordCmdFunc func) {
+    timeline.WaitFor(SubmitCmd(timeline, std::move(func)));
+    timeline.Collect();
+}
+
+uint64_t CommandManager::SubmitCmd(Timeline& timeline, RecordCmdFunc func, const std::vector<Timeline::Wait>& waits) {
     auto cmdBuf = CreateOneCommandBuffer();
 
     vk::CommandBufferBeginInfo beginInfo;
@@ -55,12 +73,9 @@ void CommandManager::ExecuteCmd(vk::Queue queue, RecordCmdFunc func) {
         if (func) func(cmdBuf);
     cmdBuf.end();
 
-    vk::SubmitInfo submitInfo;
-    submitInfo.setCommandBuffers(cmdBuf);
-    queue.submit(submitInfo);
-    queue.waitIdle();
-    Context::Instance().device.waitIdle();
-    FreeCmd(cmdBuf);
+    uint64_t value = timeline.Submit({cmdBuf}, waits);
+    timeline.Defer(value, [this, cmdBuf]() { FreeCmd(cmdBuf); });
+    return value;
 }
 
 }
@@ -1,11 +1,17 @@
 #include "toy2d/context.hpp"
+#include "toy2d/debug_utils.hpp"
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
 
 namespace toy2d {
 
 Context* Context::instance_ = nullptr;
 
-void Context::Init(std::vector<const char*>& extensions, GetSurfaceCallback cb) {
-    instance_ = new Context(extensions, cb);
+void Context::Init(std::vector<const char*>& extensions, GetSurfaceCallback cb, const Config& config) {
+    instance_ = new Context(extensions, cb, config);
 }
 
 void Context::Quit() {
@@ -16,7 +22,7 @@ Context& Context::Instance() {
     return *instance_;
 }
 
-Context::Context(std::vector<const char*>& extensions, GetSurfaceCallback cb) {
+Context::Context(std::vector<const char*>& extensions, GetSurfaceCallback cb, const Config& config): config(config) {
     getSurfaceCb_ = cb;
 
     instance = createInstance(extensions);
@@ -25,22 +31,59 @@ Context::Context(std::vector<const char*>& extensions, GetSurfaceCallback cb) {
         exit(1);
     }
 
+    // devices are rated by their present support, so the surface comes first
+    getSurface();
+
     phyDevice = pickupPhysicalDevice();
     if (!phyDevice) {
         std::cout << "pickup physical device failed" << std::endl;
         exit(1);
     }
 
-    getSurface();
-
     device = createDevice(surface_);
     if (!device) {
         std::cout << "create device failed" << std::endl;
         exit(1);
     }
+    if (debugUtils) {
+        dispatch.init(device);
+    }
 
     graphicsQueue = device.getQueue(queueInfo.graphicsIndex.value(), 0);
     presentQueue = device.getQueue(queueInfo.presentIndex.value(), 0);
+    transferQueue = device.getQueue(queueInfo.transferIndex.value(), queueInfo.transferQueueIndex);
+    computeQueue = device.getQueue(queueInfo.computeIndex.value(), queueInfo.computeQueueIndex);
+}
+
+void Context::initTimelines() {
+    // queues shared with graphics still get their own timeline, submissions to one queue signal in order
+    graphicsTimeline = std::make_unique<Timeline>(graphicsQueue);
+    transferTimeline = std::make_unique<Timeline>(transferQueue);
+    computeTimeline = std::make_unique<Timeline>(computeQueue);
+    SetDebugName(graphicsTimeline->semaphore, "graphics timeline");
+    SetDebugName(transferTimeline->semaphore, "transfer timeline");
+    SetDebugName(computeTimeline->semaphore, "compute timeline");
+}
+
+void Context::initUploader() {
+    uploader = std::make_unique<Uploader>();
+}
+
+void Context::CollectTimelines() {
+    graphicsTimeline->Collect();
+    transferTimeline->Collect();
+    computeTimeline->Collect();
+}
+
+void Context::DeferDestroy(std::function<void()> func) {
+    frameGarbage_.push_back(std::move(func));
+}
+
+void Context::ScheduleDeferred(uint64_t value) {
+    for (auto& func : frameGarbage_) {
+        graphicsTimeline->Defer(value, std::move(func));
+    }
+    frameGarbage_.clear();
 }
 
 void Context::getSurface() {
@@ -51,17 +94,207 @@ void Context::getSurface() {
     }
 }
 
+static std::string toLower(std::string str) {
+    std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return std::tolower(c); });
+    return str;
+}
+
+VKAPI_ATTR VkBool32 VKAPI_CALL Context::debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+                                                      VkDebugUtilsMessageTypeFlagsEXT,
+                                                      const VkDebugUtilsMessengerCallbackDataEXT* data,
+                                                      void* userData) {
+    const char* tag = severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT ? "[vulkan error] " : "[vulkan warning] ";
+    std::string message = tag + std::string(data->pMessage);
+
+    static_cast<Context*>(userData)->log(message);
+    return VK_FALSE;
+}
+
+void Context::log(const std::string& message) const {
+    if (config.logger) {
+        config.logger(message);
+    } else if (debugLevel != DebugLevel::Release) {
+        std::cerr << message << std::endl;
+    }
+}
+
+void Context::warn(const std::string& message) const {
+    if (config.logger) {
+        config.logger(message);
+    } else {
+        std::cerr << message << std::endl;
+    }
+}
+
+void Context::resolveDebugLevel() {
+    debugLevel = config.debugLevel;
+    const char* env = std::getenv("TOY2D_DEBUG");
+    if (!env || !*env) {
+        return;
+    }
+
+    std::string level = toLower(env);
+    if (level == "release") {
+        debugLevel = DebugLevel::Release;
+    } else if (level == "validation") {
+        debugLevel = DebugLevel::Validation;
+    } else if (level == "profile") {
+        debugLevel = DebugLevel::Profile;
+    } else {
+        warn("unknown TOY2D_DEBUG value " + std::string(env) + ", ignored");
+    }
+}
+
 vk::Instance Context::createInstance(std::vector<const char*>& extensions) {
+    resolveDebugLevel();
+
     vk::InstanceCreateInfo info; 
     vk::ApplicationInfo appInfo;
     appInfo.setApiVersion(VK_API_VERSION_1_3);
+
+    // the layer and the extension are optional, e.g. machines without the SDK have no validation layer
+    std::vector<const char*> layers;
+    std::vector<const char*> enabledExtensions = extensions;
+    if (debugLevel == DebugLevel::Validation) {
+        auto available = vk::enumerateInstanceLayerProperties();
+        auto it = std::find_if(available.begin(), available.end(), [](const vk::LayerProperties& layer) {
+            return strcmp(layer.layerName.data(), "VK_LAYER_KHRONOS_validation") == 0;
+        });
+        if (it != available.end()) {
+            layers.push_back("VK_LAYER_KHRONOS_validation");
+        } else {
+            log("VK_LAYER_KHRONOS_validation isn't installed, run without validation");
+        }
+    }
+    if (debugLevel != DebugLevel::Release) {
+        auto available = vk::enumerateInstanceExtensionProperties();
+        auto it = std::find_if(available.begin(), available.end(), [](const vk::ExtensionProperties& ext) {
+            return strcmp(ext.extensionName.data(), VK_EXT_DEBUG_UTILS_EXTENSION_NAME) == 0;
+        });
+        if (it != available.end()) {
+            enabledExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+            debugUtils = true;
+        } else {
+            log(VK_EXT_DEBUG_UTILS_EXTENSION_NAME + std::string(" isn't available, no debug messages, names or labels"));
+        }
+    }
+
+    vk::DebugUtilsMessengerCreateInfoEXT messengerInfo;
+    messengerInfo.setMessageSeverity(vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning|
+                                     vk::DebugUtilsMessageSeverityFlagBitsEXT::eError)
+                 .setMessageType(vk::DebugUtilsMessageTypeFlagBitsEXT::eGeneral|
+                                 vk::DebugUtilsMessageTypeFlagBitsEXT::eValidation|
+                                 vk::DebugUtilsMessageTypeFlagBitsEXT::ePerformance)
+                 .setPUserData(this);
+    // through the C struct, the vk-hpp callback signature differs between header versions
+    static_cast<VkDebugUtilsMessengerCreateInfoEXT&>(messengerInfo).pfnUserCallback = &Context::debugCallback;
+    bool useMessenger = debugUtils && !layers.empty();
+
     info.setPApplicationInfo(&appInfo)
-        .setPEnabledExtensionNames(extensions);
+        .setPEnabledExtensionNames(enabledExtensions)
+        .setPEnabledLayerNames(layers);
+    if (useMessenger) {
+        // also reports problems of instance creation and destruction
+        info.setPNext(&messengerInfo);
+    }
 
-    std::vector<const char*> layers = {"VK_LAYER_KHRONOS_validation"};
-    info.setPEnabledLayerNames(layers);
+    auto result = vk::createInstance(info);
+    if (debugUtils) {
+        dispatch.init(result, vkGetInstanceProcAddr);
+    }
+    if (useMessenger) {
+        debugMessenger_ = result.createDebugUtilsMessengerEXT(messengerInfo, nullptr, dispatch);
+    }
+    return result;
+}
 
-    return vk::createInstance(info);
+static std::string deviceUUID(vk::PhysicalDevice device) {
+    auto props = device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceIDProperties>();
+    auto& uuid = props.get<vk::PhysicalDeviceIDProperties>().deviceUUID;
+    std::string result;
+    const char* digits = "0123456789abcdef";
+    for (auto byte : uuid) {
+        result += digits[byte >> 4];
+        result += digits[byte & 0xF];
+    }
+    return result;
+}
+
+static bool matchDevice(const std::string& selector, uint32_t index, vk::PhysicalDevice device) {
+    if (std::all_of(selector.begin(), selector.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        return std::to_string(index) == selector;
+    }
+
+    std::string uuid = toLower(selector);
+    uuid.erase(std::remove(uuid.begin(), uuid.end(), '-'), uuid.end());
+    if (uuid == deviceUUID(device)) {
+        return true;
+    }
+
+    std::string name = device.getProperties().deviceName.data();
+    return toLower(name).find(toLower(selector)) != std::string::npos;
+}
+
+int Context::scoreDevice(vk::PhysicalDevice device) {
+    auto props = device.getProperties();
+    if (props.apiVersion < VK_API_VERSION_1_2) {
+        return -1;
+    }
+
+    auto extensions = device.enumerateDeviceExtensionProperties();
+    auto hasExtension = [&](const char* name) {
+        return std::any_of(extensions.begin(), extensions.end(),
+                           [=](const vk::ExtensionProperties& ext) { return strcmp(ext.extensionName.data(), name) == 0; });
+    };
+    if (!hasExtension(VK_KHR_SWAPCHAIN_EXTENSION_NAME)) {
+        return -1;
+    }
+
+    auto features = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+    if (!features.get<vk::PhysicalDeviceVulkan12Features>().timelineSemaphore) {
+        return -1;
+    }
+
+    bool graphics = false, present = false, asyncCompute = false, asyncTransfer = false;
+    auto families = device.getQueueFamilyProperties();
+    for (uint32_t i = 0; i < families.size(); i++) {
+        auto flags = families[i].queueFlags;
+        graphics = graphics || (flags & vk::QueueFlagBits::eGraphics);
+        present = present || device.getSurfaceSupportKHR(i, surface_);
+        if (!(flags & vk::QueueFlagBits::eGraphics)) {
+            asyncCompute = asyncCompute || (flags & vk::QueueFlagBits::eCompute);
+            asyncTransfer = asyncTransfer || (flags & vk::QueueFlagBits::eTransfer);
+        }
+    }
+    if (!graphics || !present) {
+        return -1;
+    }
+
+    int score = 0;
+    switch (props.deviceType) {
+        case vk::PhysicalDeviceType::eDiscreteGpu: score += 10000; break;
+        case vk::PhysicalDeviceType::eIntegratedGpu: score += 5000; break;
+        case vk::PhysicalDeviceType::eVirtualGpu: score += 2000; break;
+        case vk::PhysicalDeviceType::eCpu: score += 100; break;
+        default: break;
+    }
+
+    // 1 point per 64MB of the largest device local heap
+    auto memory = device.getMemoryProperties();
+    vk::DeviceSize localHeap = 0;
+    for (uint32_t i = 0; i < memory.memoryHeapCount; i++) {
+        if (memory.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+            localHeap = std::max(localHeap, memory.memoryHeaps[i].size);
+        }
+    }
+    score += static_cast<int>(std::min<vk::DeviceSize>(localHeap >> 26, 1000));
+
+    // optional fast paths
+    if (asyncTransfer) score += 200;
+    if (asyncCompute) score += 200;
+    if (hasExtension(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME)) score += 50;
+
+    return score;
 }
 
 vk::PhysicalDevice Context::pickupPhysicalDevice() {
@@ -70,31 +303,86 @@ vk::PhysicalDevice Context::pickupPhysicalDevice() {
         std::cout << "you don't have suitable device to support vulkan" << std::endl;
         exit(1);
     }
-    return devices[0];
+
+    std::string selector = config.preferredDevice;
+    if (const char* env = std::getenv("TOY2D_DEVICE"); env && *env) {
+        selector = env;
+    }
+
+    int best = -1, bestScore = -1, selected = -1;
+    for (uint32_t i = 0; i < devices.size(); i++) {
+        int score = scoreDevice(devices[i]);
+        log("device " + std::to_string(i) + ": " + devices[i].getProperties().deviceName.data() +
+            " (uuid " + deviceUUID(devices[i]) + ") score " + std::to_string(score) +
+            (score < 0 ? " unsuitable" : ""));
+
+        // ties keep the enumeration order, so the choice is stable between runs
+        if (score > bestScore) {
+            best = i;
+            bestScore = score;
+        }
+        if (!selector.empty() && selected < 0 && matchDevice(selector, i, devices[i])) {
+            selected = i;
+            if (score < 0) {
+                log("device " + std::to_string(i) + " matches \"" + selector + "\" but is unsuitable, ignored");
+                selected = -2;
+            }
+        }
+    }
+    if (!selector.empty() && selected == -1) {
+        log("no device matches \"" + selector + "\"");
+    }
+
+    int choice = selected >= 0 ? selected : best;
+    if (choice < 0) {
+        return nullptr;
+    }
+    log("use device " + std::to_string(choice) + ": " + devices[choice].getProperties().deviceName.data() +
+        (selected >= 0 ? " (selected by \"" + selector + "\")" : " (highest score)"));
+    return devices[choice];
 }
 
 vk::Device Context::createDevice(vk::SurfaceKHR surface) {
     vk::DeviceCreateInfo deviceCreateInfo;
     queryQueueInfo(surface);
-    std::array extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    std::vector<const char*> extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    auto available = phyDevice.enumerateDeviceExtensionProperties();
+    incrementalPresent = std::any_of(available.begin(), available.end(), [](const vk::ExtensionProperties& ext) {
+        return strcmp(ext.extensionName.data(), VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME) == 0;
+    });
+    if (incrementalPresent) {
+        extensions.push_back(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+    }
     deviceCreateInfo.setPEnabledExtensionNames(extensions);
 
+    // timeline semaphores are core since 1.2 but still an opt-in feature
+    auto supported = phyDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+    if (phyDevice.getProperties().apiVersion < VK_API_VERSION_1_2 ||
+        !supported.get<vk::PhysicalDeviceVulkan12Features>().timelineSemaphore) {
+        std::cout << "device doesn't support timeline semaphores" << std::endl;
+        exit(1);
+    }
+    vk::PhysicalDeviceVulkan12Features features12;
+    features12.setTimelineSemaphore(true);
+    deviceCreateInfo.setPNext(&features12);
+
+    // one create info per family, with as many queues as the highest index used in it
+    std::map<std::uint32_t, std::uint32_t> queueCounts;
+    auto useQueue = [&](std::uint32_t family, std::uint32_t index) {
+        queueCounts[family] = std::max(queueCounts[family], index + 1);
+    };
+    useQueue(queueInfo.graphicsIndex.value(), 0);
+    useQueue(queueInfo.presentIndex.value(), 0);
+    useQueue(queueInfo.transferIndex.value(), queueInfo.transferQueueIndex);
+    useQueue(queueInfo.computeIndex.value(), queueInfo.computeQueueIndex);
+
     std::vector<vk::DeviceQueueCreateInfo> queueInfos;
-    float priority = 1;
-    if (queueInfo.graphicsIndex.value() == queueInfo.presentIndex.value()) {
-        vk::DeviceQueueCreateInfo queueCreateInfo;
-        queueCreateInfo.setPQueuePriorities(&priority);
-        queueCreateInfo.setQueueCount(1);
-        queueCreateInfo.setQueueFamilyIndex(queueInfo.graphicsIndex.value());
-        queueInfos.push_back(queueCreateInfo);
-    } else {
+    std::vector<float> priorities(3, 1.0f);
+    for (auto& [family, count] : queueCounts) {
         vk::DeviceQueueCreateInfo queueCreateInfo;
-        queueCreateInfo.setPQueuePriorities(&priority);
-        queueCreateInfo.setQueueCount(1);
-        queueCreateInfo.setQueueFamilyIndex(queueInfo.graphicsIndex.value());
-        queueInfos.push_back(queueCreateInfo);
-
-        queueCreateInfo.setQueueFamilyIndex(queueInfo.presentIndex.value());
+        queueCreateInfo.setPQueuePriorities(priorities.data());
+        queueCreateInfo.setQueueCount(count);
+        queueCreateInfo.setQueueFamilyIndex(family);
         queueInfos.push_back(queueCreateInfo);
     }
     deviceCreateInfo.setQueueCreateInfos(queueInfos);
@@ -118,28 +406,83 @@ void Context::queryQueueInfo(vk::SurfaceKHR surface) {
             break;
         }
     }
+    if (!queueInfo.graphicsIndex.has_value() || !queueInfo.presentIndex.has_value()) {
+        return;
+    }
+
+    // prefer presenting from the graphics family
+    std::uint32_t graphics = queueInfo.graphicsIndex.value();
+    if (phyDevice.getSurfaceSupportKHR(graphics, surface)) {
+        queueInfo.presentIndex = graphics;
+    }
+
+    // families without graphics run asynchronously to rendering,
+    // the transfer one preferably without compute too (usually the DMA engine)
+    auto findFamily = [&](vk::QueueFlags required, vk::QueueFlags excluded) -> std::optional<std::uint32_t> {
+        for (std::uint32_t i = 0; i < queueProps.size(); i++) {
+            auto flags = queueProps[i].queueFlags;
+            if ((flags & required) == required && !(flags & excluded)) {
+                return i;
+            }
+        }
+        return std::nullopt;
+    };
+    queueInfo.computeIndex = findFamily(vk::QueueFlagBits::eCompute, vk::QueueFlagBits::eGraphics);
+    queueInfo.transferIndex = findFamily(vk::QueueFlagBits::eTransfer, vk::QueueFlagBits::eGraphics|vk::QueueFlagBits::eCompute);
+    if (!queueInfo.transferIndex) {
+        queueInfo.transferIndex = findFamily(vk::QueueFlagBits::eTransfer, vk::QueueFlagBits::eGraphics);
+    }
+
+    // otherwise use extra queues of the graphics family, or share the graphics queue
+    std::uint32_t nextGraphicsQueue = 1;
+    auto graphicsQueueIndex = [&]() {
+        return nextGraphicsQueue < queueProps[graphics].queueCount ? nextGraphicsQueue ++ : 0;
+    };
+    if (!queueInfo.computeIndex) {
+        queueInfo.computeIndex = graphics;
+        queueInfo.computeQueueIndex = graphicsQueueIndex();
+    }
+    if (!queueInfo.transferIndex) {
+        queueInfo.transferIndex = graphics;
+        queueInfo.transferQueueIndex = graphicsQueueIndex();
+    } else if (queueInfo.transferIndex == queueInfo.computeIndex) {
+        // no transfer-only family, take a second queue of the compute family if it has one
+        queueInfo.transferQueueIndex = queueProps[queueInfo.transferIndex.value()].queueCount > 1 ? 1 : 0;
+    }
 }
 
 void Context::initSwapchain(int windowWidth, int windowHeight) {
     swapchain = std::make_unique<Swapchain>(surface_, windowWidth, windowHeight);
 }
 
+std::unique_ptr<Swapchain> Context::RecreateSwapchain(int windowWidth, int windowHeight) {
+    auto oldSwapchain = std::move(swapchain);
+    swapchain = std::make_unique<Swapchain>(surface_, windowWidth, windowHeight, oldSwapchain->swapchain);
+    swapchain->InitFramebuffers();
+    return oldSwapchain;
+}
+
 void Context::initRenderProcess() {
     renderProcess = std::make_unique<RenderProcess>();
 }
 
 void Context::initGraphicsPipeline() {
-    renderProcess->CreateGraphicsPipeline(*shader);
+    renderProcess->CreateGraphicsPipeline(*shader, *lineShader, *textShader, *particleShader);
 }
 
 void Context::initCommandPool() {
     commandManager = std::make_unique<CommandManager>();
+    transferCommandManager = std::make_unique<CommandManager>(queueInfo.transferIndex.value());
+    computeCommandManager = std::make_unique<CommandManager>(queueInfo.computeIndex.value());
 }
 
 void Context::initShaderModules() {
     auto vertexSource = ReadWholeFile("./vert.spv");
     auto fragSource = ReadWholeFile("./frag.spv");
     shader = std::make_unique<Shader>(vertexSource, fragSource);
+    lineShader = std::make_unique<Shader>(ReadWholeFile("./line_vert.spv"), ReadWholeFile("./line_frag.spv"));
+    textShader = std::make_unique<Shader>(vertexSource, ReadWholeFile("./text_frag.spv"));
+    particleShader = std::make_unique<Shader>(ReadWholeFile("./particle_vert.spv"), ReadWholeFile("./particle_frag.spv"));
 }
 
 void Context::initSampler() {
@@ -158,12 +501,26 @@ void Context::initSampler() {
 }
 
 Context::~Context() {
+    uploader.reset();
+    ScheduleDeferred(graphicsTimeline->Pending());
+    computeTimeline.reset();
+    transferTimeline.reset();
+    graphicsTimeline.reset();
     shader.reset();
+    lineShader.reset();
+    textShader.reset();
+    particleShader.reset();
     device.destroySampler(sampler);
+    computeCommandManager.reset();
+    transferCommandManager.reset();
     commandManager.reset();
     renderProcess.reset();
     swapchain.reset();
+    instance.destroySurfaceKHR(surface_);
     device.destroy();
+    if (debugMessenger_) {
+        instance.destroyDebugUtilsMessengerEXT(debugMessenger_, nullptr, dispatch);
+    }
     instance.destroy();
 }
 
@@ -0,0 +1,40 @@
+#include "toy2d/debug_utils.hpp"
+#include "toy2d/context.hpp"
+
+namespace toy2d {
+
+void SetDebugName(vk::ObjectType type, uint64_t handle, const std::string& name) {
+    auto& ctx = Context::Instance();
+    if (!ctx.debugUtils) {
+        return;
+    }
+
+    vk::DebugUtilsObjectNameInfoEXT info;
+    info.setObjectType(type)
+        .setObjectHandle(handle)
+        .setPObjectName(name.c_str());
+    ctx.device.setDebugUtilsObjectNameEXT(info, ctx.dispatch);
+}
+
+void BeginDebugLabel(vk::CommandBuffer cmd, const std::string& name, const std::array<float, 4>& color) {
+    auto& ctx = Context::Instance();
+    if (!ctx.debugUtils) {
+        return;
+    }
+
+    vk::DebugUtilsLabelEXT label;
+    label.setPLabelName(name.c_str())
+         .setColor(color);
+    cmd.beginDebugUtilsLabelEXT(label, ctx.dispatch);
+}
+
+void EndDebugLabel(vk::CommandBuffer cmd) {
+    auto& ctx = Context::Instance();
+    if (!ctx.debugUtils) {
+        return;
+    }
+
+    cmd.endDebugUtilsLabelEXT(ctx.dispatch);
+}
+
+}
@@ -7,7 +7,7 @@ std::unique_ptr<DescriptorSetManager> DescriptorSetManager::instance_ = nullptr;
 
 DescriptorSetManager::DescriptorSetManager(uint32_t maxFlight): maxFlight_(maxFlight) {
     vk::DescriptorPoolSize size;
-    size.setType(vk::DescriptorType::eUniformBuffer)
+    size.setType(vk::DescriptorType::eUniformBufferDynamic)
         .setDescriptorCount(2 * maxFlight);
     vk::DescriptorPoolCreateInfo createInfo;
     createInfo.setMaxSets(maxFlight)
@@ -44,7 +44,7 @@ void DescriptorSetManager::addImageSetPool() {
 }
 
 std::vector<DescriptorSetManager::SetInfo> DescriptorSetManager::AllocBufferSets(uint32_t num) {
-    std::vector<vk::DescriptorSetLayout> layouts(maxFlight_, Context::Instance().shader->GetDescriptorSetLayouts()[0]);
+    std::vector<vk::DescriptorSetLayout> layouts(num, Context::Instance().shader->GetDescriptorSetLayouts()[0]);
     vk::DescriptorSetAllocateInfo allocInfo;
     allocInfo.setDescriptorPool(bufferSetPool_.pool_)
              .setDescriptorSetCount(num)
@@ -84,6 +84,8 @@ DescriptorSetManager::SetInfo DescriptorSetManager::AllocImageSet() {
 }
 
 void DescriptorSetManager::FreeImageSet(const SetInfo& info) {
+    Context::Instance().device.freeDescriptorSets(info.pool, info.set);
+
     auto it = std::find_if(fulledImageSetPool_.begin(), fulledImageSetPool_.end(),
                            [&](const PoolInfo& poolInfo) {
                                 return poolInfo.pool_ == info.pool;
@@ -0,0 +1,78 @@
+#include "toy2d/draw_list.hpp"
+#include <algorithm>
+#include <array>
+
+namespace toy2d {
+
+static uint32_t quantizeDepth(float depth) {
+    constexpr uint32_t DepthMax = (1 << 24) - 1;
+    return static_cast<uint32_t>(std::clamp(depth, 0.0f, 1.0f) * DepthMax);
+}
+
+uint64_t DrawList::MakeKey(uint8_t layer, uint8_t pipeline, uint32_t texture, float depth) {
+    return (static_cast<uint64_t>(layer) << 56) |
+           (static_cast<uint64_t>(pipeline) << 48) |
+           (static_cast<uint64_t>(texture & 0xFFFFFF) << 24) |
+           static_cast<uint64_t>(quantizeDepth(depth));
+}
+
+uint64_t DrawList::MakeOrderedKey(uint8_t layer, float depth, uint32_t sequence) {
+    return (static_cast<uint64_t>(layer) << 56) |
+           (static_cast<uint64_t>(quantizeDepth(depth)) << 32) |
+           static_cast<uint64_t>(sequence);
+}
+
+void DrawList::Sort() {
+    uint32_t count = static_cast<uint32_t>(cmds_.size());
+    order_.resize(count);
+    swap_.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        order_[i] = i;
+    }
+
+    // LSD radix sort on 8 bit digits, stable by construction
+    for (int shift = 0; shift < 64; shift += 8) {
+        std::array<uint32_t, 256> histogram{};
+        for (uint32_t i = 0; i < count; i++) {
+            histogram[(cmds_[i].key >> shift) & 0xFF] ++;
+        }
+
+        // every key shares this digit, nothing to move
+        if (count == 0 || histogram[(cmds_[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        uint32_t sum = 0;
+        for (auto& value : histogram) {
+            uint32_t n = value;
+            value = sum;
+            sum += n;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t index = order_[i];
+            swap_[histogram[(cmds_[index].key >> shift) & 0xFF] ++] = index;
+        }
+        order_.swap(swap_);
+    }
+}
+
+void DrawList::Clear() {
+    cmds_.clear();
+    order_.clear();
+}
+
+uint32_t DrawList::CountStateChanges(bool sorted) const {
+    uint32_t changes = 0;
+    const DrawCmd* last = nullptr;
+    for (size_t i = 0; i < cmds_.size(); i++) {
+        const DrawCmd& cmd = sorted ? cmds_[order_[i]] : cmds_[i];
+        if (!last || last->pipeline != cmd.pipeline) changes ++;
+        if (!last || last->textureSet != cmd.textureSet) changes ++;
+        if (!last || last->vertexBuffer != cmd.vertexBuffer) changes ++;
+        last = &cmd;
+    }
+    return changes;
+}
+
+}
@@ -0,0 +1,276 @@
+#include "toy2d/font.hpp"
+#include "toy2d/texture.hpp"
+#include "toy2d/context.hpp"
+#include "toy2d/truetype.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace toy2d {
+
+static constexpr uint32_t MaxAtlasSize = 4096;
+// keeps bilinear filtering from picking up the neighbor glyph
+static constexpr uint32_t AtlasPadding = 1;
+
+// next code point of utf8 text, invalid sequences decode as U+FFFD
+static uint32_t decodeUtf8(const std::string& text, size_t& i) {
+    auto c = static_cast<unsigned char>(text[i++]);
+    if (c < 0x80) {
+        return c;
+    }
+
+    int extra;
+    uint32_t codepoint;
+    if ((c & 0xE0) == 0xC0) {
+        extra = 1;
+        codepoint = c & 0x1F;
+    } else if ((c & 0xF0) == 0xE0) {
+        extra = 2;
+        codepoint = c & 0x0F;
+    } else if ((c & 0xF8) == 0xF0) {
+        extra = 3;
+        codepoint = c & 0x07;
+    } else {
+        return 0xFFFD;
+    }
+
+    for (int k = 0; k < extra; k++) {
+        if (i >= text.size() || (static_cast<unsigned char>(text[i]) & 0xC0) != 0x80) {
+            return 0xFFFD;
+        }
+        codepoint = (codepoint << 6) | (static_cast<unsigned char>(text[i++]) & 0x3F);
+    }
+    return codepoint;
+}
+
+// Distance of every pixel to the nearest pixel on the other side of the outline,
+// searched in a window of `spread` pixels. Brute force is fine for glyph sized bitmaps
+// that are only processed once.
+static std::vector<uint8_t> computeDistanceField(const GlyphBitmap& bitmap, uint32_t width, uint32_t height) {
+    int spread = static_cast<int>(Font::Spread);
+    int w = static_cast<int>(width);
+    int h = static_cast<int>(height);
+
+    std::vector<uint8_t> inside(width * height, 0);
+    for (uint32_t y = 0; y < bitmap.height; y++) {
+        for (uint32_t x = 0; x < bitmap.width; x++) {
+            inside[(y + spread) * width + x + spread] = bitmap.coverage[y * bitmap.width + x] >= 128;
+        }
+    }
+
+    std::vector<uint8_t> field(width * height);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            bool in = inside[y * w + x];
+            int best = (spread + 1) * (spread + 1);
+            for (int dy = -spread; dy <= spread; dy++) {
+                int sy = y + dy;
+                for (int dx = -spread; dx <= spread; dx++) {
+                    int sx = x + dx;
+                    bool other = sx >= 0 && sy >= 0 && sx < w && sy < h ? inside[sy * w + sx] : false;
+                    if (other != in) {
+                        best = std::min(best, dx * dx + dy * dy);
+                    }
+                }
+            }
+
+            // the outline lies half way between the two pixel centers
+            float dist = std::sqrt(static_cast<float>(best)) - 0.5f;
+            float value = 0.5f + (in ? dist : -dist) / (2.0f * spread);
+            field[y * w + x] = static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+    }
+    return field;
+}
+
+Font::Font(const std::string& ttfFilename): Font(std::make_shared<const TrueTypeFont>(ttfFilename)) {}
+
+Font::Font(std::shared_ptr<const TrueTypeFont> font)
+    : Font([font](uint32_t codepoint, float pixelSize, GlyphBitmap& out) {
+               return font->Rasterize(codepoint, pixelSize, out);
+           },
+           font->GetMetrics()) {}
+
+Font::Font(GlyphRasterizer rasterizer): Font(std::move(rasterizer), Metrics{}) {}
+
+Font::Font(GlyphRasterizer rasterizer, const Metrics& metrics): rasterizer_(std::move(rasterizer)), metrics_(metrics) {
+    atlas_.resize(atlasWidth_ * atlasHeight_, 0);
+}
+
+Font::~Font() {
+    if (texture_) {
+        TextureManager::Instance().Destroy(texture_);
+    }
+}
+
+const Font::Glyph* Font::getGlyph(uint32_t codepoint) {
+    auto it = glyphs_.find(codepoint);
+    if (it != glyphs_.end()) {
+        return &it->second;
+    }
+
+    Glyph glyph;
+    GlyphBitmap bitmap;
+    // missing glyphs are cached as blank so the rasterizer isn't asked again
+    if (rasterizer_(codepoint, RasterSize, bitmap)) {
+        glyph.advance = bitmap.advance;
+        glyph.offsetX = bitmap.offsetX;
+        glyph.offsetY = bitmap.offsetY;
+
+        if (bitmap.width > 0 && bitmap.height > 0) {
+            glyph.width = bitmap.width + Spread * 2;
+            glyph.height = bitmap.height + Spread * 2;
+            auto field = computeDistanceField(bitmap, glyph.width, glyph.height);
+
+            pack(glyph.width, glyph.height, glyph.x, glyph.y);
+            for (uint32_t row = 0; row < glyph.height; row++) {
+                std::copy_n(field.begin() + row * glyph.width, glyph.width,
+                            atlas_.begin() + (glyph.y + row) * atlasWidth_ + glyph.x);
+            }
+            if (dirtyX0_ >= dirtyX1_) {
+                dirtyX0_ = glyph.x;
+                dirtyY0_ = glyph.y;
+                dirtyX1_ = glyph.x + glyph.width;
+                dirtyY1_ = glyph.y + glyph.height;
+            } else {
+                dirtyX0_ = std::min(dirtyX0_, glyph.x);
+                dirtyY0_ = std::min(dirtyY0_, glyph.y);
+                dirtyX1_ = std::max(dirtyX1_, glyph.x + glyph.width);
+                dirtyY1_ = std::max(dirtyY1_, glyph.y + glyph.height);
+            }
+        }
+    }
+
+    return &glyphs_.emplace(codepoint, glyph).first->second;
+}
+
+bool Font::pack(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y) {
+    uint32_t paddedWidth = width + AtlasPadding;
+    uint32_t paddedHeight = height + AtlasPadding;
+
+    while (true) {
+        // shelf packing: the first shelf that is tall enough and has room left
+        for (auto& shelf : shelves_) {
+            if (shelf.height >= paddedHeight && shelf.x + paddedWidth <= atlasWidth_) {
+                x = shelf.x;
+                y = shelf.y;
+                shelf.x += paddedWidth;
+                return true;
+            }
+        }
+
+        uint32_t top = shelves_.empty() ? 0 : shelves_.back().y + shelves_.back().height;
+        if (top + paddedHeight <= atlasHeight_ && paddedWidth <= atlasWidth_) {
+            shelves_.push_back({top, paddedHeight, paddedWidth});
+            x = 0;
+            y = top;
+            return true;
+        }
+
+        grow();
+    }
+}
+
+void Font::grow() {
+    if (atlasWidth_ >= MaxAtlasSize && atlasHeight_ >= MaxAtlasSize) {
+        throw std::runtime_error("font atlas is full");
+    }
+
+    // glyph positions are in pixels, so they stay valid when the atlas grows
+    if (atlasHeight_ < atlasWidth_) {
+        atlasHeight_ *= 2;
+        atlas_.resize(atlasWidth_ * atlasHeight_, 0);
+    } else {
+        uint32_t width = atlasWidth_ * 2;
+        std::vector<uint8_t> atlas(width * atlasHeight_, 0);
+        for (uint32_t row = 0; row < atlasHeight_; row++) {
+            std::copy_n(atlas_.begin() + row * atlasWidth_, atlasWidth_, atlas.begin() + row * width);
+        }
+        atlas_ = std::move(atlas);
+        atlasWidth_ = width;
+    }
+    resized_ = true;
+}
+
+Size Font::Measure(const std::string& utf8, float size) {
+    float scale = size / RasterSize;
+    float lineWidth = 0;
+    float width = 0;
+    uint32_t lines = 1;
+
+    size_t i = 0;
+    while (i < utf8.size()) {
+        uint32_t codepoint = decodeUtf8(utf8, i);
+        if (codepoint == '\n') {
+            lines ++;
+            lineWidth = 0;
+            continue;
+        }
+        lineWidth += getGlyph(codepoint)->advance * scale;
+        width = std::max(width, lineWidth);
+    }
+    return Size{width, LineHeight(size) * lines - metrics_.lineGap * size};
+}
+
+void Font::Layout(const std::string& utf8, const Vec& position, float size, const Color& color, std::vector<Vertex>& out) {
+    float scale = size / RasterSize;
+    float penX = position.x;
+    float baseline = position.y + metrics_.ascent * size;
+
+    size_t i = 0;
+    while (i < utf8.size()) {
+        uint32_t codepoint = decodeUtf8(utf8, i);
+        if (codepoint == '\n') {
+            penX = position.x;
+            baseline += LineHeight(size);
+            continue;
+        }
+
+        const Glyph& glyph = *getGlyph(codepoint);
+        if (glyph.width > 0) {
+            float left = penX + (glyph.offsetX - Spread) * scale;
+            float top = baseline + (glyph.offsetY - Spread) * scale;
+            float right = left + glyph.width * scale;
+            float bottom = top + glyph.height * scale;
+            float u0 = static_cast<float>(glyph.x);
+            float v0 = static_cast<float>(glyph.y);
+            float u1 = static_cast<float>(glyph.x + glyph.width);
+            float v1 = static_cast<float>(glyph.y + glyph.height);
+
+            // same winding as the renderer's unit quad
+            Vertex v[4] = {
+                {Vec{left, top}, Vec{u0, v0}, color},
+                {Vec{right, top}, Vec{u1, v0}, color},
+                {Vec{right, bottom}, Vec{u1, v1}, color},
+                {Vec{left, bottom}, Vec{u0, v1}, color},
+            };
+            out.insert(out.end(), {v[0], v[1], v[3], v[1], v[2], v[3]});
+        }
+        penX += glyph.advance * scale;
+    }
+}
+
+Texture* Font::GetTexture() {
+    if (resized_ || !texture_) {
+        // frames in flight may still sample the old atlas, Destroy defers its release
+        if (texture_) {
+            TextureManager::Instance().Destroy(texture_);
+        }
+        texture_ = TextureManager::Instance().Create(atlas_.data(), atlasWidth_, atlasHeight_, vk::Format::eR8Unorm);
+        resized_ = false;
+    } else if (dirtyX0_ < dirtyX1_) {
+        uint32_t width = dirtyX1_ - dirtyX0_;
+        uint32_t height = dirtyY1_ - dirtyY0_;
+        std::vector<uint8_t> region(width * height);
+        for (uint32_t row = 0; row < height; row++) {
+            std::copy_n(atlas_.begin() + (dirtyY0_ + row) * atlasWidth_ + dirtyX0_, width,
+                        region.begin() + row * width);
+        }
+        vk::Rect2D rect({static_cast<int32_t>(dirtyX0_), static_cast<int32_t>(dirtyY0_)}, {width, height});
+        Context::Instance().uploader->UpdateImage(texture_->image, rect, region.data(), region.size());
+    }
+    dirtyX0_ = dirtyX1_ = 0;
+    return texture_;
+}
+
+}
@@ -0,0 +1,55 @@
+#include "toy2d/frame_pacing.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace toy2d {
+
+size_t FrameHistogram::bucketOf(float ms) {
+    if (ms <= 0) {
+        return 0;
+    }
+    return std::min(static_cast<size_t>(ms / BucketWidthMs), BucketCount - 1);
+}
+
+void FrameHistogram::Add(float ms) {
+    if (count_ == WindowSize) {
+        float old = samples_[next_];
+        sum_ -= old;
+        buckets_[bucketOf(old)] --;
+    } else {
+        count_ ++;
+    }
+
+    samples_[next_] = ms;
+    next_ = (next_ + 1) % WindowSize;
+    sum_ += ms;
+    buckets_[bucketOf(ms)] ++;
+    last_ = ms;
+}
+
+void FrameHistogram::Clear() {
+    buckets_.fill(0);
+    next_ = 0;
+    count_ = 0;
+    sum_ = 0;
+    last_ = 0;
+}
+
+float FrameHistogram::Max() const {
+    if (count_ == 0) {
+        return 0;
+    }
+    return *std::max_element(samples_.begin(), samples_.begin() + count_);
+}
+
+float FrameHistogram::Percentile(float p) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    std::vector<float> sorted(samples_.begin(), samples_.begin() + count_);
+    size_t n = static_cast<size_t>(std::clamp(p, 0.0f, 1.0f) * (count_ - 1) + 0.5f);
+    std::nth_element(sorted.begin(), sorted.begin() + n, sorted.end());
+    return sorted[n];
+}
+
+}
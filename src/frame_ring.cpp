@@ -0,0 +1,20 @@
+#include "toy2d/frame_ring.hpp"
+
+namespace toy2d {
+
+uint32_t FrameClock::flightCount_ = 1;
+uint32_t FrameClock::index_ = 0;
+uint64_t FrameClock::number_ = 0;
+
+void FrameClock::Init(uint32_t flightCount) {
+    flightCount_ = flightCount == 0 ? 1 : flightCount;
+    index_ = 0;
+    number_ = 0;
+}
+
+void FrameClock::BeginFrame() {
+    number_ ++;
+    index_ = static_cast<uint32_t>(number_ % flightCount_);
+}
+
+}
@@ -1,9 +1,10 @@
 #include "toy2d/math.hpp"
+#include <cmath>
 
 namespace toy2d {
 
 std::vector<vk::VertexInputAttributeDescription> Vec::GetAttributeDescription() {
-    std::vector<vk::VertexInputAttributeDescription> descriptions(2);
+    std::vector<vk::VertexInputAttributeDescription> descriptions(3);
     descriptions[0].setBinding(0)
                    .setFormat(vk::Format::eR32G32Sfloat)
                    .setLocation(0)
@@ -12,6 +13,10 @@ std::vector<vk::VertexInputAttributeDescription> Vec::GetAttributeDescription()
                    .setFormat(vk::Format::eR32G32Sfloat)
                    .setLocation(1)
                    .setOffset(offsetof(Vertex, texcoord));
+    descriptions[2].setBinding(0)
+                   .setFormat(vk::Format::eR32G32B32Sfloat)
+                   .setLocation(2)
+                   .setOffset(offsetof(Vertex, color));
     return descriptions;
 }
 
@@ -23,6 +28,73 @@ std::vector<vk::VertexInputBindingDescription> Vec::GetBindingDescription() {
     return descriptions;
 }
 
+std::vector<vk::VertexInputAttributeDescription> LineInstance::GetAttributeDescription() {
+    std::vector<vk::VertexInputAttributeDescription> descriptions(7);
+    descriptions[0].setBinding(0)
+                   .setFormat(vk::Format::eR32G32Sfloat)
+                   .setLocation(0)
+                   .setOffset(offsetof(LineInstance, p0));
+    descriptions[1].setBinding(0)
+                   .setFormat(vk::Format::eR32G32Sfloat)
+                   .setLocation(1)
+                   .setOffset(offsetof(LineInstance, p1));
+    descriptions[2].setBinding(0)
+                   .setFormat(vk::Format::eR32G32B32Sfloat)
+                   .setLocation(2)
+                   .setOffset(offsetof(LineInstance, color));
+    descriptions[3].setBinding(0)
+                   .setFormat(vk::Format::eR32Sfloat)
+                   .setLocation(3)
+                   .setOffset(offsetof(LineInstance, width));
+    descriptions[4].setBinding(0)
+                   .setFormat(vk::Format::eR32G32Sfloat)
+                   .setLocation(4)
+                   .setOffset(offsetof(LineInstance, caps));
+    descriptions[5].setBinding(0)
+                   .setFormat(vk::Format::eR32G32Sfloat)
+                   .setLocation(5)
+                   .setOffset(offsetof(LineInstance, prev));
+    descriptions[6].setBinding(0)
+                   .setFormat(vk::Format::eR32G32Sfloat)
+                   .setLocation(6)
+                   .setOffset(offsetof(LineInstance, next));
+    return descriptions;
+}
+
+std::vector<vk::VertexInputBindingDescription> LineInstance::GetBindingDescription() {
+    std::vector<vk::VertexInputBindingDescription> descriptions(1);
+    descriptions[0].setBinding(0)
+                   .setStride(sizeof(LineInstance))
+                   .setInputRate(vk::VertexInputRate::eInstance);
+    return descriptions;
+}
+
+std::vector<vk::VertexInputAttributeDescription> ParticleInstance::GetAttributeDescription() {
+    std::vector<vk::VertexInputAttributeDescription> descriptions(3);
+    // color and alpha as one vec4
+    descriptions[0].setBinding(0)
+                   .setFormat(vk::Format::eR32G32B32A32Sfloat)
+                   .setLocation(0)
+                   .setOffset(offsetof(ParticleInstance, color));
+    descriptions[1].setBinding(0)
+                   .setFormat(vk::Format::eR32G32Sfloat)
+                   .setLocation(1)
+                   .setOffset(offsetof(ParticleInstance, position));
+    descriptions[2].setBinding(0)
+                   .setFormat(vk::Format::eR32Sfloat)
+                   .setLocation(2)
+                   .setOffset(offsetof(ParticleInstance, size));
+    return descriptions;
+}
+
+std::vector<vk::VertexInputBindingDescription> ParticleInstance::GetBindingDescription() {
+    std::vector<vk::VertexInputBindingDescription> descriptions(1);
+    descriptions[0].setBinding(0)
+                   .setStride(sizeof(ParticleInstance))
+                   .setInputRate(vk::VertexInputRate::eInstance);
+    return descriptions;
+}
+
 Mat4 Mat4::Create(const std::initializer_list<float>& initList) {
     Mat4 mat;
     int counter = 0;
@@ -97,4 +169,72 @@ Mat4 Mat4::Mul(const Mat4& m) const {
     return mat;
 }
 
+Transform2D::Transform2D() {
+    data_[0] = 1; data_[1] = 0;
+    data_[2] = 0; data_[3] = 1;
+    data_[4] = 0; data_[5] = 0;
+}
+
+Transform2D Transform2D::CreateIdentity() {
+    return Transform2D{};
+}
+
+Transform2D Transform2D::CreateTranslate(const Vec& pos) {
+    Transform2D t;
+    t.Set(2, 0, pos.x);
+    t.Set(2, 1, pos.y);
+    return t;
+}
+
+Transform2D Transform2D::CreateScale(const Vec& scale) {
+    Transform2D t;
+    t.Set(0, 0, scale.x);
+    t.Set(1, 1, scale.y);
+    return t;
+}
+
+Transform2D Transform2D::CreateRotate(float radians) {
+    Transform2D t;
+    float c = std::cos(radians);
+    float s = std::sin(radians);
+    t.Set(0, 0, c);
+    t.Set(0, 1, s);
+    t.Set(1, 0, -s);
+    t.Set(1, 1, c);
+    return t;
+}
+
+Transform2D Transform2D::Mul(const Transform2D& m) const {
+    Transform2D t;
+    t.data_[0] = data_[0] * m.data_[0] + data_[2] * m.data_[1];
+    t.data_[1] = data_[1] * m.data_[0] + data_[3] * m.data_[1];
+    t.data_[2] = data_[0] * m.data_[2] + data_[2] * m.data_[3];
+    t.data_[3] = data_[1] * m.data_[2] + data_[3] * m.data_[3];
+    t.data_[4] = data_[0] * m.data_[4] + data_[2] * m.data_[5] + data_[4];
+    t.data_[5] = data_[1] * m.data_[4] + data_[3] * m.data_[5] + data_[5];
+    return t;
+}
+
+Transform2D Transform2D::Inverse() const {
+    float det = data_[0] * data_[3] - data_[2] * data_[1];
+    if (det == 0) {
+        return Transform2D{};
+    }
+    float invDet = 1.0f / det;
+
+    Transform2D t;
+    t.data_[0] =  data_[3] * invDet;
+    t.data_[1] = -data_[1] * invDet;
+    t.data_[2] = -data_[2] * invDet;
+    t.data_[3] =  data_[0] * invDet;
+    t.data_[4] = -(t.data_[0] * data_[4] + t.data_[2] * data_[5]);
+    t.data_[5] = -(t.data_[1] * data_[4] + t.data_[3] * data_[5]);
+    return t;
+}
+
+Vec Transform2D::Apply(const Vec& v) const {
+    return Vec{data_[0] * v.x + data_[2] * v.y + data_[4],
+               data_[1] * v.x + data_[3] * v.y + data_[5]};
+}
+
 }
@@ -0,0 +1,252 @@
+#include "toy2d/particles.hpp"
+#include "toy2d/context.hpp"
+#include "toy2d/buffer.hpp"
+#include "toy2d/frame_ring.hpp"
+#include "toy2d/debug_utils.hpp"
+#include "toy2d/tool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <array>
+#include <stdexcept>
+
+namespace toy2d {
+
+// position, velocity, life, lifetime and padding, see particle.comp
+static constexpr size_t ParticleSize = sizeof(float) * 8;
+// VkDrawIndirectCommand followed by the emit counter
+static constexpr size_t IndirectSize = sizeof(vk::DrawIndirectCommand) + sizeof(uint32_t);
+
+ParticleSystem::ParticleSystem(uint32_t capacity, Texture* texture): capacity_(std::max(capacity, 1u)), texture_(texture) {
+    createPipeline();
+    createBuffers();
+    createDescriptorSets();
+}
+
+ParticleSystem::~ParticleSystem() {
+    auto& ctx = Context::Instance();
+
+    // frames in flight may draw the outputs, and the last step may not have been drawn yet
+    auto particles = particles_.release();
+    auto outputs = std::make_shared<std::vector<FrameOutput>>(std::move(outputs_));
+    uint64_t value = lastValue_;
+    auto pool = pool_;
+    auto pipeline = pipeline_;
+    auto layout = layout_;
+    auto setLayout = setLayout_;
+    auto module = module_;
+    auto release = [=]() {
+        auto& ctx = Context::Instance();
+        delete particles;
+        outputs->clear();
+        ctx.device.destroyDescriptorPool(pool);
+        ctx.device.destroyPipeline(pipeline);
+        ctx.device.destroyPipelineLayout(layout);
+        ctx.device.destroyDescriptorSetLayout(setLayout);
+        ctx.device.destroyShaderModule(module);
+    };
+    // once the graphics frames finished, hand it to the compute timeline. It's gone
+    // at shutdown, after waiting for its work
+    ctx.DeferDestroy([=]() {
+        auto& ctx = Context::Instance();
+        if (ctx.computeTimeline) {
+            ctx.computeTimeline->Defer(value, release);
+        } else {
+            release();
+        }
+    });
+}
+
+void ParticleSystem::Update(float dt) {
+    pendingTime_ += dt;
+    pendingEmit_ += emitter.rate * dt;
+}
+
+void ParticleSystem::Burst(uint32_t count) {
+    pendingBurst_ += count;
+}
+
+void ParticleSystem::createPipeline() {
+    auto& device = Context::Instance().device;
+
+    auto source = ReadWholeFile("./particle_comp.spv");
+    vk::ShaderModuleCreateInfo moduleInfo;
+    moduleInfo.codeSize = source.size();
+    moduleInfo.pCode = (std::uint32_t*)source.data();
+    module_ = device.createShaderModule(moduleInfo);
+
+    std::array<vk::DescriptorSetLayoutBinding, 3> bindings;
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].setBinding(i)
+                   .setDescriptorCount(1)
+                   .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                   .setStageFlags(vk::ShaderStageFlagBits::eCompute);
+    }
+    vk::DescriptorSetLayoutCreateInfo setLayoutInfo;
+    setLayoutInfo.setBindings(bindings);
+    setLayout_ = device.createDescriptorSetLayout(setLayoutInfo);
+
+    vk::PushConstantRange range;
+    range.setOffset(0)
+         .setSize(sizeof(Params))
+         .setStageFlags(vk::ShaderStageFlagBits::eCompute);
+    vk::PipelineLayoutCreateInfo layoutInfo;
+    layoutInfo.setSetLayouts(setLayout_)
+              .setPushConstantRanges(range);
+    layout_ = device.createPipelineLayout(layoutInfo);
+
+    vk::PipelineShaderStageCreateInfo stage;
+    stage.setModule(module_)
+         .setPName("main")
+         .setStage(vk::ShaderStageFlagBits::eCompute);
+    vk::ComputePipelineCreateInfo createInfo;
+    createInfo.setStage(stage)
+              .setLayout(layout_);
+    auto result = device.createComputePipeline(nullptr, createInfo);
+    if (result.result != vk::Result::eSuccess) {
+        throw std::runtime_error("create particle pipeline failed");
+    }
+    pipeline_ = result.value;
+    SetDebugName(pipeline_, "particle simulation pipeline");
+}
+
+void ParticleSystem::createBuffers() {
+    auto& ctx = Context::Instance();
+    // the compute queue writes what the graphics queue draws
+    std::vector<uint32_t> families = {ctx.queueInfo.graphicsIndex.value(), ctx.queueInfo.computeIndex.value()};
+
+    particles_.reset(new Buffer(vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eTransferDst,
+                                ParticleSize * capacity_,
+                                vk::MemoryPropertyFlagBits::eDeviceLocal));
+    SetDebugName(particles_->buffer, "particles");
+
+    outputs_.resize(FrameClock::FlightCount());
+    for (auto& output : outputs_) {
+        output.instances.reset(new Buffer(vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eVertexBuffer,
+                                          sizeof(ParticleInstance) * capacity_,
+                                          vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                          families));
+        output.indirect.reset(new Buffer(vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eIndirectBuffer|
+                                         vk::BufferUsageFlagBits::eTransferDst,
+                                         IndirectSize,
+                                         vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                         families));
+        SetDebugName(output.instances->buffer, "particle instances");
+        SetDebugName(output.indirect->buffer, "particle indirect draw");
+    }
+}
+
+void ParticleSystem::createDescriptorSets() {
+    auto& device = Context::Instance().device;
+    uint32_t count = static_cast<uint32_t>(outputs_.size());
+
+    vk::DescriptorPoolSize size;
+    size.setType(vk::DescriptorType::eStorageBuffer)
+        .setDescriptorCount(3 * count);
+    vk::DescriptorPoolCreateInfo poolInfo;
+    poolInfo.setMaxSets(count)
+            .setPoolSizes(size);
+    pool_ = device.createDescriptorPool(poolInfo);
+
+    std::vector<vk::DescriptorSetLayout> layouts(count, setLayout_);
+    vk::DescriptorSetAllocateInfo allocInfo;
+    allocInfo.setDescriptorPool(pool_)
+             .setSetLayouts(layouts);
+    auto sets = device.allocateDescriptorSets(allocInfo);
+
+    for (uint32_t i = 0; i < count; i++) {
+        auto& output = outputs_[i];
+        output.set = sets[i];
+
+        std::array<vk::DescriptorBufferInfo, 3> infos;
+        infos[0].setBuffer(particles_->buffer).setOffset(0).setRange(VK_WHOLE_SIZE);
+        infos[1].setBuffer(output.instances->buffer).setOffset(0).setRange(VK_WHOLE_SIZE);
+        infos[2].setBuffer(output.indirect->buffer).setOffset(0).setRange(VK_WHOLE_SIZE);
+
+        std::array<vk::WriteDescriptorSet, 3> writes;
+        for (uint32_t binding = 0; binding < writes.size(); binding++) {
+            writes[binding].setDstSet(output.set)
+                           .setDstBinding(binding)
+                           .setDstArrayElement(0)
+                           .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                           .setBufferInfo(infos[binding]);
+        }
+        device.updateDescriptorSets(writes, {});
+    }
+}
+
+const ParticleSystem::FrameOutput& ParticleSystem::currentOutput() const {
+    return outputs_[FrameClock::Index()];
+}
+
+uint64_t ParticleSystem::simulate() {
+    if (lastFrame_ == FrameClock::Number()) {
+        return lastValue_;
+    }
+    auto& ctx = Context::Instance();
+    auto& output = currentOutput();
+
+    float emit = std::floor(pendingEmit_);
+    pendingEmit_ -= emit;
+    uint64_t emitCount = static_cast<uint64_t>(emit) + pendingBurst_;
+    pendingBurst_ = 0;
+
+    Params params;
+    params.startColor[0] = emitter.startColor.r;
+    params.startColor[1] = emitter.startColor.g;
+    params.startColor[2] = emitter.startColor.b;
+    params.startColor[3] = emitter.startAlpha;
+    params.endColor[0] = emitter.endColor.r;
+    params.endColor[1] = emitter.endColor.g;
+    params.endColor[2] = emitter.endColor.b;
+    params.endColor[3] = emitter.endAlpha;
+    params.position = emitter.position;
+    params.area = emitter.area;
+    params.velocity = emitter.velocity;
+    params.gravity = emitter.gravity;
+    params.dt = std::min(pendingTime_, MaxStep);
+    params.lifetime = emitter.lifetime;
+    params.lifetimeVariance = emitter.lifetimeVariance;
+    params.spread = emitter.spread;
+    params.speedVariance = emitter.speedVariance;
+    params.drag = emitter.drag;
+    params.startSize = emitter.startSize;
+    params.endSize = emitter.endSize;
+    params.emitCount = static_cast<uint32_t>(std::min<uint64_t>(emitCount, capacity_));
+    params.seed = seed_++;
+    params.capacity = capacity_;
+    pendingTime_ = 0;
+
+    // 4 strip vertices per particle, no instance yet, nothing emitted yet
+    uint32_t header[] = {4, 0, 0, 0, 0};
+    bool clear = !cleared_;
+    cleared_ = true;
+
+    // the slot of this frame was last read by the frame FlightCount() frames ago,
+    // which StartRender waited for
+    lastValue_ = ctx.computeCommandManager->SubmitCmd(*ctx.computeTimeline, [&](vk::CommandBuffer& cmd) {
+        BeginDebugLabel(cmd, "particles");
+        if (clear) {
+            // all particles dead
+            cmd.fillBuffer(particles_->buffer, 0, VK_WHOLE_SIZE, 0);
+        }
+        cmd.updateBuffer(output.indirect->buffer, 0, sizeof(header), header);
+
+        // also orders this step after the previous one, which wrote the particles
+        vk::MemoryBarrier barrier;
+        barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite|vk::AccessFlagBits::eShaderWrite)
+               .setDstAccessMask(vk::AccessFlagBits::eShaderRead|vk::AccessFlagBits::eShaderWrite);
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer|vk::PipelineStageFlagBits::eComputeShader,
+                            vk::PipelineStageFlagBits::eComputeShader,
+                            {}, barrier, nullptr, nullptr);
+
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline_);
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, layout_, 0, output.set, {});
+        cmd.pushConstants(layout_, vk::ShaderStageFlagBits::eCompute, 0, sizeof(Params), &params);
+        cmd.dispatch((capacity_ + WorkgroupSize - 1) / WorkgroupSize, 1, 1);
+        EndDebugLabel(cmd);
+    });
+    lastFrame_ = FrameClock::Number();
+    return lastValue_;
+}
+
+}
@@ -0,0 +1,106 @@
+#include "toy2d/readback.hpp"
+#include "toy2d/context.hpp"
+#include "toy2d/buffer.hpp"
+
+namespace toy2d {
+
+void ReadbackResult::CopyTo(void* dst, size_t dstRowPitch) const {
+    auto out = static_cast<uint8_t*>(dst);
+    for (uint32_t row = 0; row < height; row++) {
+        memcpy(out + row * dstRowPitch, data_ + row * RowPitch(), RowPitch());
+    }
+}
+
+ReadbackRing::~ReadbackRing() {
+    // pending callbacks point to this ring
+    if (timeline_) {
+        timeline_->WaitIdle();
+        timeline_->Collect();
+    }
+}
+
+size_t ReadbackRing::acquireSlot(vk::DeviceSize size) {
+    size_t best = slots_.size();
+    for (size_t i = 0; i < slots_.size(); i++) {
+        auto& slot = slots_[i];
+        if (!slot.busy && slot.buffer->size >= size &&
+            (best == slots_.size() || slot.buffer->size < slots_[best].buffer->size)) {
+            best = i;
+        }
+    }
+
+    if (best == slots_.size()) {
+        // host cached memory makes reading the result on the CPU fast
+        Slot slot;
+        slot.buffer.reset(new Buffer(vk::BufferUsageFlagBits::eTransferDst,
+                                     size,
+                                     vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCached));
+        slots_.push_back(std::move(slot));
+    }
+    slots_[best].busy = true;
+    return best;
+}
+
+void ReadbackRing::Record(vk::CommandBuffer cmd, vk::Image image, vk::Format format,
+                          const ReadbackRegion& region, ReadbackCallback callback) {
+    vk::DeviceSize size = static_cast<vk::DeviceSize>(region.width) * region.height * 4;
+    size_t slot = acquireSlot(size);
+    auto& buffer = *slots_[slot].buffer;
+
+    vk::ImageSubresourceLayers subsource;
+    subsource.setAspectMask(vk::ImageAspectFlagBits::eColor)
+             .setBaseArrayLayer(0)
+             .setMipLevel(0)
+             .setLayerCount(1);
+    vk::BufferImageCopy copy;
+    copy.setBufferOffset(0)
+        .setBufferRowLength(0)
+        .setBufferImageHeight(0)
+        .setImageSubresource(subsource)
+        .setImageOffset({static_cast<int32_t>(region.x), static_cast<int32_t>(region.y), 0})
+        .setImageExtent({region.width, region.height, 1});
+    cmd.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal, buffer.buffer, copy);
+
+    vk::BufferMemoryBarrier barrier;
+    barrier.setBuffer(buffer.buffer)
+           .setOffset(0)
+           .setSize(size)
+           .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+           .setDstAccessMask(vk::AccessFlagBits::eHostRead)
+           .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+           .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+                        {}, {}, barrier, nullptr);
+
+    Recorded recorded;
+    recorded.slot = slot;
+    recorded.result.width = region.width;
+    recorded.result.height = region.height;
+    recorded.result.format = format;
+    recorded.result.data_ = static_cast<const uint8_t*>(buffer.map);
+    recorded.callback = std::move(callback);
+    recorded_.push_back(std::move(recorded));
+}
+
+void ReadbackRing::Submitted(Timeline& timeline, uint64_t value) {
+    timeline_ = &timeline;
+    for (auto& recorded : recorded_) {
+        timeline.Defer(value, [this, recorded]() { complete(recorded); });
+    }
+    recorded_.clear();
+}
+
+void ReadbackRing::complete(const Recorded& recorded) {
+    auto& slot = slots_[recorded.slot];
+
+    // host cached memory may not be coherent
+    auto& device = Context::Instance().device;
+    device.invalidateMappedMemoryRanges(vk::MappedMemoryRange(slot.buffer->memory, 0, VK_WHOLE_SIZE));
+
+    if (recorded.callback) {
+        recorded.callback(recorded.result);
+    }
+    slot.busy = false;
+}
+
+}
@@ -0,0 +1,421 @@
+#include "toy2d/render_graph.hpp"
+#include "toy2d/context.hpp"
+#include "toy2d/buffer.hpp"
+#include "toy2d/debug_utils.hpp"
+#include <algorithm>
+
+namespace toy2d {
+
+RenderGraph::RenderGraph() {
+    // slot 0 is the swapchain image
+    resources_.emplace_back();
+    resources_[BackbufferID].name = "backbuffer";
+    resources_[BackbufferID].output = true;
+}
+
+RenderGraph::~RenderGraph() {
+    release();
+    if (clearRenderPass_) {
+        auto clearRenderPass = clearRenderPass_;
+        auto loadRenderPass = loadRenderPass_;
+        Context::Instance().DeferDestroy([=]() {
+            auto& device = Context::Instance().device;
+            device.destroyRenderPass(clearRenderPass);
+            device.destroyRenderPass(loadRenderPass);
+        });
+    }
+}
+
+RenderGraph::ResourceID RenderGraph::CreateImage(const std::string& name, const ImageDesc& desc) {
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resources_.push_back(std::move(resource));
+    compiled_ = false;
+    return static_cast<ResourceID>(resources_.size() - 1);
+}
+
+void RenderGraph::MarkOutput(ResourceID id) {
+    resources_.at(id).output = true;
+    compiled_ = false;
+}
+
+void RenderGraph::AddPass(const std::string& name, const std::vector<ResourceID>& reads, ResourceID write, ExecuteFunc func) {
+    for (auto read : reads) {
+        if (read == BackbufferID || read >= resources_.size()) {
+            throw std::runtime_error("render graph pass " + name + " reads an invalid resource");
+        }
+    }
+    if (write >= resources_.size()) {
+        throw std::runtime_error("render graph pass " + name + " writes an invalid resource");
+    }
+
+    Pass pass;
+    pass.name = name;
+    pass.reads = reads;
+    pass.write = write;
+    pass.func = std::move(func);
+    passes_.push_back(std::move(pass));
+    compiled_ = false;
+}
+
+Texture& RenderGraph::GetTexture(ResourceID id) {
+    auto& texture = resources_.at(id).texture;
+    if (!texture) {
+        throw std::runtime_error("render graph resource " + resources_[id].name + " has no texture, is the graph compiled?");
+    }
+    return *texture;
+}
+
+void RenderGraph::Compile() {
+    if (!clearRenderPass_) {
+        clearRenderPass_ = createRenderPass(vk::AttachmentLoadOp::eClear);
+        loadRenderPass_ = createRenderPass(vk::AttachmentLoadOp::eLoad);
+    }
+
+    release();
+
+    stats_ = Stats{};
+    cullPasses();
+    computeLifetimes();
+    createImages();
+    aliasMemory();
+    createViewsAndFramebuffers();
+    computeBarriers();
+
+    compiledExtent_ = Context::Instance().swapchain->GetExtent();
+    compiled_ = true;
+}
+
+void RenderGraph::release() {
+    // frames in flight may still use the images, they are destroyed once those finished
+    std::vector<Texture*> textures;
+    std::vector<vk::Framebuffer> framebuffers;
+    std::vector<vk::ImageView> views;
+    std::vector<vk::Image> images;
+    std::vector<vk::DeviceMemory> memories;
+    for (auto& resource : resources_) {
+        if (resource.texture) {
+            textures.push_back(resource.texture.release());
+        }
+        if (resource.framebuffer) {
+            framebuffers.push_back(resource.framebuffer);
+        }
+        if (resource.view) {
+            views.push_back(resource.view);
+        }
+        if (resource.image) {
+            images.push_back(resource.image);
+        }
+        resource.framebuffer = nullptr;
+        resource.view = nullptr;
+        resource.image = nullptr;
+        resource.memoryBlock = -1;
+        resource.firstUse = -1;
+        resource.lastUse = -1;
+    }
+    for (auto& block : memoryBlocks_) {
+        memories.push_back(block.memory);
+    }
+    memoryBlocks_.clear();
+    compiled_ = false;
+
+    if (textures.empty() && framebuffers.empty() && images.empty() && memories.empty()) {
+        return;
+    }
+    Context::Instance().DeferDestroy([=]() {
+        auto& device = Context::Instance().device;
+        for (auto texture : textures) {
+            delete texture;
+        }
+        for (auto framebuffer : framebuffers) {
+            device.destroyFramebuffer(framebuffer);
+        }
+        for (auto view : views) {
+            device.destroyImageView(view);
+        }
+        for (auto image : images) {
+            device.destroyImage(image);
+        }
+        for (auto memory : memories) {
+            device.freeMemory(memory);
+        }
+    });
+}
+
+void RenderGraph::cullPasses() {
+    std::vector<bool> needed(resources_.size(), false);
+    for (size_t i = 0; i < resources_.size(); i++) {
+        needed[i] = resources_[i].output;
+    }
+
+    for (int i = static_cast<int>(passes_.size()) - 1; i >= 0; i--) {
+        auto& pass = passes_[i];
+        pass.culled = !needed[pass.write];
+        if (pass.culled) {
+            stats_.culledPassCount ++;
+            continue;
+        }
+        for (auto read : pass.reads) {
+            needed[read] = true;
+        }
+    }
+    stats_.passCount = static_cast<uint32_t>(passes_.size()) - stats_.culledPassCount;
+}
+
+void RenderGraph::computeLifetimes() {
+    auto use = [&](ResourceID id, int passIndex) {
+        auto& resource = resources_[id];
+        if (resource.firstUse < 0) {
+            resource.firstUse = passIndex;
+        }
+        resource.lastUse = std::max(resource.lastUse, passIndex);
+    };
+
+    for (int i = 0; i < static_cast<int>(passes_.size()); i++) {
+        auto& pass = passes_[i];
+        if (pass.culled) {
+            continue;
+        }
+        for (auto read : pass.reads) {
+            use(read, i);
+        }
+        use(pass.write, i);
+    }
+
+    for (auto& resource : resources_) {
+        if (resource.output && resource.firstUse >= 0) {
+            resource.lastUse = static_cast<int>(passes_.size());
+        }
+    }
+}
+
+void RenderGraph::createImages() {
+    auto& ctx = Context::Instance();
+    auto swapchainExtent = ctx.swapchain->GetExtent();
+
+    for (size_t i = BackbufferID + 1; i < resources_.size(); i++) {
+        auto& resource = resources_[i];
+        if (resource.firstUse < 0) {
+            continue;
+        }
+
+        resource.extent.width = std::max<uint32_t>(1, static_cast<uint32_t>(swapchainExtent.width * resource.desc.scale));
+        resource.extent.height = std::max<uint32_t>(1, static_cast<uint32_t>(swapchainExtent.height * resource.desc.scale));
+
+        vk::ImageCreateInfo createInfo;
+        createInfo.setImageType(vk::ImageType::e2D)
+                  .setArrayLayers(1)
+                  .setMipLevels(1)
+                  .setExtent({resource.extent.width, resource.extent.height, 1})
+                  .setFormat(ctx.swapchain->GetFormat().format)
+                  .setTiling(vk::ImageTiling::eOptimal)
+                  .setInitialLayout(vk::ImageLayout::eUndefined)
+                  .setUsage(vk::ImageUsageFlagBits::eColorAttachment|vk::ImageUsageFlagBits::eSampled|vk::ImageUsageFlagBits::eTransferSrc)
+                  .setSamples(vk::SampleCountFlagBits::e1);
+        resource.image = ctx.device.createImage(createInfo);
+        SetDebugName(resource.image, resource.name);
+        resource.requirements = ctx.device.getImageMemoryRequirements(resource.image);
+
+        stats_.imageCount ++;
+        stats_.unaliasedMemorySize += resource.requirements.size;
+    }
+}
+
+void RenderGraph::aliasMemory() {
+    auto& device = Context::Instance().device;
+
+    std::vector<Resource*> sorted;
+    for (auto& resource : resources_) {
+        if (resource.image) {
+            sorted.push_back(&resource);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const Resource* a, const Resource* b) {
+                  return a->firstUse < b->firstUse;
+              });
+
+    // greedy interval packing: reuse a block whose last user finished before this image is first used
+    for (auto resource : sorted) {
+        auto& requirements = resource->requirements;
+        int found = -1;
+        for (size_t i = 0; i < memoryBlocks_.size(); i++) {
+            auto& block = memoryBlocks_[i];
+            if (block.lastUse < resource->firstUse && (block.typeBits & requirements.memoryTypeBits)) {
+                found = static_cast<int>(i);
+                break;
+            }
+        }
+
+        if (found < 0) {
+            memoryBlocks_.push_back({nullptr, 0, requirements.memoryTypeBits, -1});
+            found = static_cast<int>(memoryBlocks_.size() - 1);
+        }
+
+        auto& block = memoryBlocks_[found];
+        block.size = std::max(block.size, requirements.size);
+        block.typeBits &= requirements.memoryTypeBits;
+        block.lastUse = resource->lastUse;
+        resource->memoryBlock = found;
+    }
+
+    for (auto& block : memoryBlocks_) {
+        vk::MemoryAllocateInfo allocInfo;
+        allocInfo.setAllocationSize(block.size)
+                 .setMemoryTypeIndex(QueryBufferMemTypeIndex(block.typeBits, vk::MemoryPropertyFlagBits::eDeviceLocal));
+        block.memory = device.allocateMemory(allocInfo);
+
+        stats_.memoryBlockCount ++;
+        stats_.memorySize += block.size;
+    }
+
+    for (auto resource : sorted) {
+        device.bindImageMemory(resource->image, memoryBlocks_[resource->memoryBlock].memory, 0);
+    }
+}
+
+void RenderGraph::createViewsAndFramebuffers() {
+    auto& ctx = Context::Instance();
+
+    for (auto& resource : resources_) {
+        if (!resource.image) {
+            continue;
+        }
+
+        vk::ImageSubresourceRange range;
+        range.setAspectMask(vk::ImageAspectFlagBits::eColor)
+             .setBaseArrayLayer(0)
+             .setLayerCount(1)
+             .setBaseMipLevel(0)
+             .setLevelCount(1);
+        vk::ImageViewCreateInfo viewCreateInfo;
+        viewCreateInfo.setImage(resource.image)
+                      .setViewType(vk::ImageViewType::e2D)
+                      .setFormat(ctx.swapchain->GetFormat().format)
+                      .setComponents(vk::ComponentMapping{})
+                      .setSubresourceRange(range);
+        resource.view = ctx.device.createImageView(viewCreateInfo);
+
+        // framebuffers are usable with both render passes since they are compatible
+        vk::FramebufferCreateInfo fbCreateInfo;
+        fbCreateInfo.setAttachments(resource.view)
+                    .setLayers(1)
+                    .setWidth(resource.extent.width)
+                    .setHeight(resource.extent.height)
+                    .setRenderPass(clearRenderPass_);
+        resource.framebuffer = ctx.device.createFramebuffer(fbCreateInfo);
+        SetDebugName(resource.framebuffer, resource.name);
+
+        resource.texture.reset(new Texture(resource.view, resource.extent.width, resource.extent.height));
+    }
+}
+
+void RenderGraph::computeBarriers() {
+    struct State {
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+        // aliased memory may still be read by the previous owner
+        vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eFragmentShader|vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        vk::AccessFlags access;
+        bool written = false;
+    };
+    std::vector<State> states(resources_.size());
+
+    auto transition = [&](Pass& pass, ResourceID id, vk::ImageLayout layout,
+                          vk::PipelineStageFlags stages, vk::AccessFlags access) {
+        auto& state = states[id];
+
+        vk::ImageSubresourceRange range;
+        range.setAspectMask(vk::ImageAspectFlagBits::eColor)
+             .setBaseArrayLayer(0)
+             .setLayerCount(1)
+             .setBaseMipLevel(0)
+             .setLevelCount(1);
+        vk::ImageMemoryBarrier barrier;
+        barrier.setImage(resources_[id].image)
+               .setOldLayout(state.layout)
+               .setNewLayout(layout)
+               .setSrcAccessMask(state.access)
+               .setDstAccessMask(access)
+               .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+               .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+               .setSubresourceRange(range);
+        pass.barriers.push_back(barrier);
+        pass.srcStages |= state.stages;
+        pass.dstStages |= stages;
+
+        state.layout = layout;
+        state.stages = stages;
+        state.access = access;
+    };
+
+    for (auto& pass : passes_) {
+        pass.barriers.clear();
+        pass.srcStages = vk::PipelineStageFlags{};
+        pass.dstStages = vk::PipelineStageFlags{};
+        if (pass.culled) {
+            continue;
+        }
+
+        for (auto read : pass.reads) {
+            if (!states[read].written) {
+                throw std::runtime_error("render graph pass " + pass.name + " reads " + resources_[read].name + " before it is written");
+            }
+            if (states[read].layout != vk::ImageLayout::eShaderReadOnlyOptimal) {
+                transition(pass, read, vk::ImageLayout::eShaderReadOnlyOptimal,
+                           vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead);
+            }
+        }
+
+        auto& writeState = states[pass.write];
+        if (pass.write == BackbufferID) {
+            // the swapchain render pass clears and transitions the image itself
+            if (writeState.written) {
+                throw std::runtime_error("render graph pass " + pass.name + " writes the backbuffer twice");
+            }
+            pass.clearTarget = true;
+        } else {
+            pass.clearTarget = !writeState.written;
+            transition(pass, pass.write, vk::ImageLayout::eColorAttachmentOptimal,
+                       vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                       vk::AccessFlagBits::eColorAttachmentRead|vk::AccessFlagBits::eColorAttachmentWrite);
+        }
+        writeState.written = true;
+    }
+
+    for (size_t i = BackbufferID + 1; i < resources_.size(); i++) {
+        resources_[i].finalLayout = states[i].layout;
+        resources_[i].finalStages = states[i].stages;
+        resources_[i].finalAccess = states[i].access;
+    }
+}
+
+vk::RenderPass RenderGraph::createRenderPass(vk::AttachmentLoadOp loadOp) {
+    auto& ctx = Context::Instance();
+
+    // layout transitions are done by the barriers of each pass
+    vk::AttachmentDescription attachDescription;
+    attachDescription.setFormat(ctx.swapchain->GetFormat().format)
+                     .setSamples(vk::SampleCountFlagBits::e1)
+                     .setLoadOp(loadOp)
+                     .setStoreOp(vk::AttachmentStoreOp::eStore)
+                     .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+                     .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+                     .setInitialLayout(vk::ImageLayout::eColorAttachmentOptimal)
+                     .setFinalLayout(vk::ImageLayout::eColorAttachmentOptimal);
+    vk::AttachmentReference reference;
+    reference.setAttachment(0)
+             .setLayout(vk::ImageLayout::eColorAttachmentOptimal);
+
+    vk::SubpassDescription subpassDesc;
+    subpassDesc.setColorAttachments(reference)
+               .setPipelineBindPoint(vk::PipelineBindPoint::eGraphics);
+
+    vk::RenderPassCreateInfo createInfo;
+    createInfo.setAttachments(attachDescription)
+              .setSubpasses(subpassDesc);
+
+    return ctx.device.createRenderPass(createInfo);
+}
+
+}
@@ -2,6 +2,7 @@
 #include "toy2d/context.hpp"
 #include "toy2d/swapchain.hpp"
 #include "toy2d/math.hpp"
+#include "toy2d/debug_utils.hpp"
 
 namespace toy2d {
 
@@ -19,11 +20,35 @@ RenderProcess::~RenderProcess() {
     device.destroyPipelineLayout(layout);
     device.destroyPipeline(graphicsPipelineWithTriangleTopology);
     device.destroyPipeline(graphicsPipelineWithLineTopology);
+    device.destroyPipeline(thickLinePipeline);
+    device.destroyPipeline(textPipeline);
+    device.destroyPipeline(particlePipeline);
 }
 
-void RenderProcess::CreateGraphicsPipeline(const Shader& shader) {
-    graphicsPipelineWithTriangleTopology = createGraphicsPipeline(shader, vk::PrimitiveTopology::eTriangleList);
-    graphicsPipelineWithLineTopology = createGraphicsPipeline(shader, vk::PrimitiveTopology::eLineList);
+void RenderProcess::CreateGraphicsPipeline(const Shader& shader, const Shader& lineShader, const Shader& textShader,
+                                           const Shader& particleShader) {
+    auto bindings = Vec::GetBindingDescription();
+    auto attributes = Vec::GetAttributeDescription();
+    graphicsPipelineWithTriangleTopology = createGraphicsPipeline(shader, vk::PrimitiveTopology::eTriangleList,
+                                                                  bindings, attributes, vk::CullModeFlagBits::eFront);
+    graphicsPipelineWithLineTopology = createGraphicsPipeline(shader, vk::PrimitiveTopology::eLineList,
+                                                              bindings, attributes, vk::CullModeFlagBits::eFront);
+    // the quad winding depends on the segment direction, so nothing is culled
+    thickLinePipeline = createGraphicsPipeline(lineShader, vk::PrimitiveTopology::eTriangleStrip,
+                                               LineInstance::GetBindingDescription(),
+                                               LineInstance::GetAttributeDescription(),
+                                               vk::CullModeFlagBits::eNone);
+    textPipeline = createGraphicsPipeline(textShader, vk::PrimitiveTopology::eTriangleList,
+                                          bindings, attributes, vk::CullModeFlagBits::eFront);
+    particlePipeline = createGraphicsPipeline(particleShader, vk::PrimitiveTopology::eTriangleStrip,
+                                              ParticleInstance::GetBindingDescription(),
+                                              ParticleInstance::GetAttributeDescription(),
+                                              vk::CullModeFlagBits::eNone);
+    SetDebugName(graphicsPipelineWithTriangleTopology, "triangle pipeline");
+    SetDebugName(graphicsPipelineWithLineTopology, "line pipeline");
+    SetDebugName(thickLinePipeline, "thick line pipeline");
+    SetDebugName(textPipeline, "text pipeline");
+    SetDebugName(particlePipeline, "particle pipeline");
 }
 
 void RenderProcess::CreateRenderPass() {
@@ -39,7 +64,10 @@ vk::PipelineLayout RenderProcess::createLayout() {
     return Context::Instance().device.createPipelineLayout(createInfo);
 }
 
-vk::Pipeline RenderProcess::createGraphicsPipeline(const Shader& shader, vk::PrimitiveTopology topology) {
+vk::Pipeline RenderProcess::createGraphicsPipeline(const Shader& shader, vk::PrimitiveTopology topology,
+                                                   const std::vector<vk::VertexInputBindingDescription>& bindingDesc,
+                                                   const std::vector<vk::VertexInputAttributeDescription>& attributeDesc,
+                                                   vk::CullModeFlags cullMode) {
     auto& ctx = Context::Instance();
 
     vk::GraphicsPipelineCreateInfo createInfo;
@@ -55,8 +83,6 @@ vk::Pipeline RenderProcess::createGraphicsPipeline(const Shader& shader, vk::Pri
 
     // 1. vertex input
     vk::PipelineVertexInputStateCreateInfo vertexInputCreateInfo;
-    auto attributeDesc = Vec::GetAttributeDescription();
-    auto bindingDesc = Vec::GetBindingDescription();
     vertexInputCreateInfo.setVertexAttributeDescriptions(attributeDesc)
                          .setVertexBindingDescriptions(bindingDesc);
 
@@ -66,15 +92,17 @@ vk::Pipeline RenderProcess::createGraphicsPipeline(const Shader& shader, vk::Pri
                       .setTopology(topology);
 
     // 3. viewport and scissor
+    // they are dynamic so the pipelines can render into targets of any size
     vk::PipelineViewportStateCreateInfo viewportInfo;
-    vk::Viewport viewport(0, 0, ctx.swapchain->GetExtent().width, ctx.swapchain->GetExtent().height, 0, 1);
-    vk::Rect2D scissor(vk::Rect2D({0, 0}, ctx.swapchain->GetExtent()));
-    viewportInfo.setViewports(viewport)
-                .setScissors(scissor);
+    viewportInfo.setViewportCount(1)
+                .setScissorCount(1);
+    std::array dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+    vk::PipelineDynamicStateCreateInfo dynamicInfo;
+    dynamicInfo.setDynamicStates(dynamicStates);
 
     // 4. rasteraizer
     vk::PipelineRasterizationStateCreateInfo rasterInfo;
-    rasterInfo.setCullMode(vk::CullModeFlagBits::eFront)
+    rasterInfo.setCullMode(cullMode)
               .setFrontFace(vk::FrontFace::eCounterClockwise)
               .setDepthClampEnable(false)
               .setLineWidth(1)
@@ -123,6 +151,7 @@ vk::Pipeline RenderProcess::createGraphicsPipeline(const Shader& shader, vk::Pri
               .setPRasterizationState(&rasterInfo)
               .setPMultisampleState(&multisampleInfo)
               .setPColorBlendState(&blendInfo)
+              .setPDynamicState(&dynamicInfo)
               .setRenderPass(renderPass);
 
     auto result = ctx.device.createGraphicsPipeline(pipelineCache_, createInfo);
@@ -0,0 +1,146 @@
+#include "toy2d/render_target.hpp"
+#include "toy2d/context.hpp"
+#include "toy2d/buffer.hpp"
+#include "toy2d/debug_utils.hpp"
+#include <algorithm>
+#include <array>
+
+namespace toy2d {
+
+RenderTarget::RenderTarget(uint32_t width, uint32_t height): width_(std::max(width, 1u)), height_(std::max(height, 1u)) {
+    SetProject(width_, 0, 0, height_, -1, 1);
+    SetClearColor(Color{0, 0, 0});
+    clearRenderPass_ = createRenderPass(vk::AttachmentLoadOp::eClear);
+    loadRenderPass_ = createRenderPass(vk::AttachmentLoadOp::eLoad);
+    createImage();
+    createViewAndFramebuffer();
+}
+
+RenderTarget::~RenderTarget() {
+    // frames in flight may still render into or sample the target
+    auto texture = texture_.release();
+    auto image = image_;
+    auto memory = memory_;
+    auto view = view_;
+    auto framebuffer = framebuffer_;
+    auto clearRenderPass = clearRenderPass_;
+    auto loadRenderPass = loadRenderPass_;
+    Context::Instance().DeferDestroy([=]() {
+        auto& device = Context::Instance().device;
+        delete texture;
+        device.destroyFramebuffer(framebuffer);
+        device.destroyImageView(view);
+        device.destroyImage(image);
+        device.freeMemory(memory);
+        device.destroyRenderPass(clearRenderPass);
+        device.destroyRenderPass(loadRenderPass);
+    });
+}
+
+void RenderTarget::SetProject(int right, int left, int bottom, int top, int far, int near) {
+    project_ = Mat4::CreateOrtho(left, right, top, bottom, near, far);
+}
+
+void RenderTarget::SetClearColor(const Color& color, float alpha) {
+    clearColor_ = vk::ClearColorValue(std::array<float, 4>{color.r, color.g, color.b, alpha});
+}
+
+void RenderTarget::createImage() {
+    auto& ctx = Context::Instance();
+
+    vk::ImageCreateInfo createInfo;
+    createInfo.setImageType(vk::ImageType::e2D)
+              .setArrayLayers(1)
+              .setMipLevels(1)
+              .setExtent({width_, height_, 1})
+              .setFormat(ctx.swapchain->GetFormat().format)
+              .setTiling(vk::ImageTiling::eOptimal)
+              .setInitialLayout(vk::ImageLayout::eUndefined)
+              .setUsage(vk::ImageUsageFlagBits::eColorAttachment|vk::ImageUsageFlagBits::eSampled|
+                        vk::ImageUsageFlagBits::eTransferSrc)
+              .setSamples(vk::SampleCountFlagBits::e1);
+    image_ = ctx.device.createImage(createInfo);
+    SetDebugName(image_, "render target");
+
+    auto requirements = ctx.device.getImageMemoryRequirements(image_);
+    vk::MemoryAllocateInfo allocInfo;
+    allocInfo.setAllocationSize(requirements.size)
+             .setMemoryTypeIndex(QueryBufferMemTypeIndex(requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal));
+    memory_ = ctx.device.allocateMemory(allocInfo);
+    ctx.device.bindImageMemory(image_, memory_, 0);
+}
+
+void RenderTarget::createViewAndFramebuffer() {
+    auto& ctx = Context::Instance();
+
+    vk::ImageSubresourceRange range;
+    range.setAspectMask(vk::ImageAspectFlagBits::eColor)
+         .setBaseArrayLayer(0)
+         .setLayerCount(1)
+         .setBaseMipLevel(0)
+         .setLevelCount(1);
+    vk::ImageViewCreateInfo viewCreateInfo;
+    viewCreateInfo.setImage(image_)
+                  .setViewType(vk::ImageViewType::e2D)
+                  .setFormat(ctx.swapchain->GetFormat().format)
+                  .setComponents(vk::ComponentMapping{})
+                  .setSubresourceRange(range);
+    view_ = ctx.device.createImageView(viewCreateInfo);
+
+    // compatible with both render passes
+    vk::FramebufferCreateInfo fbCreateInfo;
+    fbCreateInfo.setAttachments(view_)
+                .setLayers(1)
+                .setWidth(width_)
+                .setHeight(height_)
+                .setRenderPass(clearRenderPass_);
+    framebuffer_ = ctx.device.createFramebuffer(fbCreateInfo);
+
+    texture_.reset(new Texture(view_, width_, height_));
+}
+
+vk::RenderPass RenderTarget::createRenderPass(vk::AttachmentLoadOp loadOp) {
+    auto& ctx = Context::Instance();
+
+    // the target is sampled between renderings, a cleared one doesn't care about its old content
+    vk::AttachmentDescription attachDescription;
+    attachDescription.setFormat(ctx.swapchain->GetFormat().format)
+                     .setSamples(vk::SampleCountFlagBits::e1)
+                     .setLoadOp(loadOp)
+                     .setStoreOp(vk::AttachmentStoreOp::eStore)
+                     .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+                     .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+                     .setInitialLayout(loadOp == vk::AttachmentLoadOp::eLoad ? vk::ImageLayout::eShaderReadOnlyOptimal
+                                                                             : vk::ImageLayout::eUndefined)
+                     .setFinalLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+    vk::AttachmentReference reference;
+    reference.setAttachment(0)
+             .setLayout(vk::ImageLayout::eColorAttachmentOptimal);
+
+    vk::SubpassDescription subpassDesc;
+    subpassDesc.setColorAttachments(reference)
+               .setPipelineBindPoint(vk::PipelineBindPoint::eGraphics);
+
+    // wait for earlier draws sampling the target, and make the result visible to later ones
+    std::array<vk::SubpassDependency, 2> dependencies;
+    dependencies[0].setSrcSubpass(VK_SUBPASS_EXTERNAL)
+                   .setDstSubpass(0)
+                   .setSrcStageMask(vk::PipelineStageFlagBits::eFragmentShader)
+                   .setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+                   .setDstAccessMask(vk::AccessFlagBits::eColorAttachmentRead|vk::AccessFlagBits::eColorAttachmentWrite);
+    dependencies[1].setSrcSubpass(0)
+                   .setDstSubpass(VK_SUBPASS_EXTERNAL)
+                   .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+                   .setDstStageMask(vk::PipelineStageFlagBits::eFragmentShader)
+                   .setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite)
+                   .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+
+    vk::RenderPassCreateInfo createInfo;
+    createInfo.setAttachments(attachDescription)
+              .setSubpasses(subpassDesc)
+              .setDependencies(dependencies);
+
+    return ctx.device.createRenderPass(createInfo);
+}
+
+}
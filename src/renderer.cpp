@@ -1,19 +1,25 @@
 #include "toy2d/renderer.hpp"
 #include "toy2d/math.hpp"
 #include "toy2d/context.hpp"
+#include <thread>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
 
 namespace toy2d {
 
-Renderer::Renderer(int maxFlightCount): maxFlightCount_(maxFlightCount), curFrame_(0) {
-    createFences();
-    createSemaphores();
-    createCmdBuffers();
+Renderer::Renderer() {
+    windowWidth_ = Context::Instance().swapchain->GetExtent().width;
+    windowHeight_ = Context::Instance().swapchain->GetExtent().height;
     createBuffers();
-    createUniformBuffers(maxFlightCount);
-    descriptorSets_ = DescriptorSetManager::Instance().AllocBufferSets(maxFlightCount);
-    updateDescriptorSets();
+    bufferRectData();
+    auto alignment = Context::Instance().phyDevice.getProperties().limits.minUniformBufferOffsetAlignment;
+    uniformStride_ = (sizeof(Mat4) * 2 + alignment - 1) / alignment * alignment;
+    frames_.Init([this](uint32_t index) { return createFrame(index); },
+                 [this](FrameData& frame) { resetFrame(frame); });
     initMats();
     createWhiteTexture();
+    createTimestampPool();
 
     SetDrawColor(Color{1, 1, 1});
 }
@@ -23,151 +29,1387 @@ Renderer::~Renderer() {
     device.destroySampler(sampler);
     rectVerticesBuffer_.reset();
     rectIndicesBuffer_.reset();
-    uniformBuffers_.clear();
-    for (auto& sem : imageAvaliableSems_) {
-        device.destroySemaphore(sem);
-    }
-    for (auto& sem : renderFinishSems_) {
-        device.destroySemaphore(sem);
+    canvas_.reset();
+    retiredSwapchains_.clear();
+    threadPool_.reset();
+    if (timestampPool_) {
+        device.destroyQueryPool(timestampPool_);
     }
-    for (auto& fence : fences_) {
-        device.destroyFence(fence);
+    for (auto& frame : frames_) {
+        destroyFrame(frame);
     }
+    frames_.Clear();
 }
 
-void Renderer::StartRender() {
+bool Renderer::StartRender() {
     auto& ctx = Context::Instance();
-    auto& device = ctx.device;
-    if (device.waitForFences(fences_[curFrame_], true, std::numeric_limits<std::uint64_t>::max()) != vk::Result::eSuccess) {
-        throw std::runtime_error("wait for fence failed");
+    frameActive_ = false;
+
+    if (surfaceHidden()) {
+        // keep finishing work in flight but don't touch the swapchain
+        ctx.CollectTimelines();
+        std::this_thread::sleep_for(HiddenSleep);
+        return false;
     }
-    device.resetFences(fences_[curFrame_]);
+    limitFrameRate();
 
-    auto& swapchain = ctx.swapchain;
-    auto resultValue = device.acquireNextImageKHR(swapchain->swapchain, std::numeric_limits<std::uint64_t>::max(), imageAvaliableSems_[curFrame_], nullptr);
-    if (resultValue.result != vk::Result::eSuccess) {
-        throw std::runtime_error("wait for image in swapchain failed");
+    auto& next = frames_[FrameClock::NextIndex()];
+    ctx.graphicsTimeline->WaitFor(next.timelineValue);
+    pollLatency(next, true);
+    readGpuTime(next);
+    ctx.CollectTimelines();
+
+    FrameClock::BeginFrame();
+    frameStart_ = Clock::now();
+    auto& frame = frames_.Current();
+    boundState_ = BoundState{};
+    recordMode_ = pendingRecordMode_;
+
+    releaseRetiredSwapchains();
+    if (swapchainDirty_) {
+        recreateSwapchain();
     }
-    imageIndex_ = resultValue.value;
+    if (!acquireNextImage()) {
+        return false;
+    }
+    damageTracking_ = pendingDamageTracking_;
+    prepareCanvas();
 
-    auto& cmdMgr = ctx.commandManager;
-    auto& cmd = cmdBufs_[curFrame_];
-    cmd.reset();
+    if (lastFrameStart_) {
+        framePacing_.frame.Add(std::chrono::duration<float, std::milli>(frameStart_ - *lastFrameStart_).count());
+    }
+    lastFrameStart_ = frameStart_;
 
+    auto& cmd = frame.cmdBuf;
     vk::CommandBufferBeginInfo beginInfo;
     beginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
     cmd.begin(beginInfo);
+    if (timestampPool_) {
+        cmd.resetQueryPool(timestampPool_, frame.firstQuery, 2);
+        cmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, timestampPool_, frame.firstQuery);
+    }
+    frameActive_ = true;
+
+    scopeOpen_ = false;
+    backbufferUsed_ = false;
+    target_ = nullptr;
+    unsortedStateChanges_ = 0;
+    return true;
+}
+
+Renderer::RenderScope Renderer::backbufferScope() const {
+    auto& ctx = Context::Instance();
+    // with damage tracking openScope picks the canvas' render pass
+    return RenderScope{ctx.renderProcess->renderPass,
+                       damageTracking_ ? canvas_->framebuffer_ : ctx.swapchain->framebuffers[imageIndex_],
+                       ctx.swapchain->GetExtent(),
+                       vk::ClearColorValue(std::array<float, 4>{0.1, 0.1, 0.1, 1}),
+                       true,
+                       "backbuffer"};
+}
+
+void Renderer::openScope(const RenderScope& scope) {
+    closeScope();
+
+    if (scope.backbuffer) {
+        // the swapchain render pass clears, so it can't be resumed
+        if (backbufferUsed_) {
+            throw std::runtime_error("the swapchain image can only be rendered once per frame");
+        }
+        backbufferUsed_ = true;
+    }
+    scope_ = scope;
+    auto view = viewMatrix();
+    if (scope.backbuffer && damageTracking_) {
+        // a changed projection or view moves everything, more than the damage tells
+        if (memcmp(&projectMat_, &canvasProject_, sizeof(Mat4)) != 0 || memcmp(&view, &canvasView_, sizeof(Mat4)) != 0) {
+            fullDamage_ = true;
+            canvasProject_ = projectMat_;
+            canvasView_ = view;
+        }
+        scope_.renderPass = fullDamage_ ? canvas_->clearRenderPass_ : canvas_->loadRenderPass_;
+        scope_.partial = !fullDamage_;
+    }
+    scope_.uniformOffset = scope.project ? pushMatrices(*scope.project, Mat4::CreateIdentity())
+                                         : pushMatrices(projectMat_, view);
+    scopeOpen_ = true;
+    BeginDebugLabel(frame().cmdBuf, scope.name);
+
+    // deferred mode begins the render pass when the draw list is flushed, once it knows how the draws are recorded
+    if (recordMode_ == RecordMode::Immediate) {
+        beginRenderPass(frame().cmdBuf, vk::SubpassContents::eInline);
+    }
+}
+
+void Renderer::closeScope() {
+    if (!scopeOpen_) {
+        return;
+    }
+
+    flushBatches();
+    auto& cmd = frame().cmdBuf;
+    if (recordMode_ == RecordMode::Deferred) {
+        flushDrawList(cmd);
+    }
+    cmd.endRenderPass();
+    EndDebugLabel(cmd);
+    scopeOpen_ = false;
+}
+
+void Renderer::beginRenderPass(vk::CommandBuffer cmd, vk::SubpassContents contents) {
+    auto& ctx = Context::Instance();
+
     vk::ClearValue clearValue;
-    clearValue.setColor(vk::ClearColorValue(std::array<float, 4>{0.1, 0.1, 0.1, 1}));
+    clearValue.setColor(scope_.clearColor);
+    // the render area can't be empty, the scissor still drops every draw then
+    vk::Rect2D renderArea({}, scope_.extent);
+    if (scope_.partial) {
+        renderArea = damage_.extent.width > 0 ? damage_ : vk::Rect2D({}, {1, 1});
+    }
     vk::RenderPassBeginInfo renderPassBegin;
-    renderPassBegin.setRenderPass(ctx.renderProcess->renderPass)
-                   .setFramebuffer(swapchain->framebuffers[imageIndex_])
+    renderPassBegin.setRenderPass(scope_.renderPass)
+                   .setFramebuffer(scope_.framebuffer)
                    .setClearValues(clearValue)
-                   .setRenderArea(vk::Rect2D({}, swapchain->GetExtent()));
-    cmd.beginRenderPass(&renderPassBegin, vk::SubpassContents::eInline);
+                   .setRenderArea(renderArea);
+    if (scope_.partial && contents != vk::SubpassContents::eInline) {
+        // secondary command buffers can't clear for us, clear in a pass of its own
+        cmd.beginRenderPass(&renderPassBegin, vk::SubpassContents::eInline);
+        clearDamage(cmd);
+        cmd.endRenderPass();
+    }
+    cmd.beginRenderPass(&renderPassBegin, contents);
+    if (contents == vk::SubpassContents::eInline) {
+        if (scope_.partial) {
+            clearDamage(cmd);
+        }
+        setViewportAndScissor(cmd);
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                               ctx.renderProcess->layout,
+                               0, frame().descriptorSet.set, scope_.uniformOffset);
+    }
+}
+
+void Renderer::setViewportAndScissor(vk::CommandBuffer cmd) {
+    vk::Viewport viewport(0, 0, scope_.extent.width, scope_.extent.height, 0, 1);
+    cmd.setViewport(0, viewport);
+    cmd.setScissor(0, scope_.partial ? damage_ : vk::Rect2D({0, 0}, scope_.extent));
+}
+
+void Renderer::clearDamage(vk::CommandBuffer cmd) {
+    if (damage_.extent.width == 0) {
+        return;
+    }
+    vk::ClearAttachment attachment;
+    attachment.setAspectMask(vk::ImageAspectFlagBits::eColor)
+              .setColorAttachment(0)
+              .setClearValue(vk::ClearValue(scope_.clearColor));
+    vk::ClearRect rect(damage_, 0, 1);
+    cmd.clearAttachments(attachment, rect);
+}
+
+void Renderer::SetDamageTracking(bool enable) {
+    if (enable && !Context::Instance().swapchain->SupportsCopyTo()) {
+        throw std::runtime_error("damage tracking needs swapchain images that can be copied to");
+    }
+    pendingDamageTracking_ = enable;
+}
+
+void Renderer::AddDamage(const Rect& area) {
+    if (!pendingDamageTracking_) {
+        return;
+    }
+    if (frameActive_ && backbufferUsed_) {
+        throw std::runtime_error("AddDamage must be called before drawing to the swapchain image");
+    }
+
+    auto toNdc = worldToNdc();
+    auto& extent = Context::Instance().swapchain->GetExtent();
+    float minX = std::numeric_limits<float>::max(), maxX = std::numeric_limits<float>::lowest();
+    float minY = minX, maxY = maxX;
+    for (float dx : {-0.5f, 0.5f}) {
+        for (float dy : {-0.5f, 0.5f}) {
+            auto ndc = toNdc.Apply(Vec{area.position.x + area.size.w * dx, area.position.y + area.size.h * dy});
+            float x = (ndc.x + 1) * 0.5f * extent.width;
+            float y = (ndc.y + 1) * 0.5f * extent.height;
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+        }
+    }
+
+    // one more pixel for anti-aliased edges
+    auto clampTo = [](float value, uint32_t size) {
+        return static_cast<int32_t>(std::clamp(value, 0.0f, static_cast<float>(size)));
+    };
+    int32_t x0 = clampTo(std::floor(minX) - 1, extent.width);
+    int32_t y0 = clampTo(std::floor(minY) - 1, extent.height);
+    int32_t x1 = clampTo(std::ceil(maxX) + 1, extent.width);
+    int32_t y1 = clampTo(std::ceil(maxY) + 1, extent.height);
+    if (x1 <= x0 || y1 <= y0) {
+        return;
+    }
+
+    if (damage_.extent.width > 0) {
+        x0 = std::min(x0, damage_.offset.x);
+        y0 = std::min(y0, damage_.offset.y);
+        x1 = std::max(x1, damage_.offset.x + static_cast<int32_t>(damage_.extent.width));
+        y1 = std::max(y1, damage_.offset.y + static_cast<int32_t>(damage_.extent.height));
+    }
+    damage_ = vk::Rect2D({x0, y0}, {static_cast<uint32_t>(x1 - x0), static_cast<uint32_t>(y1 - y0)});
+}
+
+void Renderer::DamageAll() {
+    fullDamage_ = true;
+}
+
+void Renderer::prepareCanvas() {
+    if (!damageTracking_) {
+        canvas_.reset();
+        return;
+    }
+
+    auto& extent = Context::Instance().swapchain->GetExtent();
+    if (!canvas_ || canvas_->GetWidth() != extent.width || canvas_->GetHeight() != extent.height) {
+        canvas_.reset(new RenderTarget(extent.width, extent.height));
+        fullDamage_ = true;
+    }
+}
+
+void Renderer::copyCanvas(vk::CommandBuffer cmd) {
+    auto& swapchain = Context::Instance().swapchain;
+    vk::Image image = swapchain->images[imageIndex_].image;
+
+    vk::ImageSubresourceRange range;
+    range.setAspectMask(vk::ImageAspectFlagBits::eColor)
+         .setBaseMipLevel(0)
+         .setLevelCount(1)
+         .setBaseArrayLayer(0)
+         .setLayerCount(1);
+
+    // the canvas' render pass ends with a fragment shader dependency, the swapchain
+    // image waits for the acquire semaphore at color attachment output
+    std::array<vk::ImageMemoryBarrier, 2> toTransfer;
+    toTransfer[0].setImage(canvas_->image_)
+                 .setOldLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+                 .setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+                 .setDstAccessMask(vk::AccessFlagBits::eTransferRead)
+                 .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+                 .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+                 .setSubresourceRange(range);
+    toTransfer[1].setImage(image)
+                 .setOldLayout(vk::ImageLayout::eUndefined)
+                 .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+                 .setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
+                 .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+                 .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+                 .setSubresourceRange(range);
+    BeginDebugLabel(cmd, "copy canvas");
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader|vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                        vk::PipelineStageFlagBits::eTransfer, {}, {}, nullptr, toTransfer);
+
+    vk::ImageSubresourceLayers layers;
+    layers.setAspectMask(vk::ImageAspectFlagBits::eColor)
+          .setMipLevel(0)
+          .setBaseArrayLayer(0)
+          .setLayerCount(1);
+    vk::ImageCopy region;
+    region.setSrcSubresource(layers)
+          .setDstSubresource(layers)
+          .setExtent({swapchain->GetExtent().width, swapchain->GetExtent().height, 1});
+    cmd.copyImage(canvas_->image_, vk::ImageLayout::eTransferSrcOptimal,
+                  image, vk::ImageLayout::eTransferDstOptimal, region);
+
+    // the next frame's canvas pass chains at the fragment shader, readbacks of the
+    // swapchain image at color attachment output
+    std::array<vk::ImageMemoryBarrier, 2> back = toTransfer;
+    back[0].setOldLayout(vk::ImageLayout::eTransferSrcOptimal)
+           .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+           .setDstAccessMask({});
+    back[1].setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+           .setNewLayout(vk::ImageLayout::ePresentSrcKHR)
+           .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+           .setDstAccessMask({});
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                        vk::PipelineStageFlagBits::eFragmentShader|vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                        {}, {}, nullptr, back);
+    EndDebugLabel(cmd);
+}
+
+void Renderer::ExecuteGraph(RenderGraph& graph) {
+    auto& ctx = Context::Instance();
+    auto& cmd = frame().cmdBuf;
+
+    if (!frameActive_) {
+        return;
+    }
+    if (backbufferUsed_) {
+        throw std::runtime_error("ExecuteGraph must be called before drawing to the swapchain image");
+    }
+    if (!graph.IsCompiled() || graph.compiledExtent_ != ctx.swapchain->GetExtent()) {
+        graph.Compile();
+    }
+
+    for (auto& pass : graph.passes_) {
+        if (pass.culled) {
+            continue;
+        }
+
+        closeScope();
+        if (!pass.barriers.empty()) {
+            cmd.pipelineBarrier(pass.srcStages, pass.dstStages, {}, {}, nullptr, pass.barriers);
+        }
+
+        if (pass.write == RenderGraph::BackbufferID) {
+            openScope(backbufferScope());
+        } else {
+            auto& target = graph.resources_[pass.write];
+            openScope(RenderScope{pass.clearTarget ? graph.clearRenderPass_ : graph.loadRenderPass_,
+                                  target.framebuffer,
+                                  target.extent,
+                                  vk::ClearColorValue(std::array<float, 4>{0, 0, 0, 0}),
+                                  false,
+                                  pass.name.c_str()});
+        }
+        pass.func(*this);
+    }
+
+    // later draws of this frame go to the swapchain image
+    if (scopeOpen_ && !scope_.backbuffer) {
+        closeScope();
+    }
+    graph.executedFrame_ = FrameClock::Number();
+}
+
+void Renderer::BeginTarget(RenderTarget& target, bool clear) {
+    if (!frameActive_) {
+        return;
+    }
+    if (backbufferUsed_) {
+        throw std::runtime_error("BeginTarget must be called before drawing to the swapchain image");
+    }
+    closeScope();
+
+    clear = clear || !target.rendered_;
+    target.rendered_ = true;
+    target_ = &target;
+    openScope(RenderScope{clear ? target.clearRenderPass_ : target.loadRenderPass_,
+                          target.framebuffer_,
+                          vk::Extent2D{target.width_, target.height_},
+                          target.clearColor_,
+                          false,
+                          "render target",
+                          &target.project_});
+}
+
+void Renderer::EndTarget() {
+    if (!target_) {
+        return;
+    }
+    closeScope();
+    target_->dirty_ = false;
+    target_ = nullptr;
 }
 
 void Renderer::DrawTexture(const Rect& rect, Texture& texture) {
+    DrawTexture(Transform2D::CreateTranslate(rect.position).Mul(Transform2D::CreateScale(rect.size)), texture);
+}
+
+void Renderer::DrawTexture(const Rect& rect, float rotation, Texture& texture) {
+    DrawTexture(Transform2D::CreateTranslate(rect.position)
+                    .Mul(Transform2D::CreateRotate(rotation))
+                    .Mul(Transform2D::CreateScale(rect.size)),
+                texture);
+}
+
+void Renderer::DrawTexture(const Transform2D& transform, Texture& texture) {
     auto& ctx = Context::Instance();
-    auto& device = ctx.device;
-    auto& cmd = cmdBufs_[curFrame_];
-    vk::DeviceSize offset = 0;
 
-    bufferRectData();
+    DrawCmd cmd;
+    cmd.key = drawKey(TrianglePipeline, texture.id);
+    cmd.pipeline = ctx.renderProcess->graphicsPipelineWithTriangleTopology;
+    cmd.textureSet = texture.set.set;
+    cmd.vertexBuffer = rectVerticesBuffer_->buffer;
+    cmd.indexBuffer = rectIndicesBuffer_->buffer;
+    cmd.firstVertex = 0;
+    cmd.firstIndex = 0;
+    cmd.count = 6;
+    cmd.transform = transform;
+    cmd.color = drawColor_;
+    submitDraw(cmd);
+}
 
-    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, ctx.renderProcess->graphicsPipelineWithTriangleTopology);
-    cmd.bindVertexBuffers(0, rectVerticesBuffer_->buffer, offset);
-    cmd.bindIndexBuffer(rectIndicesBuffer_->buffer, 0, vk::IndexType::eUint32);
+void Renderer::DrawTextureEx(Texture& texture, const Rect& src, const Rect& dst,
+                             float rotation, const Vec& origin, Flip flip) {
+    float invW = 1.0f / texture.width;
+    float invH = 1.0f / texture.height;
+    Vec uv0{(src.position.x - src.size.w * 0.5f) * invW, (src.position.y - src.size.h * 0.5f) * invH};
+    Vec uv1{(src.position.x + src.size.w * 0.5f) * invW, (src.position.y + src.size.h * 0.5f) * invH};
+    if (flip == Flip::Horizontal || flip == Flip::Both) {
+        std::swap(uv0.x, uv1.x);
+    }
+    if (flip == Flip::Vertical || flip == Flip::Both) {
+        std::swap(uv0.y, uv1.y);
+    }
+    pushSprite(texture, dst, rotation, origin, uv0, uv1, drawColor_);
+}
 
-    auto& layout = Context::Instance().renderProcess->layout;
-    cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-                           layout,
-                           0, {descriptorSets_[curFrame_].set, texture.set.set}, {});
-    auto model = Mat4::CreateTranslate(rect.position).Mul(Mat4::CreateScale(rect.size));
-    cmd.pushConstants(layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(Mat4), model.GetData());
-    cmd.pushConstants(layout, vk::ShaderStageFlagBits::eFragment, sizeof(Mat4), sizeof(Color), &drawColor_);
-    cmd.drawIndexed(6, 1, 0, 0, 0);
+void Renderer::pushSprite(Texture& texture, const Rect& dst, float rotation, const Vec& origin,
+                          const Vec& uv0, const Vec& uv1, const Color& color) {
+    if (!beginBatch(SpriteBatch)) {
+        return;
+    }
+    if (spriteTexture_ != &texture) {
+        flushSprites();
+        spriteTexture_ = &texture;
+    }
+    TessellateSprite(dst, rotation, origin, uv0, uv1, color, spriteVertices_);
 }
 
 void Renderer::DrawLine(const Vec& p1, const Vec& p2) {
+    if (!frameActive_) {
+        return;
+    }
+    if (lineWidth_ > 0) {
+        float cap = static_cast<float>(lineCap_);
+        if (beginBatch(LineBatch)) {
+            lineInstances_.push_back(LineInstance{p1, p2, drawColor_, lineWidth_, Vec{cap, cap}});
+        }
+        return;
+    }
     auto& ctx = Context::Instance();
-    auto& device = ctx.device;
-    auto& cmd = cmdBufs_[curFrame_];
-    vk::DeviceSize offset = 0;
 
-    bufferLineData(p1, p2);
+    auto alloc = frame().vertexStream->Alloc(sizeof(Vertex) * 2, sizeof(Vertex));
+    Vertex vertices[] = {
+        {p1, Vec{0, 0}},
+        {p2, Vec{0, 0}},
+    };
+    memcpy(alloc.map, vertices, sizeof(vertices));
+
+    DrawCmd cmd;
+    cmd.key = drawKey(LinePipeline, whiteTexture->id);
+    cmd.pipeline = ctx.renderProcess->graphicsPipelineWithLineTopology;
+    cmd.textureSet = whiteTexture->set.set;
+    cmd.vertexBuffer = alloc.buffer;
+    cmd.indexBuffer = nullptr;
+    cmd.firstVertex = static_cast<uint32_t>(alloc.offset / sizeof(Vertex));
+    cmd.firstIndex = 0;
+    cmd.count = 2;
+    cmd.transform = Transform2D::CreateIdentity();
+    cmd.color = drawColor_;
+    submitDraw(cmd);
+}
+
+void Renderer::DrawPolyline(const std::vector<Vec>& points, bool closed) {
+    if (points.size() < 2) {
+        return;
+    }
+    if (lineWidth_ <= 0) {
+        for (size_t i = 0; i + 1 < points.size(); i++) {
+            DrawLine(points[i], points[i + 1]);
+        }
+        if (closed) {
+            DrawLine(points.back(), points.front());
+        }
+        return;
+    }
+    if (!beginBatch(LineBatch)) {
+        return;
+    }
+    TessellatePolyline(points, closed, drawColor_, lineWidth_, lineCap_, lineJoin_, lineInstances_);
+}
+
+void Renderer::DrawString(Font& font, const std::string& utf8, const Vec& position, float size) {
+    if (!beginBatch(TextBatch)) {
+        return;
+    }
+    if (textFont_ != &font) {
+        flushText();
+        textFont_ = &font;
+    }
+    font.Layout(utf8, position, size, drawColor_, textVertices_);
+}
+
+void Renderer::DrawTilemap(Tilemap& map) {
+    if (!frameActive_) {
+        return;
+    }
+    auto& ctx = Context::Instance();
+    auto& tileset = map.GetTileset();
+
+    visibleChunks_.clear();
+    map.CollectVisible(GetVisibleArea(), visibleChunks_);
+    for (auto& chunk : visibleChunks_) {
+        DrawCmd cmd;
+        cmd.key = drawKey(TrianglePipeline, tileset.id);
+        cmd.pipeline = ctx.renderProcess->graphicsPipelineWithTriangleTopology;
+        cmd.textureSet = tileset.set.set;
+        cmd.vertexBuffer = chunk.buffer;
+        cmd.indexBuffer = nullptr;
+        cmd.firstVertex = chunk.firstVertex;
+        cmd.firstIndex = 0;
+        cmd.count = chunk.vertexCount;
+        cmd.transform = Transform2D::CreateTranslate(map.position);
+        cmd.color = drawColor_;
+        submitDraw(cmd);
+    }
+}
+
+void Renderer::DrawSpriteScene(SpriteScene& scene) {
+    if (!frameActive_) {
+        return;
+    }
+
+    visibleSprites_.clear();
+    scene.CollectVisible(GetVisibleArea(), visibleSprites_);
+    for (auto sprite : visibleSprites_) {
+        Color color{sprite->color.r * drawColor_.r, sprite->color.g * drawColor_.g, sprite->color.b * drawColor_.b};
+        pushSprite(*sprite->texture, sprite->rect, sprite->rotation, Vec{0, 0}, Vec{0, 0}, Vec{1, 1}, color);
+    }
+}
+
+void Renderer::DrawStaticBatch(const StaticBatch& batch, const Transform2D& transform) {
+    if (!frameActive_ || !batch.IsBaked()) {
+        return;
+    }
+    auto& ctx = Context::Instance();
+    if (batch.ranges_.empty()) {
+        return;
+    }
+
+    // one key for every range: the stable sort keeps them together and in the order they were added
+    auto& front = batch.ranges_.front();
+    uint64_t key = drawKey(front.lines ? ThickLinePipeline : TrianglePipeline,
+                           front.texture ? front.texture->id : whiteTexture->id);
+    for (auto& range : batch.ranges_) {
+        Texture& texture = range.texture ? *range.texture : *whiteTexture;
+
+        DrawCmd cmd;
+        cmd.key = key;
+        cmd.textureSet = texture.set.set;
+        cmd.firstVertex = 0;
+        cmd.transform = transform;
+        cmd.color = drawColor_;
+        if (range.lines) {
+            cmd.pipeline = ctx.renderProcess->thickLinePipeline;
+            cmd.vertexBuffer = batch.lineBuffer_->buffer;
+            cmd.indexBuffer = nullptr;
+            cmd.firstIndex = 0;
+            cmd.count = 4;
+            cmd.instanceCount = range.count;
+            cmd.firstInstance = range.first;
+        } else {
+            cmd.pipeline = ctx.renderProcess->graphicsPipelineWithTriangleTopology;
+            cmd.vertexBuffer = batch.vertexBuffer_->buffer;
+            cmd.indexBuffer = batch.indexBuffer_->buffer;
+            cmd.firstIndex = range.first;
+            cmd.count = range.count;
+        }
+        submitDraw(cmd);
+    }
+}
 
-    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, ctx.renderProcess->graphicsPipelineWithLineTopology);
-    cmd.bindVertexBuffers(0, lineVerticesBuffer_->buffer, offset);
+void Renderer::DrawParticles(ParticleSystem& system) {
+    if (!frameActive_) {
+        return;
+    }
+    auto& ctx = Context::Instance();
+    computeWait_ = std::max(computeWait_, system.simulate());
+
+    Texture& texture = system.GetTexture() ? *system.GetTexture() : *whiteTexture;
+    auto& output = system.currentOutput();
+    DrawCmd cmd;
+    cmd.key = drawKey(ParticlePipeline, texture.id);
+    cmd.pipeline = ctx.renderProcess->particlePipeline;
+    cmd.textureSet = texture.set.set;
+    cmd.vertexBuffer = output.instances->buffer;
+    cmd.indexBuffer = nullptr;
+    cmd.indirectBuffer = output.indirect->buffer;
+    cmd.firstVertex = 0;
+    cmd.firstIndex = 0;
+    cmd.count = 4;
+    cmd.transform = Transform2D::CreateIdentity();
+    cmd.color = drawColor_;
+    submitDraw(cmd);
+}
+
+Transform2D Renderer::worldToNdc() const {
+    // the x, y and translation columns of project * view
+    auto view = viewMatrix();
+    Transform2D toNdc;
+    int columns[] = {0, 1, 3};
+    for (int col = 0; col < 3; col++) {
+        for (int row = 0; row < 2; row++) {
+            float sum = 0;
+            for (int k = 0; k < 4; k++) {
+                sum += projectMat_.Get(k, row) * view.Get(columns[col], k);
+            }
+            toNdc.Set(col, row, sum);
+        }
+    }
+    return toNdc;
+}
+
+Rect Renderer::GetVisibleArea() const {
+    auto toWorld = worldToNdc().Inverse();
+    Vec corners[] = {toWorld.Apply(Vec{-1, -1}), toWorld.Apply(Vec{1, -1}),
+                     toWorld.Apply(Vec{1, 1}), toWorld.Apply(Vec{-1, 1})};
+    float minX = corners[0].x, maxX = corners[0].x;
+    float minY = corners[0].y, maxY = corners[0].y;
+    for (auto& corner : corners) {
+        minX = std::min(minX, corner.x);
+        maxX = std::max(maxX, corner.x);
+        minY = std::min(minY, corner.y);
+        maxY = std::max(maxY, corner.y);
+    }
+    return Rect{Vec{(minX + maxX) * 0.5f, (minY + maxY) * 0.5f}, Size{maxX - minX, maxY - minY}};
+}
+
+void Renderer::SetLineWidth(float width) {
+    lineWidth_ = width;
+}
+
+void Renderer::SetLineCap(LineCap cap) {
+    lineCap_ = cap;
+}
+
+void Renderer::SetLineJoin(LineJoin join) {
+    lineJoin_ = join;
+}
+
+void Renderer::FillRect(const Rect& rect) {
+    if (beginBatch(ShapeBatch)) {
+        TessellateRect(rect, drawColor_, shapeVertices_);
+    }
+}
+
+void Renderer::DrawRect(const Rect& rect, float thickness) {
+    if (beginBatch(ShapeBatch)) {
+        TessellateRectOutline(rect, thickness, drawColor_, shapeVertices_);
+    }
+}
+
+void Renderer::FillCircle(const Vec& center, float radius) {
+    if (beginBatch(ShapeBatch)) {
+        TessellateCircle(center, radius, CircleSegmentCount(radius * pixelsPerUnit()), drawColor_, shapeVertices_);
+    }
+}
+
+void Renderer::FillPolygon(const std::vector<Vec>& points) {
+    if (beginBatch(ShapeBatch)) {
+        TessellatePolygon(points, drawColor_, shapeVertices_);
+    }
+}
+
+bool Renderer::beginBatch(BatchType type) {
+    if (!frameActive_) {
+        return false;
+    }
+    // the batch belongs to the scope that is open when it starts, closeScope flushes it
+    if (!scopeOpen_) {
+        openScope(backbufferScope());
+    }
+    // immediate draws and ordered layers keep submission order, so only one kind of batch may be open
+    if (keepsOrder()) {
+        if (type != ShapeBatch) {
+            flushShapes();
+        }
+        if (type != LineBatch) {
+            flushLines();
+        }
+        if (type != TextBatch) {
+            flushText();
+        }
+        if (type != SpriteBatch) {
+            flushSprites();
+        }
+    }
+    return true;
+}
+
+void Renderer::flushBatches() {
+    flushShapes();
+    flushLines();
+    flushText();
+    flushSprites();
+}
+
+void Renderer::flushSprites() {
+    if (spriteVertices_.empty()) {
+        return;
+    }
+    auto& ctx = Context::Instance();
+
+    size_t size = sizeof(Vertex) * spriteVertices_.size();
+    auto alloc = frame().vertexStream->Alloc(size, sizeof(Vertex));
+    memcpy(alloc.map, spriteVertices_.data(), size);
+
+    DrawCmd cmd;
+    cmd.key = drawKey(TrianglePipeline, spriteTexture_->id);
+    cmd.pipeline = ctx.renderProcess->graphicsPipelineWithTriangleTopology;
+    cmd.textureSet = spriteTexture_->set.set;
+    cmd.vertexBuffer = alloc.buffer;
+    cmd.indexBuffer = nullptr;
+    cmd.firstVertex = static_cast<uint32_t>(alloc.offset / sizeof(Vertex));
+    cmd.firstIndex = 0;
+    cmd.count = static_cast<uint32_t>(spriteVertices_.size());
+    cmd.transform = Transform2D::CreateIdentity();
+    // the color is in the vertices
+    cmd.color = Color{1, 1, 1};
+    spriteVertices_.clear();
+    pushDraw(cmd);
+}
+
+float Renderer::pixelsPerUnit() const {
+    auto& extent = Context::Instance().swapchain->GetExtent();
+    float scale = camera_ ? camera_->GetZoom() : 1;
+    float x = std::abs(projectMat_.Get(0, 0)) * scale * extent.width * 0.5f;
+    float y = std::abs(projectMat_.Get(1, 1)) * scale * extent.height * 0.5f;
+    return std::max(x, y);
+}
 
+void Renderer::flushShapes() {
+    if (shapeVertices_.empty()) {
+        return;
+    }
+    auto& ctx = Context::Instance();
+
+    size_t size = sizeof(Vertex) * shapeVertices_.size();
+    auto alloc = frame().vertexStream->Alloc(size, sizeof(Vertex));
+    memcpy(alloc.map, shapeVertices_.data(), size);
+
+    DrawCmd cmd;
+    cmd.key = drawKey(TrianglePipeline, whiteTexture->id);
+    cmd.pipeline = ctx.renderProcess->graphicsPipelineWithTriangleTopology;
+    cmd.textureSet = whiteTexture->set.set;
+    cmd.vertexBuffer = alloc.buffer;
+    cmd.indexBuffer = nullptr;
+    cmd.firstVertex = static_cast<uint32_t>(alloc.offset / sizeof(Vertex));
+    cmd.firstIndex = 0;
+    cmd.count = static_cast<uint32_t>(shapeVertices_.size());
+    cmd.transform = Transform2D::CreateIdentity();
+    // the color is in the vertices
+    cmd.color = Color{1, 1, 1};
+    shapeVertices_.clear();
+    pushDraw(cmd);
+}
+
+void Renderer::flushLines() {
+    if (lineInstances_.empty()) {
+        return;
+    }
+    auto& ctx = Context::Instance();
+
+    size_t size = sizeof(LineInstance) * lineInstances_.size();
+    auto alloc = frame().vertexStream->Alloc(size, sizeof(LineInstance));
+    memcpy(alloc.map, lineInstances_.data(), size);
+
+    DrawCmd cmd;
+    cmd.key = drawKey(ThickLinePipeline, whiteTexture->id);
+    cmd.pipeline = ctx.renderProcess->thickLinePipeline;
+    cmd.textureSet = whiteTexture->set.set;
+    cmd.vertexBuffer = alloc.buffer;
+    cmd.indexBuffer = nullptr;
+    cmd.firstVertex = 0;
+    cmd.firstIndex = 0;
+    cmd.count = 4;
+    cmd.instanceCount = static_cast<uint32_t>(lineInstances_.size());
+    cmd.firstInstance = static_cast<uint32_t>(alloc.offset / sizeof(LineInstance));
+    cmd.transform = Transform2D::CreateIdentity();
+    cmd.color = Color{1, 1, 1};
+    lineInstances_.clear();
+    pushDraw(cmd);
+}
+
+void Renderer::flushText() {
+    if (textVertices_.empty()) {
+        return;
+    }
+    auto& ctx = Context::Instance();
+    // uploads the glyphs rasterized by this batch
+    Texture* atlas = textFont_->GetTexture();
+
+    size_t size = sizeof(Vertex) * textVertices_.size();
+    auto alloc = frame().vertexStream->Alloc(size, sizeof(Vertex));
+    memcpy(alloc.map, textVertices_.data(), size);
+
+    DrawCmd cmd;
+    cmd.key = drawKey(TextPipeline, atlas->id);
+    cmd.pipeline = ctx.renderProcess->textPipeline;
+    cmd.textureSet = atlas->set.set;
+    cmd.vertexBuffer = alloc.buffer;
+    cmd.indexBuffer = nullptr;
+    cmd.firstVertex = static_cast<uint32_t>(alloc.offset / sizeof(Vertex));
+    cmd.firstIndex = 0;
+    cmd.count = static_cast<uint32_t>(textVertices_.size());
+    cmd.transform = Transform2D::CreateIdentity();
+    cmd.color = Color{1, 1, 1};
+    textVertices_.clear();
+    pushDraw(cmd);
+}
+
+void Renderer::submitDraw(const DrawCmd& cmd) {
+    if (!frameActive_) {
+        return;
+    }
+    // deferred draws are ordered by their sort keys, so the batch can stay open
+    if (keepsOrder()) {
+        flushBatches();
+    }
+    pushDraw(cmd);
+}
+
+void Renderer::pushDraw(const DrawCmd& cmd) {
+    if (!scopeOpen_) {
+        openScope(backbufferScope());
+    }
+
+    if (recordMode_ == RecordMode::Deferred) {
+        drawList_.Push(cmd);
+    } else {
+        recordDraw(frame().cmdBuf, cmd, boundState_);
+    }
+}
+
+void Renderer::recordDraw(vk::CommandBuffer cmdBuf, const DrawCmd& cmd, BoundState& bound) {
     auto& layout = Context::Instance().renderProcess->layout;
-    cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-                           layout,
-                           0, {descriptorSets_[curFrame_].set, whiteTexture->set.set}, {});
-    auto model = Mat4::CreateIdentity();
-    cmd.pushConstants(layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(Mat4), model.GetData());
-    cmd.pushConstants(layout, vk::ShaderStageFlagBits::eFragment, sizeof(Mat4), sizeof(Color), &drawColor_);
-    cmd.draw(2, 1, 0, 0);
+
+    if (bound.pipeline != cmd.pipeline) {
+        cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, cmd.pipeline);
+        bound.pipeline = cmd.pipeline;
+        bound.stateChanges ++;
+    }
+    if (bound.textureSet != cmd.textureSet) {
+        cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 1, cmd.textureSet, {});
+        bound.textureSet = cmd.textureSet;
+        bound.stateChanges ++;
+    }
+    if (bound.vertexBuffer != cmd.vertexBuffer) {
+        vk::DeviceSize offset = 0;
+        cmdBuf.bindVertexBuffers(0, cmd.vertexBuffer, offset);
+        bound.vertexBuffer = cmd.vertexBuffer;
+        bound.stateChanges ++;
+    }
+    if (cmd.indexBuffer && bound.indexBuffer != cmd.indexBuffer) {
+        cmdBuf.bindIndexBuffer(cmd.indexBuffer, 0, vk::IndexType::eUint32);
+        bound.indexBuffer = cmd.indexBuffer;
+    }
+
+    cmdBuf.pushConstants(layout, vk::ShaderStageFlagBits::eVertex, Shader::ModelPushConstantOffset, sizeof(Transform2D), cmd.transform.GetData());
+    cmdBuf.pushConstants(layout, vk::ShaderStageFlagBits::eFragment, Shader::ColorPushConstantOffset, sizeof(Color), &cmd.color);
+    if (cmd.pipeline == Context::Instance().renderProcess->thickLinePipeline) {
+        float viewport[] = {static_cast<float>(scope_.extent.width), static_cast<float>(scope_.extent.height)};
+        cmdBuf.pushConstants(layout, vk::ShaderStageFlagBits::eVertex, Shader::ViewportPushConstantOffset, sizeof(viewport), viewport);
+    }
+
+    if (cmd.indirectBuffer) {
+        cmdBuf.drawIndirect(cmd.indirectBuffer, 0, 1, sizeof(vk::DrawIndirectCommand));
+    } else if (cmd.indexBuffer) {
+        cmdBuf.drawIndexed(cmd.count, cmd.instanceCount, cmd.firstIndex, cmd.firstVertex, cmd.firstInstance);
+    } else {
+        cmdBuf.draw(cmd.count, cmd.instanceCount, cmd.firstVertex, cmd.firstInstance);
+    }
+    bound.drawCount ++;
+}
+
+void Renderer::flushDrawList(vk::CommandBuffer cmdBuf) {
+    unsortedStateChanges_ += drawList_.CountStateChanges(false);
+    drawList_.Sort();
+
+    size_t chunkCount = std::min<size_t>(recordThreads_,
+                                         (drawList_.Size() + MinDrawsPerRecordThread - 1) / MinDrawsPerRecordThread);
+    if (chunkCount > 1) {
+        beginRenderPass(cmdBuf, vk::SubpassContents::eSecondaryCommandBuffers);
+        recordDrawListParallel(cmdBuf, static_cast<uint32_t>(chunkCount));
+    } else {
+        beginRenderPass(cmdBuf, vk::SubpassContents::eInline);
+        BeginDebugLabel(cmdBuf, "draw list");
+        for (size_t i = 0; i < drawList_.Size(); i++) {
+            recordDraw(cmdBuf, drawList_.Get(i), boundState_);
+        }
+        EndDebugLabel(cmdBuf);
+    }
+
+    drawList_.Clear();
+    drawSequence_ = 0;
+}
+
+void Renderer::recordDrawListParallel(vk::CommandBuffer primary, uint32_t chunkCount) {
+    auto& ctx = Context::Instance();
+    auto& frame = this->frame();
+    std::vector<BoundState> states(chunkCount);
+    size_t total = drawList_.Size();
+    std::vector<vk::CommandBuffer> cmds(chunkCount);
+    for (uint32_t i = 0; i < chunkCount; i++) {
+        cmds[i] = frame.recorders[i].Next();
+    }
+
+    vk::CommandBufferInheritanceInfo inheritance;
+    inheritance.setRenderPass(scope_.renderPass)
+               .setSubpass(0)
+               .setFramebuffer(scope_.framebuffer);
+    vk::CommandBufferBeginInfo beginInfo;
+    beginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit|vk::CommandBufferUsageFlagBits::eRenderPassContinue)
+             .setPInheritanceInfo(&inheritance);
+
+    threadPool_->ParallelFor(chunkCount, [&](uint32_t chunk) {
+        size_t begin = total * chunk / chunkCount;
+        size_t end = total * (chunk + 1) / chunkCount;
+        auto cmd = cmds[chunk];
+
+        // secondary command buffers don't inherit any bound state
+        cmd.begin(beginInfo);
+        BeginDebugLabel(cmd, "draw list chunk " + std::to_string(chunk));
+        setViewportAndScissor(cmd);
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                               ctx.renderProcess->layout,
+                               0, frame.descriptorSet.set, scope_.uniformOffset);
+        for (size_t i = begin; i < end; i++) {
+            recordDraw(cmd, drawList_.Get(i), states[chunk]);
+        }
+        EndDebugLabel(cmd);
+        cmd.end();
+    });
+
+    for (uint32_t i = 0; i < chunkCount; i++) {
+        boundState_.drawCount += states[i].drawCount;
+        boundState_.stateChanges += states[i].stateChanges;
+    }
+    primary.executeCommands(cmds);
 }
 
 void Renderer::EndRender() {
     auto& ctx = Context::Instance();
     auto& swapchain = ctx.swapchain;
-    auto& cmd = cmdBufs_[curFrame_];
-    cmd.endRenderPass();
+    auto& frame = this->frame();
+    auto& cmd = frame.cmdBuf;
+
+    if (!frameActive_) {
+        return;
+    }
+    frameActive_ = false;
+
+    // the swapchain image is cleared even if nothing was drawn to it
+    if (!backbufferUsed_) {
+        openScope(backbufferScope());
+    }
+    closeScope();
+    bool partial = damageTracking_ && !fullDamage_;
+    if (damageTracking_) {
+        copyCanvas(cmd);
+    }
+    frameStats_.readbacks = static_cast<uint32_t>(readbackRequests_.size());
+    recordReadbacks(cmd);
+
+    uint32_t unsortedStateChanges = recordMode_ == RecordMode::Deferred ? unsortedStateChanges_ : boundState_.stateChanges;
+    drawListStats_.drawCount = boundState_.drawCount;
+    drawListStats_.stateChanges = boundState_.stateChanges;
+    drawListStats_.stateChangesSaved = unsortedStateChanges > boundState_.stateChanges ?
+                                       unsortedStateChanges - boundState_.stateChanges : 0;
+
+    if (timestampPool_) {
+        cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestampPool_, frame.firstQuery + 1);
+        frame.timestamped = true;
+    }
     cmd.end();
 
-    vk::SubmitInfo submit;
-    vk::PipelineStageFlags flags = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-    submit.setCommandBuffers(cmd)
-          .setWaitSemaphores(imageAvaliableSems_[curFrame_])
-          .setWaitDstStageMask(flags)
-          .setSignalSemaphores(renderFinishSems_[curFrame_]);
-    ctx.graphicsQueue.submit(submit, fences_[curFrame_]);
+    // uploads done while recording must be visible to this frame
+    ctx.uploader->Flush();
+
+    // acquire and present still need binary semaphores
+    std::vector<Timeline::Wait> waits = {{frame.imageAvaliableSem, 0, vk::PipelineStageFlagBits::eColorAttachmentOutput}};
+    if (computeWait_ > 0) {
+        waits.push_back({ctx.computeTimeline->semaphore, computeWait_,
+                         vk::PipelineStageFlagBits::eDrawIndirect|vk::PipelineStageFlagBits::eVertexInput});
+        computeWait_ = 0;
+    }
+    frame.timelineValue = ctx.graphicsTimeline->Submit({cmd}, waits, {frame.renderFinishSem});
+    ctx.ScheduleDeferred(frame.timelineValue);
+    readbacks_.Submitted(*ctx.graphicsTimeline, frame.timelineValue);
+    frameStats_.frameNumber = FrameClock::Number();
+    frameStats_.drawCalls = boundState_.drawCount;
+    frameStats_.redrawnPixels = partial ? damage_.extent.width * damage_.extent.height
+                                        : swapchain->GetExtent().width * swapchain->GetExtent().height;
+    frameStats_.cpuMs = std::chrono::duration<float, std::milli>(Clock::now() - frameStart_).count();
+    framePacing_.cpu.Add(frameStats_.cpuMs);
+    frame.input = pendingInput_;
+    pendingInput_.reset();
 
     vk::PresentInfoKHR presentInfo;
-    presentInfo.setWaitSemaphores(renderFinishSems_[curFrame_])
+    presentInfo.setWaitSemaphores(frame.renderFinishSem)
                .setSwapchains(swapchain->swapchain)
                .setImageIndices(imageIndex_);
-    if (ctx.presentQueue.presentKHR(presentInfo) != vk::Result::eSuccess) {
-        throw std::runtime_error("present queue execute failed");
+    // an empty region would mean the whole image, name a pixel that didn't change instead
+    vk::RectLayerKHR presentRect(damage_.offset, damage_.extent, 0);
+    if (damage_.extent.width == 0) {
+        presentRect = vk::RectLayerKHR({0, 0}, {1, 1}, 0);
+    }
+    vk::PresentRegionKHR presentRegion;
+    presentRegion.setRectangles(presentRect);
+    vk::PresentRegionsKHR presentRegions;
+    presentRegions.setRegions(presentRegion);
+    if (partial && ctx.incrementalPresent) {
+        presentInfo.setPNext(&presentRegions);
+    }
+    fullDamage_ = false;
+    damage_ = vk::Rect2D{};
+    try {
+        if (ctx.presentQueue.presentKHR(presentInfo) == vk::Result::eSuboptimalKHR) {
+            swapchainDirty_ = true;
+        }
+    } catch (const vk::OutOfDateKHRError&) {
+        swapchainDirty_ = true;
+    }
+
+    auto presentTime = Clock::now();
+    if (lastPresent_) {
+        framePacing_.present.Add(std::chrono::duration<float, std::milli>(presentTime - *lastPresent_).count());
+    }
+    lastPresent_ = presentTime;
+
+    for (uint32_t i = 0; i < frames_.Size(); i++) {
+        if (i != FrameClock::Index()) {
+            pollLatency(frames_[i], false);
+        }
+    }
+}
+
+void Renderer::RequestReadback(ReadbackCallback callback, const ReadbackRegion& region) {
+    if (!frameActive_) {
+        return;
+    }
+    if (!Context::Instance().swapchain->SupportsReadback()) {
+        throw std::runtime_error("swapchain images can't be read back on this surface");
+    }
+
+    ReadbackRequest request;
+    request.layout = vk::ImageLayout::ePresentSrcKHR;
+    request.stages = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    request.access = vk::AccessFlagBits::eColorAttachmentWrite;
+    request.region = region;
+    request.callback = std::move(callback);
+    readbackRequests_.push_back(std::move(request));
+}
+
+std::future<std::vector<uint8_t>> Renderer::RequestReadback(const ReadbackRegion& region) {
+    auto promise = std::make_shared<std::promise<std::vector<uint8_t>>>();
+    RequestReadback([promise](const ReadbackResult& result) {
+        std::vector<uint8_t> pixels(result.Data(), result.Data() + result.RowPitch() * result.height);
+        promise->set_value(std::move(pixels));
+    }, region);
+    return promise->get_future();
+}
+
+void Renderer::RequestReadback(RenderGraph& graph, RenderGraph::ResourceID id,
+                               ReadbackCallback callback, const ReadbackRegion& region) {
+    if (id == RenderGraph::BackbufferID) {
+        RequestReadback(std::move(callback), region);
+        return;
+    }
+
+    auto& resource = graph.resources_.at(id);
+    if (!resource.output) {
+        throw std::runtime_error("render graph image " + resource.name + " must be marked as output to be read back");
+    }
+    if (graph.executedFrame_ != FrameClock::Number()) {
+        throw std::runtime_error("render graph must be executed in this frame before reading back " + resource.name);
     }
 
-    curFrame_ = (curFrame_ + 1) % maxFlightCount_;
+    ReadbackRequest request;
+    request.image = resource.image;
+    request.layout = resource.finalLayout;
+    request.stages = resource.finalStages;
+    request.access = resource.finalAccess;
+    request.region = clampRegion(region, resource.extent);
+    request.callback = std::move(callback);
+    readbackRequests_.push_back(std::move(request));
 }
 
-void Renderer::createFences() {
-    fences_.resize(maxFlightCount_, nullptr);
+ReadbackRegion Renderer::clampRegion(const ReadbackRegion& region, vk::Extent2D extent) const {
+    ReadbackRegion result;
+    result.x = std::min(region.x, extent.width);
+    result.y = std::min(region.y, extent.height);
+    uint32_t maxWidth = extent.width - result.x;
+    uint32_t maxHeight = extent.height - result.y;
+    result.width = region.width == 0 ? maxWidth : std::min(region.width, maxWidth);
+    result.height = region.height == 0 ? maxHeight : std::min(region.height, maxHeight);
+    return result;
+}
+
+void Renderer::recordReadbacks(vk::CommandBuffer cmd) {
+    if (readbackRequests_.empty()) {
+        return;
+    }
+
+    auto& swapchain = Context::Instance().swapchain;
+    vk::Format format = swapchain->GetFormat().format;
+
+    vk::ImageSubresourceRange range;
+    range.setAspectMask(vk::ImageAspectFlagBits::eColor)
+         .setBaseMipLevel(0)
+         .setLevelCount(1)
+         .setBaseArrayLayer(0)
+         .setLayerCount(1);
+
+    BeginDebugLabel(cmd, "readback");
+    for (auto& request : readbackRequests_) {
+        bool backbuffer = !request.image;
+        vk::Image image = backbuffer ? swapchain->images[imageIndex_].image : request.image;
+        // the swapchain may have been recreated since the request
+        ReadbackRegion region = backbuffer ? clampRegion(request.region, swapchain->GetExtent()) : request.region;
+        if (region.width == 0 || region.height == 0) {
+            continue;
+        }
+
+        vk::ImageMemoryBarrier barrier;
+        barrier.setImage(image)
+               .setOldLayout(request.layout)
+               .setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+               .setSrcAccessMask(request.access)
+               .setDstAccessMask(vk::AccessFlagBits::eTransferRead)
+               .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+               .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+               .setSubresourceRange(range);
+        cmd.pipelineBarrier(request.stages, vk::PipelineStageFlagBits::eTransfer, {}, {}, nullptr, barrier);
+
+        readbacks_.Record(cmd, image, format, region, std::move(request.callback));
 
-    for (auto& fence : fences_) {
-        vk::FenceCreateInfo fenceCreateInfo;
-        fenceCreateInfo.setFlags(vk::FenceCreateFlagBits::eSignaled);
-        fence = Context::Instance().device.createFence(fenceCreateInfo);
+        // back to where presentation or the graph barriers of the next frame expect it,
+        // the destination stages chain the copy before whatever reuses the image
+        barrier.setOldLayout(vk::ImageLayout::eTransferSrcOptimal)
+               .setNewLayout(request.layout)
+               .setSrcAccessMask(vk::AccessFlagBits::eTransferRead)
+               .setDstAccessMask({});
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                            backbuffer ? vk::PipelineStageFlagBits::eBottomOfPipe :
+                                         vk::PipelineStageFlagBits::eFragmentShader|vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                            {}, {}, nullptr, barrier);
     }
+    EndDebugLabel(cmd);
+    readbackRequests_.clear();
 }
 
-void Renderer::createSemaphores() {
+void Renderer::RequestSwapchainRecreate(int windowWidth, int windowHeight) {
+    windowWidth_ = windowWidth;
+    windowHeight_ = windowHeight;
+    swapchainDirty_ = true;
+}
+
+bool Renderer::acquireNextImage() {
     auto& device = Context::Instance().device;
-    vk::SemaphoreCreateInfo info;
 
-    imageAvaliableSems_.resize(maxFlightCount_);
-    renderFinishSems_.resize(maxFlightCount_);
+    while (true) {
+        try {
+            auto resultValue = device.acquireNextImageKHR(Context::Instance().swapchain->swapchain,
+                                                          std::numeric_limits<std::uint64_t>::max(),
+                                                          frame().imageAvaliableSem, nullptr);
+            if (resultValue.result == vk::Result::eSuboptimalKHR) {
+                // still presentable, recreate it next frame
+                swapchainDirty_ = true;
+            } else if (resultValue.result != vk::Result::eSuccess) {
+                throw std::runtime_error("wait for image in swapchain failed");
+            }
+            imageIndex_ = resultValue.value;
+            return true;
+        } catch (const vk::OutOfDateKHRError&) {
+            // a minimized window has no extent to recreate the swapchain with
+            swapchainDirty_ = true;
+            if (surfaceHidden()) {
+                return false;
+            }
+            recreateSwapchain();
+        }
+    }
+}
+
+void Renderer::recreateSwapchain() {
+    auto old = Context::Instance().RecreateSwapchain(windowWidth_, windowHeight_);
+    retiredSwapchains_.push_back({std::move(old), FrameClock::Number()});
+    swapchainDirty_ = false;
+}
+
+bool Renderer::surfaceHidden() {
+    // the surface only needs a query once something told us it changed
+    if (!swapchainDirty_ && !surfaceHidden_) {
+        return false;
+    }
+
+    auto& ctx = Context::Instance();
+    auto extent = ctx.phyDevice.getSurfaceCapabilitiesKHR(ctx.swapchain->surface).currentExtent;
+    if (extent.width == std::numeric_limits<uint32_t>::max()) {
+        extent = vk::Extent2D{static_cast<uint32_t>(windowWidth_), static_cast<uint32_t>(windowHeight_)};
+    }
+
+    bool hidden = extent.width == 0 || extent.height == 0;
+    if (surfaceHidden_ && !hidden) {
+        swapchainDirty_ = true;
+        // don't count the hidden time as one long frame
+        lastFrameStart_.reset();
+        lastPresent_.reset();
+        nextFrameTime_ = Clock::now();
+    }
+    surfaceHidden_ = hidden;
+    return hidden;
+}
+
+void Renderer::SetTargetFrameRate(float fps) {
+    if (fps <= 0) {
+        targetFrameInterval_ = Clock::duration::zero();
+        return;
+    }
+    targetFrameInterval_ = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    nextFrameTime_ = Clock::now();
+}
+
+void Renderer::limitFrameRate() {
+    if (targetFrameInterval_ == Clock::duration::zero()) {
+        return;
+    }
+
+    auto now = Clock::now();
+    if (now < nextFrameTime_) {
+        std::this_thread::sleep_until(nextFrameTime_);
+        // advance from the deadline, not from the wake up, so oversleeping doesn't accumulate
+        nextFrameTime_ += targetFrameInterval_;
+    } else {
+        // fell behind, don't catch up with a burst of frames
+        nextFrameTime_ = now + targetFrameInterval_;
+    }
+}
+
+void Renderer::createTimestampPool() {
+    auto& ctx = Context::Instance();
+    auto limits = ctx.phyDevice.getProperties().limits;
+    auto families = ctx.phyDevice.getQueueFamilyProperties();
+    uint32_t validBits = families[ctx.queueInfo.graphicsIndex.value()].timestampValidBits;
+    if (validBits == 0 || limits.timestampPeriod == 0) {
+        return;
+    }
+
+    timestampPeriod_ = limits.timestampPeriod;
+    timestampMask_ = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
 
-    for (auto& sem : imageAvaliableSems_) {
-        sem = device.createSemaphore(info);
+    vk::QueryPoolCreateInfo createInfo;
+    createInfo.setQueryType(vk::QueryType::eTimestamp)
+              .setQueryCount(frames_.Size() * 2);
+    timestampPool_ = ctx.device.createQueryPool(createInfo);
+    SetDebugName(timestampPool_, "frame timestamps");
+}
+
+void Renderer::readGpuTime(FrameData& frame) {
+    if (!timestampPool_ || !frame.timestamped) {
+        return;
+    }
+    frame.timestamped = false;
+
+    // the frame finished, so the results are available without waiting
+    auto result = Context::Instance().device.getQueryPoolResults<uint64_t>(timestampPool_, frame.firstQuery, 2,
+                                                                           sizeof(uint64_t) * 2, sizeof(uint64_t),
+                                                                           vk::QueryResultFlagBits::e64);
+    if (result.result != vk::Result::eSuccess) {
+        return;
+    }
+    uint64_t ticks = (result.value[1] - result.value[0]) & timestampMask_;
+    framePacing_.gpu.Add(static_cast<float>(ticks * timestampPeriod_ / 1e6));
+}
+
+void Renderer::releaseRetiredSwapchains() {
+    // a swapchain retired at frame R was last used by frame R - 1
+    auto it = std::remove_if(retiredSwapchains_.begin(), retiredSwapchains_.end(),
+                             [&](const RetiredSwapchain& retired) {
+                                 return FrameClock::IsFinished(retired.retireFrame - 1);
+                             });
+    retiredSwapchains_.erase(it, retiredSwapchains_.end());
+}
+
+void Renderer::MarkInput() {
+    if (!pendingInput_) {
+        pendingInput_ = Clock::now();
+    }
+}
+
+void Renderer::pollLatency(FrameData& frame, bool signaled) {
+    auto& input = frame.input;
+    if (!input) {
+        return;
     }
+    if (!signaled && !Context::Instance().graphicsTimeline->IsCompleted(frame.timelineValue)) {
+        return;
+    }
+
+    float ms = std::chrono::duration<float, std::milli>(Clock::now() - *input).count();
+    input.reset();
+
+    latencyStats_.lastMs = ms;
+    latencyStats_.maxMs = std::max(latencyStats_.maxMs, ms);
+    latencyStats_.averageMs = latencyStats_.samples == 0 ? ms : latencyStats_.averageMs * 0.9f + ms * 0.1f;
+    latencyStats_.samples ++;
+}
+
+Renderer::FrameData Renderer::createFrame(uint32_t index) {
+    auto& ctx = Context::Instance();
+    auto& device = ctx.device;
+    FrameData frame;
+
+    frame.imageAvaliableSem = device.createSemaphore(vk::SemaphoreCreateInfo{});
+    frame.renderFinishSem = device.createSemaphore(vk::SemaphoreCreateInfo{});
+    frame.cmdBuf = ctx.commandManager->CreateOneCommandBuffer();
+    frame.firstQuery = index * 2;
+    std::string prefix = "frame " + std::to_string(index);
+    SetDebugName(frame.imageAvaliableSem, prefix + " image available");
+    SetDebugName(frame.renderFinishSem, prefix + " render finish");
+    SetDebugName(frame.cmdBuf, prefix + " command buffer");
+
+    frame.vertexStream.reset(new StreamBuffer(vk::BufferUsageFlagBits::eVertexBuffer, sizeof(Vertex) * 4096));
+
+    // written by the CPU and read by the GPU in place, the slot isn't reused before the GPU finished the frame
+    frame.uniformBuffer.reset(new Buffer(vk::BufferUsageFlagBits::eUniformBuffer,
+                              uniformStride_ * MaxScopesPerFrame,
+                              vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent));
+    SetDebugName(frame.uniformBuffer->buffer, prefix + " uniform buffer");
+    frame.descriptorSet = DescriptorSetManager::Instance().AllocBufferSets(1)[0];
+    updateDescriptorSet(frame);
+
+    createRecorders(frame);
+    return frame;
+}
 
-    for (auto& sem : renderFinishSems_) {
-        sem = device.createSemaphore(info);
+void Renderer::resetFrame(FrameData& frame) {
+    frame.cmdBuf.reset();
+    frame.timestamped = false;
+    frame.uniformSlots = 0;
+    frame.vertexStream->Reset();
+    for (auto& recorder : frame.recorders) {
+        recorder.cmdMgr->ResetCmds();
+        recorder.used = 0;
     }
 }
 
-void Renderer::createCmdBuffers() {
-    cmdBufs_.resize(maxFlightCount_);
+void Renderer::destroyFrame(FrameData& frame) {
+    auto& device = Context::Instance().device;
+    frame.recorders.clear();
+    frame.vertexStream.reset();
+    frame.uniformBuffer.reset();
+    device.destroySemaphore(frame.imageAvaliableSem);
+    device.destroySemaphore(frame.renderFinishSem);
+}
+
+void Renderer::createRecorders(FrameData& frame) {
+    frame.recorders.clear();
+    if (recordThreads_ == 1) {
+        return;
+    }
+    frame.recorders.resize(recordThreads_);
+    for (auto& recorder : frame.recorders) {
+        recorder.cmdMgr = std::make_unique<CommandManager>();
+    }
+}
 
-    for (auto& cmd : cmdBufs_) {
-        cmd = Context::Instance().commandManager->CreateOneCommandBuffer();
+vk::CommandBuffer Renderer::SecondaryRecorder::Next() {
+    if (used == cmds.size()) {
+        cmds.push_back(cmdMgr->CreateSecondaryCommandBuffers(1)[0]);
     }
+    return cmds[used++];
 }
 
 void Renderer::createBuffers() {
@@ -180,38 +1422,6 @@ void Renderer::createBuffers() {
     rectIndicesBuffer_.reset(new Buffer(vk::BufferUsageFlagBits::eIndexBuffer,
                                      sizeof(uint32_t) * 6,
                                      vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent));
-
-    lineVerticesBuffer_.reset(new Buffer(vk::BufferUsageFlagBits::eVertexBuffer,
-                                         sizeof(Vertex) * 2,
-                                         vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent));
-}
-
-void Renderer::createUniformBuffers(int flightCount) {
-    uniformBuffers_.resize(flightCount);
-    //            two mat4                  one color
-    size_t size = sizeof(Mat4) * 2;
-    for (auto& buffer : uniformBuffers_) {
-        buffer.reset(new Buffer(vk::BufferUsageFlagBits::eTransferSrc,
-                     size,
-                     vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent));
-    }
-    deviceUniformBuffers_.resize(flightCount);
-    for (auto& buffer : deviceUniformBuffers_) {
-        buffer.reset(new Buffer(vk::BufferUsageFlagBits::eTransferDst|vk::BufferUsageFlagBits::eUniformBuffer,
-                     size,
-                     vk::MemoryPropertyFlagBits::eDeviceLocal));
-    }
-}
-
-void Renderer::transformBuffer2Device(Buffer& src, Buffer& dst, size_t srcOffset, size_t dstOffset, size_t size) {
-    Context::Instance().commandManager->ExecuteCmd(Context::Instance().graphicsQueue,
-            [&](vk::CommandBuffer& cmdBuf) {
-                vk::BufferCopy region;
-                region.setSrcOffset(srcOffset)
-                      .setDstOffset(dstOffset)
-                      .setSize(size);
-                cmdBuf.copyBuffer(src.buffer, dst.buffer, region);
-            });
 }
 
 std::uint32_t Renderer::queryBufferMemTypeIndex(std::uint32_t type, vk::MemoryPropertyFlags flag) {
@@ -252,61 +1462,120 @@ void Renderer::bufferRectIndicesData() {
     memcpy(rectIndicesBuffer_->map, indices, sizeof(indices));
 }
 
-void Renderer::bufferLineData(const Vec& p1, const Vec& p2) {
-    Vertex vertices[] = {
-        {p1,Vec{0, 0}},
-        {p2,Vec{0, 0}},
-    };
-    auto& device = Context::Instance().device;
-    memcpy(lineVerticesBuffer_->map, vertices, sizeof(vertices));
-}
-
-void Renderer::bufferMVPData() {
-    struct Matrices {
-        Mat4 project;
-        Mat4 view;
-    } matrices;
-    auto& device = Context::Instance().device;
-    for (int i = 0; i < uniformBuffers_.size(); i++) {
-        auto& buffer = uniformBuffers_[i];
-        memcpy(buffer->map, (void*)&projectMat_, sizeof(Mat4));
-        memcpy(((float*)buffer->map + 4 * 4), (void*)&viewMat_, sizeof(Mat4));
-        transformBuffer2Device(*buffer, *deviceUniformBuffers_[i], 0, 0, buffer->size);
+uint32_t Renderer::pushMatrices(const Mat4& project, const Mat4& view) {
+    auto& frame = this->frame();
+    if (frame.uniformSlots == MaxScopesPerFrame) {
+        throw std::runtime_error("too many render scopes in one frame");
     }
+    auto offset = static_cast<uint32_t>(uniformStride_ * frame.uniformSlots++);
+    auto data = static_cast<uint8_t*>(frame.uniformBuffer->map) + offset;
+    memcpy(data, &project, sizeof(Mat4));
+    memcpy(data + sizeof(Mat4), &view, sizeof(Mat4));
+    return offset;
 }
 
 void Renderer::SetDrawColor(const Color& color) {
     drawColor_ = color;
 }
 
+void Renderer::SetRecordMode(RecordMode mode) {
+    pendingRecordMode_ = mode;
+}
+
+void Renderer::SetLayer(uint8_t layer) {
+    if (layer != layer_) {
+        flushBatches();
+    }
+    layer_ = layer;
+}
+
+void Renderer::SetLayerOrdered(uint8_t layer, bool ordered) {
+    if (layer == layer_ && ordered != orderedLayers_[layer]) {
+        flushBatches();
+    }
+    orderedLayers_[layer] = ordered;
+}
+
+bool Renderer::keepsOrder() const {
+    return recordMode_ == RecordMode::Immediate || orderedLayers_[layer_];
+}
+
+uint64_t Renderer::drawKey(PipelineID pipeline, uint32_t texture) {
+    if (orderedLayers_[layer_]) {
+        return DrawList::MakeOrderedKey(layer_, depth_, drawSequence_++);
+    }
+    return DrawList::MakeKey(layer_, pipeline, texture, depth_);
+}
+
+void Renderer::SetDepth(float depth) {
+    if (depth != depth_) {
+        flushBatches();
+    }
+    depth_ = depth;
+}
+
+void Renderer::SetRecordThreads(uint32_t count) {
+    count = std::max<uint32_t>(count, 1);
+    if (count == recordThreads_) {
+        return;
+    }
+
+    // recorders of in-flight frames may still be executing
+    Context::Instance().graphicsTimeline->WaitIdle();
+    recordThreads_ = count;
+    threadPool_.reset(count > 1 ? new ThreadPool(count) : nullptr);
+
+    for (auto& frame : frames_) {
+        createRecorders(frame);
+    }
+}
+
 void Renderer::initMats() {
-    viewMat_ = Mat4::CreateIdentity();
     projectMat_ = Mat4::CreateIdentity();
 }
 
+Mat4 Renderer::viewMatrix() const {
+    if (!camera_) {
+        return Mat4::CreateIdentity();
+    }
+
+    // the camera centers on the area the projection maps to NDC
+    Vec center{-projectMat_.Get(3, 0) / projectMat_.Get(0, 0), -projectMat_.Get(3, 1) / projectMat_.Get(1, 1)};
+    auto view = camera_->GetViewTransform(center);
+    Mat4 mat;
+    mat.Set(0, 0, view.Get(0, 0));
+    mat.Set(0, 1, view.Get(0, 1));
+    mat.Set(1, 0, view.Get(1, 0));
+    mat.Set(1, 1, view.Get(1, 1));
+    mat.Set(3, 0, view.Get(2, 0));
+    mat.Set(3, 1, view.Get(2, 1));
+    return mat;
+}
+
 void Renderer::SetProject(int right, int left, int bottom, int top, int far, int near) {
     projectMat_ = Mat4::CreateOrtho(left, right, top, bottom, near, far);
-    bufferMVPData();
 }
 
-void Renderer::updateDescriptorSets() {
-    for (int i = 0; i < descriptorSets_.size(); i++) {
-        // bind MVP buffer
-        vk::DescriptorBufferInfo bufferInfo1;
-        bufferInfo1.setBuffer(deviceUniformBuffers_[i]->buffer)
-                   .setOffset(0)
-				   .setRange(sizeof(Mat4) * 2);
+void Renderer::SetCamera(Camera* camera) {
+    camera_ = camera;
+}
 
-        std::vector<vk::WriteDescriptorSet> writeInfos(1);
-        writeInfos[0].setBufferInfo(bufferInfo1)
-                     .setDstBinding(0)
-                     .setDescriptorType(vk::DescriptorType::eUniformBuffer)
-                     .setDescriptorCount(1)
-                     .setDstArrayElement(0)
-                     .setDstSet(descriptorSets_[i].set);
+void Renderer::updateDescriptorSet(FrameData& frame) {
+    // the offset of the scope's slice is given when binding
+    vk::DescriptorBufferInfo bufferInfo1;
+    bufferInfo1.setBuffer(frame.uniformBuffer->buffer)
+               .setOffset(0)
+               .setRange(sizeof(Mat4) * 2);
 
-        Context::Instance().device.updateDescriptorSets(writeInfos, {});
-    }
+    std::vector<vk::WriteDescriptorSet> writeInfos(1);
+    writeInfos[0].setBufferInfo(bufferInfo1)
+                 .setDstBinding(0)
+                 .setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+                 .setDescriptorCount(1)
+                 .setDstArrayElement(0)
+                 .setDstSet(frame.descriptorSet.set);
+
+    Context::Instance().device.updateDescriptorSets(writeInfos, {});
 }
 
 void Renderer::createWhiteTexture() {
@@ -23,7 +23,7 @@ void Shader::initDescriptorSetLayouts() {
     std::vector<vk::DescriptorSetLayoutBinding> bindings(1);
     bindings[0].setBinding(0)
                .setDescriptorCount(1)
-               .setDescriptorType(vk::DescriptorType::eUniformBuffer)
+               .setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
                .setStageFlags(vk::ShaderStageFlagBits::eVertex);
     createInfo.setBindings(bindings);
 
@@ -51,10 +51,10 @@ Shader::~Shader() {
 
 std::vector<vk::PushConstantRange> Shader::GetPushConstantRange() const {
     std::vector<vk::PushConstantRange> ranges(2);
-    ranges[0].setOffset(0)
-             .setSize(sizeof(Mat4))
+    ranges[0].setOffset(ModelPushConstantOffset)
+             .setSize(ColorPushConstantOffset)
              .setStageFlags(vk::ShaderStageFlagBits::eVertex);
-    ranges[1].setOffset(sizeof(Mat4))
+    ranges[1].setOffset(ColorPushConstantOffset)
              .setSize(sizeof(Color))
              .setStageFlags(vk::ShaderStageFlagBits::eFragment);
     return ranges;
@@ -0,0 +1,184 @@
+#include "toy2d/sprite_scene.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace toy2d {
+
+SpriteScene::SpriteScene(float cellSize): cellSize_(cellSize) {
+    if (cellSize <= 0) {
+        throw std::runtime_error("sprite scene cell size must be positive");
+    }
+}
+
+SpriteScene::SpriteID SpriteScene::Add(Texture& texture, const Rect& rect, float rotation, const Color& color) {
+    SpriteID id;
+    if (!freeIDs_.empty()) {
+        id = freeIDs_.back();
+        freeIDs_.pop_back();
+    } else {
+        id = static_cast<SpriteID>(sprites_.size());
+        sprites_.emplace_back();
+    }
+
+    auto& entry = sprites_[id];
+    entry.sprite = Sprite{&texture, rect, rotation, color};
+    entry.stamp = 0;
+    entry.alive = true;
+    updateBounds(entry);
+    insert(id, entry.cells);
+    count_++;
+    return id;
+}
+
+void SpriteScene::Remove(SpriteID id) {
+    auto& entry = sprites_[id];
+    if (!entry.alive) {
+        return;
+    }
+    erase(id, entry.cells);
+    entry.alive = false;
+    freeIDs_.push_back(id);
+    count_--;
+}
+
+void SpriteScene::Clear() {
+    sprites_.clear();
+    freeIDs_.clear();
+    cells_.clear();
+    count_ = 0;
+}
+
+void SpriteScene::SetRect(SpriteID id, const Rect& rect) {
+    auto& entry = sprites_[id];
+    entry.sprite.rect = rect;
+    auto old = entry.cells;
+    updateBounds(entry);
+    if (!(old == entry.cells)) {
+        erase(id, old);
+        insert(id, entry.cells);
+    }
+}
+
+void SpriteScene::SetPosition(SpriteID id, const Vec& position) {
+    auto rect = sprites_[id].sprite.rect;
+    rect.position = position;
+    SetRect(id, rect);
+}
+
+void SpriteScene::SetRotation(SpriteID id, float radians) {
+    auto& entry = sprites_[id];
+    entry.sprite.rotation = radians;
+    SetRect(id, entry.sprite.rect);
+}
+
+int32_t SpriteScene::toCell(float value) const {
+    // far away values share the outermost cells instead of overflowing
+    constexpr float Limit = 1 << 30;
+    return static_cast<int32_t>(std::clamp(std::floor(value / cellSize_), -Limit, Limit));
+}
+
+void SpriteScene::updateBounds(Entry& entry) {
+    auto& sprite = entry.sprite;
+    float c = std::abs(std::cos(sprite.rotation));
+    float s = std::abs(std::sin(sprite.rotation));
+    float w = std::abs(sprite.rect.size.w);
+    float h = std::abs(sprite.rect.size.h);
+    entry.bounds = Rect{sprite.rect.position, Size{c * w + s * h, s * w + c * h}};
+
+    float halfW = entry.bounds.size.w * 0.5f;
+    float halfH = entry.bounds.size.h * 0.5f;
+    entry.cells = CellRange{toCell(sprite.rect.position.x - halfW), toCell(sprite.rect.position.y - halfH),
+                            toCell(sprite.rect.position.x + halfW), toCell(sprite.rect.position.y + halfH)};
+}
+
+void SpriteScene::insert(SpriteID id, const CellRange& range) {
+    for (int32_t y = range.y0; y <= range.y1; y++) {
+        for (int32_t x = range.x0; x <= range.x1; x++) {
+            cells_[cellKey(x, y)].push_back(id);
+        }
+    }
+}
+
+void SpriteScene::erase(SpriteID id, const CellRange& range) {
+    for (int32_t y = range.y0; y <= range.y1; y++) {
+        for (int32_t x = range.x0; x <= range.x1; x++) {
+            auto it = cells_.find(cellKey(x, y));
+            if (it == cells_.end()) {
+                continue;
+            }
+            auto& ids = it->second;
+            auto pos = std::find(ids.begin(), ids.end(), id);
+            if (pos != ids.end()) {
+                *pos = ids.back();
+                ids.pop_back();
+            }
+            if (ids.empty()) {
+                cells_.erase(it);
+            }
+        }
+    }
+}
+
+void SpriteScene::CollectVisible(const Rect& area, std::vector<const Sprite*>& out) {
+    stats_ = Stats{};
+    visible_.clear();
+    if (++stamp_ == 0) {
+        for (auto& entry : sprites_) {
+            entry.stamp = 0;
+        }
+        stamp_ = 1;
+    }
+
+    float left = area.position.x - std::abs(area.size.w) * 0.5f;
+    float top = area.position.y - std::abs(area.size.h) * 0.5f;
+    float right = left + std::abs(area.size.w);
+    float bottom = top + std::abs(area.size.h);
+    CellRange range{toCell(left), toCell(top), toCell(right), toCell(bottom)};
+
+    auto visitCell = [&](const std::vector<SpriteID>& ids) {
+        stats_.cellsVisited++;
+        for (auto id : ids) {
+            auto& entry = sprites_[id];
+            if (entry.stamp == stamp_) {
+                continue;
+            }
+            entry.stamp = stamp_;
+            auto& b = entry.bounds;
+            if (b.position.x + b.size.w * 0.5f >= left && b.position.x - b.size.w * 0.5f <= right &&
+                b.position.y + b.size.h * 0.5f >= top && b.position.y - b.size.h * 0.5f <= bottom) {
+                visible_.push_back(id);
+            }
+        }
+    };
+
+    // zoomed far out the view covers more cells than are occupied, walk the occupied ones then
+    uint64_t rangeCells = static_cast<uint64_t>(range.x1 - range.x0 + 1) * static_cast<uint64_t>(range.y1 - range.y0 + 1);
+    if (rangeCells > cells_.size()) {
+        for (auto& [key, ids] : cells_) {
+            auto x = static_cast<int32_t>(key >> 32);
+            auto y = static_cast<int32_t>(key & 0xffffffff);
+            if (x >= range.x0 && x <= range.x1 && y >= range.y0 && y <= range.y1) {
+                visitCell(ids);
+            }
+        }
+    } else {
+        for (int32_t y = range.y0; y <= range.y1; y++) {
+            for (int32_t x = range.x0; x <= range.x1; x++) {
+                auto it = cells_.find(cellKey(x, y));
+                if (it != cells_.end()) {
+                    visitCell(it->second);
+                }
+            }
+        }
+    }
+
+    std::sort(visible_.begin(), visible_.end());
+    for (auto id : visible_) {
+        out.push_back(&sprites_[id].sprite);
+    }
+    stats_.drawn = static_cast<uint32_t>(visible_.size());
+    stats_.culled = count_ - stats_.drawn;
+}
+
+}
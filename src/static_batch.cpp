@@ -0,0 +1,147 @@
+#include "toy2d/static_batch.hpp"
+#include "toy2d/tessellate.hpp"
+#include "toy2d/context.hpp"
+#include "toy2d/buffer.hpp"
+#include <stdexcept>
+
+namespace toy2d {
+
+StaticBatch::~StaticBatch() {
+    Clear();
+}
+
+void StaticBatch::checkNotBaked() const {
+    if (baked_) {
+        throw std::runtime_error("static batch is already baked, Clear() it first");
+    }
+}
+
+void StaticBatch::addRange(Texture* texture, bool lines, uint32_t count) {
+    // consecutive items with the same texture share a draw
+    if (!ranges_.empty() && ranges_.back().texture == texture && ranges_.back().lines == lines) {
+        ranges_.back().count += count;
+        return;
+    }
+    uint32_t first = lines ? static_cast<uint32_t>(lines_.size()) - count : static_cast<uint32_t>(indices_.size()) - count;
+    ranges_.push_back({texture, lines, first, count});
+}
+
+void StaticBatch::addTriangles(size_t firstVertex) {
+    // tessellated shapes are triangle lists already
+    size_t count = vertices_.size() - firstVertex;
+    for (size_t i = 0; i < count; i++) {
+        indices_.push_back(static_cast<uint32_t>(firstVertex + i));
+    }
+    addRange(nullptr, false, static_cast<uint32_t>(count));
+}
+
+void StaticBatch::AddTexture(const Rect& rect, Texture& texture) {
+    AddTexture(Transform2D::CreateTranslate(rect.position).Mul(Transform2D::CreateScale(rect.size)), texture);
+}
+
+void StaticBatch::AddTexture(const Transform2D& transform, Texture& texture) {
+    checkNotBaked();
+
+    auto first = static_cast<uint32_t>(vertices_.size());
+    vertices_.push_back({transform.Apply(Vec{-0.5, -0.5}), Vec{0, 0}, color_});
+    vertices_.push_back({transform.Apply(Vec{0.5, -0.5}), Vec{1, 0}, color_});
+    vertices_.push_back({transform.Apply(Vec{0.5, 0.5}), Vec{1, 1}, color_});
+    vertices_.push_back({transform.Apply(Vec{-0.5, 0.5}), Vec{0, 1}, color_});
+
+    // a mirroring transform flips the winding, which would be culled
+    float det = transform.Get(0, 0) * transform.Get(1, 1) - transform.Get(1, 0) * transform.Get(0, 1);
+    static const uint32_t quad[] = {0, 1, 3, 1, 2, 3};
+    static const uint32_t mirrored[] = {0, 3, 1, 1, 3, 2};
+    const uint32_t* order = det < 0 ? mirrored : quad;
+    for (int i = 0; i < 6; i++) {
+        indices_.push_back(first + order[i]);
+    }
+    addRange(&texture, false, 6);
+}
+
+void StaticBatch::FillRect(const Rect& rect) {
+    checkNotBaked();
+    size_t first = vertices_.size();
+    TessellateRect(rect, color_, vertices_);
+    addTriangles(first);
+}
+
+void StaticBatch::DrawRect(const Rect& rect, float thickness) {
+    checkNotBaked();
+    size_t first = vertices_.size();
+    TessellateRectOutline(rect, thickness, color_, vertices_);
+    addTriangles(first);
+}
+
+void StaticBatch::FillCircle(const Vec& center, float radius) {
+    checkNotBaked();
+    size_t first = vertices_.size();
+    TessellateCircle(center, radius, CircleSegmentCount(radius), color_, vertices_);
+    addTriangles(first);
+}
+
+void StaticBatch::FillPolygon(const std::vector<Vec>& points) {
+    checkNotBaked();
+    size_t first = vertices_.size();
+    if (TessellatePolygon(points, color_, vertices_)) {
+        addTriangles(first);
+    }
+}
+
+void StaticBatch::AddLine(const Vec& p1, const Vec& p2) {
+    checkNotBaked();
+    float cap = static_cast<float>(lineCap_);
+    lines_.push_back(LineInstance{p1, p2, color_, lineWidth_, Vec{cap, cap}});
+    addRange(nullptr, true, 1);
+}
+
+void StaticBatch::AddPolyline(const std::vector<Vec>& points, bool closed) {
+    checkNotBaked();
+    if (points.size() < 2) {
+        return;
+    }
+
+    size_t first = lines_.size();
+    TessellatePolyline(points, closed, color_, lineWidth_, lineCap_, lineJoin_, lines_);
+    addRange(nullptr, true, static_cast<uint32_t>(lines_.size() - first));
+}
+
+void StaticBatch::Bake() {
+    checkNotBaked();
+    auto& uploader = *Context::Instance().uploader;
+
+    auto upload = [&](const void* data, size_t size, vk::BufferUsageFlags usage) {
+        std::unique_ptr<Buffer> buffer;
+        if (size > 0) {
+            buffer.reset(new Buffer(usage|vk::BufferUsageFlagBits::eTransferDst, size, vk::MemoryPropertyFlagBits::eDeviceLocal));
+            uploader.UploadBuffer(buffer->buffer, 0, data, size);
+        }
+        return buffer;
+    };
+    vertexBuffer_ = upload(vertices_.data(), sizeof(Vertex) * vertices_.size(), vk::BufferUsageFlagBits::eVertexBuffer);
+    indexBuffer_ = upload(indices_.data(), sizeof(uint32_t) * indices_.size(), vk::BufferUsageFlagBits::eIndexBuffer);
+    lineBuffer_ = upload(lines_.data(), sizeof(LineInstance) * lines_.size(), vk::BufferUsageFlagBits::eVertexBuffer);
+
+    vertices_ = {};
+    indices_ = {};
+    lines_ = {};
+    baked_ = true;
+}
+
+void StaticBatch::Clear() {
+    // frames in flight may still draw the batch
+    for (auto* buffer : {&vertexBuffer_, &indexBuffer_, &lineBuffer_}) {
+        if (*buffer) {
+            Buffer* released = buffer->release();
+            Context::Instance().DeferDestroy([released]() { delete released; });
+        }
+    }
+
+    vertices_.clear();
+    indices_.clear();
+    lines_.clear();
+    ranges_.clear();
+    baked_ = false;
+}
+
+}
@@ -0,0 +1,38 @@
+#include "toy2d/stream_buffer.hpp"
+#include <algorithm>
+
+namespace toy2d {
+
+StreamBuffer::StreamBuffer(vk::BufferUsageFlags usage, size_t chunkSize): usage_(usage), chunkSize_(chunkSize) {
+    addChunk(chunkSize_);
+}
+
+void StreamBuffer::addChunk(size_t size) {
+    chunks_.push_back(std::make_unique<Buffer>(usage_,
+                                               size,
+                                               vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent));
+}
+
+StreamBuffer::Allocation StreamBuffer::Alloc(size_t size, size_t alignment) {
+    size_t offset = (offset_ + alignment - 1) / alignment * alignment;
+
+    while (offset + size > chunks_[curChunk_]->size) {
+        curChunk_ ++;
+        offset = 0;
+        if (curChunk_ == chunks_.size()) {
+            addChunk(std::max(size, chunkSize_));
+            break;
+        }
+    }
+
+    offset_ = offset + size;
+    auto& chunk = chunks_[curChunk_];
+    return Allocation{chunk->buffer, offset, static_cast<char*>(chunk->map) + offset};
+}
+
+void StreamBuffer::Reset() {
+    curChunk_ = 0;
+    offset_ = 0;
+}
+
+}
@@ -3,9 +3,9 @@
 
 namespace toy2d {
 
-Swapchain::Swapchain(vk::SurfaceKHR surface, int windowWidth, int windowHeight): surface(surface) {
+Swapchain::Swapchain(vk::SurfaceKHR surface, int windowWidth, int windowHeight, vk::SwapchainKHR oldSwapchain): surface(surface) {
     querySurfaceInfo(windowWidth, windowHeight);
-    swapchain = createSwapchain();
+    swapchain = createSwapchain(oldSwapchain);
     createImageAndViews();
 }
 
@@ -18,7 +18,6 @@ Swapchain::~Swapchain() {
         Context::Instance().device.destroyFramebuffer(framebuffer);
     }
     ctx.device.destroySwapchainKHR(swapchain);
-    ctx.instance.destroySurfaceKHR(surface);
 }
 
 void Swapchain::InitFramebuffers() {
@@ -28,11 +27,23 @@ void Swapchain::InitFramebuffers() {
 void Swapchain::querySurfaceInfo(int windowWidth, int windowHeight) {
     surfaceInfo_.format = querySurfaceeFormat();
 
+    surfaceInfo_.presentMode = queryPresentMode();
+
     auto capability = Context::Instance().phyDevice.getSurfaceCapabilitiesKHR(surface);
-    surfaceInfo_.count = std::clamp(capability.minImageCount + 1,
-                                    capability.minImageCount, capability.maxImageCount);
+    auto& config = Context::Instance().config;
+    // maxImageCount == 0 means there is no limit
+    uint32_t maxCount = capability.maxImageCount == 0 ? std::numeric_limits<uint32_t>::max() : capability.maxImageCount;
+    uint32_t count = config.swapchainImageCount == 0 ? capability.minImageCount + 1 : config.swapchainImageCount;
+    surfaceInfo_.count = std::clamp(count, capability.minImageCount, maxCount);
     surfaceInfo_.transform = capability.currentTransform;
     surfaceInfo_.extent = querySurfaceExtent(capability, windowWidth, windowHeight);
+    surfaceInfo_.usage = vk::ImageUsageFlagBits::eColorAttachment;
+    if (capability.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferSrc) {
+        surfaceInfo_.usage |= vk::ImageUsageFlagBits::eTransferSrc;
+    }
+    if (capability.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst) {
+        surfaceInfo_.usage |= vk::ImageUsageFlagBits::eTransferDst;
+    }
 }
 
 vk::SurfaceFormatKHR Swapchain::querySurfaceeFormat() {
@@ -45,6 +56,16 @@ vk::SurfaceFormatKHR Swapchain::querySurfaceeFormat() {
     return formats[0];
 }
 
+vk::PresentModeKHR Swapchain::queryPresentMode() {
+    auto supported = Context::Instance().phyDevice.getSurfacePresentModesKHR(surface);
+    for (auto mode : Context::Instance().config.presentModes) {
+        if (std::find(supported.begin(), supported.end(), mode) != supported.end()) {
+            return mode;
+        }
+    }
+    return vk::PresentModeKHR::eFifo;
+}
+
 vk::Extent2D Swapchain::querySurfaceExtent(const vk::SurfaceCapabilitiesKHR& capability, int windowWidth, int windowHeight) {
     if (capability.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
         return capability.currentExtent;
@@ -60,18 +81,19 @@ vk::Extent2D Swapchain::querySurfaceExtent(const vk::SurfaceCapabilitiesKHR& cap
     }
 }
 
-vk::SwapchainKHR Swapchain::createSwapchain() {
+vk::SwapchainKHR Swapchain::createSwapchain(vk::SwapchainKHR oldSwapchain) {
     vk::SwapchainCreateInfoKHR createInfo;
     createInfo.setClipped(true)
               .setCompositeAlpha(vk::CompositeAlphaFlagBitsKHR::eOpaque)
               .setImageExtent(surfaceInfo_.extent)
               .setImageColorSpace(surfaceInfo_.format.colorSpace)
               .setImageFormat(surfaceInfo_.format.format)
-              .setImageUsage(vk::ImageUsageFlagBits::eColorAttachment)
+              .setImageUsage(surfaceInfo_.usage)
               .setMinImageCount(surfaceInfo_.count)
               .setImageArrayLayers(1)
-              .setPresentMode(vk::PresentModeKHR::eFifo)
+              .setPresentMode(surfaceInfo_.presentMode)
               .setPreTransform(surfaceInfo_.transform)
+              .setOldSwapchain(oldSwapchain)
               .setSurface(surface);
 
     auto& ctx = Context::Instance();
@@ -0,0 +1,280 @@
+#include "toy2d/tessellate.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace toy2d {
+
+static constexpr float Pi = 3.14159265358979f;
+static constexpr uint32_t MinCircleSegments = 8;
+static constexpr uint32_t MaxCircleSegments = 512;
+
+static float cross(const Vec& o, const Vec& a, const Vec& b) {
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+static void pushTriangle(const Vec& a, const Vec& b, const Vec& c, const Color& color, std::vector<Vertex>& out) {
+    // same winding as the unit quad
+    bool flip = cross(a, b, c) < 0;
+    out.push_back(Vertex{a, Vec{0, 0}, color});
+    out.push_back(Vertex{flip ? c : b, Vec{0, 0}, color});
+    out.push_back(Vertex{flip ? b : c, Vec{0, 0}, color});
+}
+
+static void pushQuad(float left, float top, float right, float bottom, const Color& color, std::vector<Vertex>& out) {
+    Vec p0{left, top}, p1{right, top}, p2{right, bottom}, p3{left, bottom};
+    pushTriangle(p0, p1, p3, color, out);
+    pushTriangle(p1, p2, p3, color, out);
+}
+
+uint32_t CircleSegmentCount(float radius, float tolerance) {
+    if (radius <= tolerance) {
+        return MinCircleSegments;
+    }
+    // a chord of angle a is 1 - cos(a / 2) of the radius away from the arc
+    float angle = 2 * std::acos(1 - tolerance / radius);
+    auto segments = static_cast<uint32_t>(std::ceil(2 * Pi / angle));
+    return std::clamp(segments, MinCircleSegments, MaxCircleSegments);
+}
+
+void TessellateRect(const Rect& rect, const Color& color, std::vector<Vertex>& out) {
+    float halfW = rect.size.w * 0.5f;
+    float halfH = rect.size.h * 0.5f;
+    pushQuad(rect.position.x - halfW, rect.position.y - halfH,
+             rect.position.x + halfW, rect.position.y + halfH, color, out);
+}
+
+void TessellateRectOutline(const Rect& rect, float thickness, const Color& color, std::vector<Vertex>& out) {
+    float w = std::abs(rect.size.w);
+    float h = std::abs(rect.size.h);
+    if (thickness * 2 >= w || thickness * 2 >= h) {
+        TessellateRect(rect, color, out);
+        return;
+    }
+
+    float left = rect.position.x - w * 0.5f;
+    float top = rect.position.y - h * 0.5f;
+    float right = left + w;
+    float bottom = top + h;
+    pushQuad(left, top, right, top + thickness, color, out);
+    pushQuad(left, bottom - thickness, right, bottom, color, out);
+    pushQuad(left, top + thickness, left + thickness, bottom - thickness, color, out);
+    pushQuad(right - thickness, top + thickness, right, bottom - thickness, color, out);
+}
+
+void TessellateCircle(const Vec& center, float radius, uint32_t segments, const Color& color, std::vector<Vertex>& out) {
+    segments = std::max(segments, 3u);
+    out.reserve(out.size() + segments * 3);
+
+    // rotate the edge point instead of calling sin/cos per segment
+    float step = 2 * Pi / segments;
+    float c = std::cos(step);
+    float s = std::sin(step);
+    Vec dir{1, 0};
+    Vec prev{center.x + radius, center.y};
+    for (uint32_t i = 1; i <= segments; i++) {
+        dir = Vec{dir.x * c - dir.y * s, dir.x * s + dir.y * c};
+        // close exactly on the first point
+        Vec next = i == segments ? Vec{center.x + radius, center.y} :
+                                   Vec{center.x + dir.x * radius, center.y + dir.y * radius};
+        pushTriangle(center, prev, next, color, out);
+        prev = next;
+    }
+}
+
+void TessellateSprite(const Rect& dst, float rotation, const Vec& origin,
+                      const Vec& uv0, const Vec& uv1, const Color& color, std::vector<Vertex>& out) {
+    // corners in unit quad order: top-left, top-right, bottom-right, bottom-left.
+    // Kept as separate x and y lanes so the loop below compiles to SIMD
+    static constexpr float CornerX[4] = {-0.5f, 0.5f, 0.5f, -0.5f};
+    static constexpr float CornerY[4] = {-0.5f, -0.5f, 0.5f, 0.5f};
+    float c = std::cos(rotation);
+    float s = std::sin(rotation);
+    float pivotX = dst.position.x + origin.x;
+    float pivotY = dst.position.y + origin.y;
+
+    float x[4], y[4];
+    for (int i = 0; i < 4; i++) {
+        float localX = CornerX[i] * dst.size.w - origin.x;
+        float localY = CornerY[i] * dst.size.h - origin.y;
+        x[i] = pivotX + localX * c - localY * s;
+        y[i] = pivotY + localX * s + localY * c;
+    }
+    const float u[4] = {uv0.x, uv1.x, uv1.x, uv0.x};
+    const float v[4] = {uv0.y, uv0.y, uv1.y, uv1.y};
+
+    // a negative size mirrors the quad, which would turn it into a back face
+    static constexpr int Order[6] = {0, 1, 3, 1, 2, 3};
+    static constexpr int Mirrored[6] = {0, 3, 1, 1, 3, 2};
+    const int* order = dst.size.w * dst.size.h < 0 ? Mirrored : Order;
+
+    size_t first = out.size();
+    out.resize(first + 6);
+    Vertex* vertices = out.data() + first;
+    for (int i = 0; i < 6; i++) {
+        int corner = order[i];
+        vertices[i] = Vertex{Vec{x[corner], y[corner]}, Vec{u[corner], v[corner]}, color};
+    }
+}
+
+void TessellatePolyline(const std::vector<Vec>& points, bool closed, const Color& color, float width,
+                        LineCap cap, LineJoin join, std::vector<LineInstance>& out) {
+    size_t n = points.size();
+    if (n < 2) {
+        return;
+    }
+    float capValue = static_cast<float>(cap);
+    float joinValue = LineInstance::JoinCap + static_cast<float>(join);
+    size_t count = closed ? n : n - 1;
+    out.reserve(out.size() + count);
+    for (size_t i = 0; i < count; i++) {
+        LineInstance line{points[i], points[(i + 1) % n], color, width};
+        bool joinsPrev = closed || i > 0;
+        bool joinsNext = closed || i + 1 < count;
+        line.caps = Vec{joinsPrev ? joinValue : capValue, joinsNext ? joinValue : capValue};
+        line.prev = points[(i + n - 1) % n];
+        line.next = points[(i + 2) % n];
+        out.push_back(line);
+    }
+}
+
+bool IsConvexPolygon(const std::vector<Vec>& points) {
+    size_t n = points.size();
+    if (n < 3) {
+        return false;
+    }
+
+    // Turning the same way at every vertex isn't enough, a pentagram does that too.
+    // The turns of a convex polygon add up to one revolution, then the edges
+    // change their x direction at most twice
+    float sign = 0;
+    float lastDx = 0;
+    int xFlips = 0;
+    for (size_t i = 0; i < n; i++) {
+        float c = cross(points[i], points[(i + 1) % n], points[(i + 2) % n]);
+        if (c != 0) {
+            if (sign == 0) {
+                sign = c;
+            } else if ((sign > 0) != (c > 0)) {
+                return false;
+            }
+        }
+
+        float dx = points[(i + 1) % n].x - points[i].x;
+        if (dx != 0) {
+            if (lastDx != 0 && (lastDx > 0) != (dx > 0)) {
+                xFlips ++;
+            }
+            lastDx = dx;
+        }
+    }
+    // the flip from the last edge back to the first one
+    for (size_t i = 0; i < n; i++) {
+        float dx = points[(i + 1) % n].x - points[i].x;
+        if (dx != 0) {
+            if ((lastDx > 0) != (dx > 0)) {
+                xFlips ++;
+            }
+            break;
+        }
+    }
+    return sign != 0 && xFlips <= 2;
+}
+
+static bool insideTriangle(const Vec& a, const Vec& b, const Vec& c, const Vec& p, float sign) {
+    return sign * cross(a, b, p) >= 0 && sign * cross(b, c, p) >= 0 && sign * cross(c, a, p) >= 0;
+}
+
+// edges that cross each other, touching ones don't count
+static bool selfIntersecting(const std::vector<Vec>& points) {
+    size_t n = points.size();
+    for (size_t i = 0; i < n; i++) {
+        const Vec& a = points[i];
+        const Vec& b = points[(i + 1) % n];
+        // neighbours share a point, the first edge's neighbour is the last one
+        for (size_t j = i + 2; j < n && !(i == 0 && j == n - 1); j++) {
+            const Vec& c = points[j];
+            const Vec& d = points[(j + 1) % n];
+            if (cross(a, b, c) * cross(a, b, d) < 0 && cross(c, d, a) * cross(c, d, b) < 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool TessellatePolygon(const std::vector<Vec>& points, const Color& color, std::vector<Vertex>& out) {
+    size_t n = points.size();
+    if (n < 3) {
+        return false;
+    }
+
+    if (IsConvexPolygon(points)) {
+        out.reserve(out.size() + (n - 2) * 3);
+        for (size_t i = 1; i + 1 < n; i++) {
+            pushTriangle(points[0], points[i], points[i + 1], color, out);
+        }
+        return true;
+    }
+
+    float area = 0;
+    for (size_t i = 0; i < n; i++) {
+        const Vec& p = points[i];
+        const Vec& q = points[(i + 1) % n];
+        area += p.x * q.y - q.x * p.y;
+    }
+    // ear clipping would still find ears and cover the wrong area
+    if (area == 0 || selfIntersecting(points)) {
+        return false;
+    }
+    float sign = area > 0 ? 1.0f : -1.0f;
+
+    size_t start = out.size();
+    std::vector<uint32_t> remaining(n);
+    for (size_t i = 0; i < n; i++) {
+        remaining[i] = static_cast<uint32_t>(i);
+    }
+
+    // ear clipping, O(n^2) but polygons drawn this way are small
+    while (remaining.size() > 3) {
+        size_t count = remaining.size();
+        bool clipped = false;
+        for (size_t i = 0; i < count; i++) {
+            const Vec& a = points[remaining[(i + count - 1) % count]];
+            const Vec& b = points[remaining[i]];
+            const Vec& c = points[remaining[(i + 1) % count]];
+            float corner = sign * cross(a, b, c);
+            if (corner == 0) {
+                // collinear point, drop it without a triangle
+                remaining.erase(remaining.begin() + i);
+                clipped = true;
+                break;
+            }
+            if (corner < 0) {
+                continue;
+            }
+
+            bool ear = true;
+            for (size_t j = 0; j < count && ear; j++) {
+                if (j == i || j == (i + 1) % count || j == (i + count - 1) % count) {
+                    continue;
+                }
+                ear = !insideTriangle(a, b, c, points[remaining[j]], sign);
+            }
+            if (ear) {
+                pushTriangle(a, b, c, color, out);
+                remaining.erase(remaining.begin() + i);
+                clipped = true;
+                break;
+            }
+        }
+        if (!clipped) {
+            out.resize(start);
+            return false;
+        }
+    }
+
+    pushTriangle(points[remaining[0]], points[remaining[1]], points[remaining[2]], color, out);
+    return true;
+}
+
+}
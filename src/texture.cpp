@@ -1,4 +1,5 @@
 #include "toy2d/texture.hpp"
+#include "toy2d/debug_utils.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "toy2d/stb_image.h"
@@ -19,24 +20,51 @@ Texture::Texture(std::string_view filename) {
     stbi_image_free(pixels);
 }
 
-Texture::Texture(void* data, unsigned int w, unsigned int h) {
+Texture::Texture(void* data, unsigned int w, unsigned int h, vk::Format format): format_(format) {
     init(data, w, h);
 }
 
+static uint32_t bytesPerPixel(vk::Format format) {
+    switch (format) {
+        case vk::Format::eR8Unorm:
+        case vk::Format::eR8Srgb:
+            return 1;
+        default:
+            return 4;
+    }
+}
+
+static uint32_t nextTextureID() {
+    static uint32_t idCounter = 0;
+    return idCounter ++;
+}
+
+Texture::Texture(vk::ImageView view, uint32_t w, uint32_t h): ownImage_(false) {
+    id = nextTextureID();
+    width = w;
+    height = h;
+    image = nullptr;
+    memory = nullptr;
+    this->view = view;
+
+    set = DescriptorSetManager::Instance().AllocImageSet();
+    updateDescriptorSet();
+}
+
 void Texture::init(void* data, uint32_t w, uint32_t h) {
-    const uint32_t size = w * h * 4;
-    std::unique_ptr<Buffer> buffer(new Buffer(vk::BufferUsageFlagBits::eTransferSrc,
-                                   size,
-                                   vk::MemoryPropertyFlagBits::eHostCoherent|vk::MemoryPropertyFlagBits::eHostVisible));
-    memcpy(buffer->map, data, size);
+    id = nextTextureID();
+    width = w;
+    height = h;
+
+    const uint32_t size = w * h * bytesPerPixel(format_);
 
     createImage(w, h);
     allocMemory();
     Context::Instance().device.bindImageMemory(image, memory, 0);
+    SetDebugName(image, "texture " + std::to_string(id));
 
-    transitionImageLayoutFromUndefine2Dst();
-    transformData2Image(*buffer, w, h);
-    transitionImageLayoutFromDst2Optimal();
+    // not waited for, frames submitted after the renderer flushed the uploader can sample it
+    Context::Instance().uploader->UploadImage(image, w, h, data, size);
 
     createImageView();
 
@@ -48,6 +76,9 @@ void Texture::init(void* data, uint32_t w, uint32_t h) {
 Texture::~Texture() {
     auto& device = Context::Instance().device;
     DescriptorSetManager::Instance().FreeImageSet(set);
+    if (!ownImage_) {
+        return;
+    }
     device.destroyImageView(view);
     device.freeMemory(memory);
     device.destroyImage(image);
@@ -59,7 +90,7 @@ void Texture::createImage(uint32_t w, uint32_t h) {
               .setArrayLayers(1)
               .setMipLevels(1)
               .setExtent({w, h, 1})
-              .setFormat(vk::Format::eR8G8B8A8Srgb)
+              .setFormat(format_)
               .setTiling(vk::ImageTiling::eOptimal)
               .setInitialLayout(vk::ImageLayout::eUndefined)
               .setUsage(vk::ImageUsageFlagBits::eTransferDst|vk::ImageUsageFlagBits::eSampled)
@@ -80,72 +111,6 @@ void Texture::allocMemory() {
     memory = device.allocateMemory(allocInfo);
 }
 
-void Texture::transformData2Image(Buffer& buffer, uint32_t w, uint32_t h) {
-    Context::Instance().commandManager->ExecuteCmd(Context::Instance().graphicsQueue,
-        [&](vk::CommandBuffer cmdBuf){
-            vk::BufferImageCopy region;
-            vk::ImageSubresourceLayers subsource;
-            subsource.setAspectMask(vk::ImageAspectFlagBits::eColor)
-                     .setBaseArrayLayer(0)
-                     .setMipLevel(0)
-                     .setLayerCount(1);
-            region.setBufferImageHeight(0)
-                  .setBufferOffset(0)
-                  .setImageOffset(0)
-                  .setImageExtent({w, h, 1})
-                  .setBufferRowLength(0)
-                  .setImageSubresource(subsource);
-            cmdBuf.copyBufferToImage(buffer.buffer, image,
-                                     vk::ImageLayout::eTransferDstOptimal,
-                                     region);
-        });
-}
-
-void Texture::transitionImageLayoutFromUndefine2Dst() {
-    Context::Instance().commandManager->ExecuteCmd(Context::Instance().graphicsQueue,
-        [&](vk::CommandBuffer cmdBuf){
-            vk::ImageMemoryBarrier barrier;
-            vk::ImageSubresourceRange range;
-            range.setLayerCount(1)
-                 .setBaseArrayLayer(0)
-                 .setLevelCount(1)
-                 .setBaseMipLevel(0)
-                 .setAspectMask(vk::ImageAspectFlagBits::eColor);
-            barrier.setImage(image)
-                   .setOldLayout(vk::ImageLayout::eUndefined)
-                   .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
-                   .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-                   .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-                   .setDstAccessMask((vk::AccessFlagBits::eTransferWrite))
-                   .setSubresourceRange(range);
-            cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
-                                   {}, {}, nullptr, barrier);
-        });
-}
-
-void Texture::transitionImageLayoutFromDst2Optimal() {
-    Context::Instance().commandManager->ExecuteCmd(Context::Instance().graphicsQueue,
-        [&](vk::CommandBuffer cmdBuf){
-            vk::ImageMemoryBarrier barrier;
-            vk::ImageSubresourceRange range;
-            range.setLayerCount(1)
-                 .setBaseArrayLayer(0)
-                 .setLevelCount(1)
-                 .setBaseMipLevel(0)
-                 .setAspectMask(vk::ImageAspectFlagBits::eColor);
-            barrier.setImage(image)
-                   .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
-                   .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-                   .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-                   .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
-                   .setSrcAccessMask((vk::AccessFlagBits::eTransferWrite))
-                   .setDstAccessMask((vk::AccessFlagBits::eShaderRead))
-                   .setSubresourceRange(range);
-            cmdBuf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
-                                   {}, {}, nullptr, barrier);
-        });
-}
-
 void Texture::createImageView() {
     vk::ImageViewCreateInfo createInfo;
     vk::ComponentMapping mapping;
@@ -158,7 +123,7 @@ void Texture::createImageView() {
     createInfo.setImage(image)
               .setViewType(vk::ImageViewType::e2D)
               .setComponents(mapping)
-              .setFormat(vk::Format::eR8G8B8A8Srgb)
+              .setFormat(format_)
               .setSubresourceRange(range);
     view = Context::Instance().device.createImageView(createInfo);
 }
@@ -185,8 +150,8 @@ Texture* TextureManager::Load(const std::string& filename) {
     return datas_.back().get();
 }
 
-Texture* TextureManager::Create(void* data, uint32_t w, uint32_t h) {
-    datas_.push_back(std::unique_ptr<Texture>(new Texture(data, w, h)));
+Texture* TextureManager::Create(void* data, uint32_t w, uint32_t h, vk::Format format) {
+    datas_.push_back(std::unique_ptr<Texture>(new Texture(data, w, h, format)));
     return datas_.back().get();
 }
 
@@ -200,8 +165,10 @@ void TextureManager::Destroy(Texture* texture) {
                                 return t.get() == texture;
                            });
     if (it != datas_.end()) {
-        Context::Instance().device.waitIdle();
+        // the texture may be used by frames in flight or the frame being recorded
+        Texture* released = it->release();
         datas_.erase(it);
+        Context::Instance().DeferDestroy([released]() { delete released; });
         return;
     }
 }
@@ -0,0 +1,66 @@
+#include "toy2d/thread_pool.hpp"
+
+namespace toy2d {
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+    for (uint32_t i = 1; i < threadCount; i++) {
+        workers_.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    taskCv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func) {
+    if (count == 0) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    task_ = &func;
+    taskCount_ = count;
+    nextTask_ = 0;
+    finishedTask_ = 0;
+    generation_ ++;
+    taskCv_.notify_all();
+
+    runTasks(lock);
+    doneCv_.wait(lock, [this]() { return finishedTask_ == taskCount_; });
+    task_ = nullptr;
+}
+
+void ThreadPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t seenGeneration = 0;
+    while (true) {
+        taskCv_.wait(lock, [&]() { return quit_ || generation_ != seenGeneration; });
+        if (quit_) {
+            return;
+        }
+        seenGeneration = generation_;
+        runTasks(lock);
+    }
+}
+
+void ThreadPool::runTasks(std::unique_lock<std::mutex>& lock) {
+    while (task_ && nextTask_ < taskCount_) {
+        uint32_t index = nextTask_ ++;
+        auto task = task_;
+        lock.unlock();
+        (*task)(index);
+        lock.lock();
+        if (++ finishedTask_ == taskCount_) {
+            doneCv_.notify_all();
+        }
+    }
+}
+
+}
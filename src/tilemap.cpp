@@ -0,0 +1,154 @@
+#include "toy2d/tilemap.hpp"
+#include "toy2d/texture.hpp"
+#include "toy2d/context.hpp"
+#include "toy2d/buffer.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace toy2d {
+
+Tilemap::Tilemap(Texture& tileset, uint32_t columns, uint32_t rows,
+                 uint32_t width, uint32_t height, const Size& tileSize)
+    : tileset_(tileset), columns_(columns), rows_(rows), width_(width), height_(height), tileSize_(tileSize) {
+    tiles_.resize(width_ * height_, EmptyTile);
+    chunksX_ = (width_ + ChunkSize - 1) / ChunkSize;
+    chunksY_ = (height_ + ChunkSize - 1) / ChunkSize;
+    chunks_.resize(chunksX_ * chunksY_);
+    freeSlots_ = std::make_shared<std::vector<uint32_t>>();
+}
+
+Tilemap::~Tilemap() {
+    for (auto& chunk : chunks_) {
+        release(chunk);
+    }
+    // frames in flight may still draw the chunks
+    for (auto& block : blocks_) {
+        Buffer* buffer = block.release();
+        Context::Instance().DeferDestroy([buffer]() { delete buffer; });
+    }
+}
+
+void Tilemap::release(Chunk& chunk) {
+    // frames in flight may still draw the slot, it is reused once they finished
+    if (chunk.slot != NoSlot) {
+        auto freeSlots = freeSlots_;
+        uint32_t slot = chunk.slot;
+        Context::Instance().DeferDestroy([freeSlots, slot]() { freeSlots->push_back(slot); });
+        chunk.slot = NoSlot;
+    }
+    chunk.vertexCount = 0;
+}
+
+uint32_t Tilemap::allocateSlot() {
+    if (freeSlots_->empty()) {
+        blocks_.emplace_back(new Buffer(vk::BufferUsageFlagBits::eVertexBuffer|vk::BufferUsageFlagBits::eTransferDst,
+                                        sizeof(Vertex) * ChunkVertices * SlotsPerBlock,
+                                        vk::MemoryPropertyFlagBits::eDeviceLocal));
+        // lowest slot last, so it is handed out first
+        uint32_t first = static_cast<uint32_t>(blocks_.size() - 1) * SlotsPerBlock;
+        for (uint32_t i = SlotsPerBlock; i > 0; i--) {
+            freeSlots_->push_back(first + i - 1);
+        }
+    }
+    uint32_t slot = freeSlots_->back();
+    freeSlots_->pop_back();
+    return slot;
+}
+
+void Tilemap::SetTile(uint32_t x, uint32_t y, uint32_t tile) {
+    auto& current = tiles_[y * width_ + x];
+    if (current != tile) {
+        current = tile;
+        chunkOf(x, y).dirty = true;
+    }
+}
+
+void Tilemap::Fill(uint32_t tile) {
+    std::fill(tiles_.begin(), tiles_.end(), tile);
+    for (auto& chunk : chunks_) {
+        chunk.dirty = true;
+    }
+}
+
+void Tilemap::CollectVisible(const Rect& area, std::vector<ChunkDraw>& out) {
+    float chunkW = tileSize_.w * ChunkSize;
+    float chunkH = tileSize_.h * ChunkSize;
+    float left = area.position.x - std::abs(area.size.w) * 0.5f - position.x;
+    float top = area.position.y - std::abs(area.size.h) * 0.5f - position.y;
+    float right = left + std::abs(area.size.w);
+    float bottom = top + std::abs(area.size.h);
+    if (chunks_.empty() || right < 0 || bottom < 0) {
+        return;
+    }
+
+    auto toChunk = [](float value, float size, uint32_t count) {
+        return static_cast<uint32_t>(std::clamp(std::floor(value / size), 0.0f, static_cast<float>(count)));
+    };
+    uint32_t beginX = toChunk(left, chunkW, chunksX_);
+    uint32_t endX = toChunk(right, chunkW, chunksX_ - 1) + 1;
+    uint32_t beginY = toChunk(top, chunkH, chunksY_);
+    uint32_t endY = toChunk(bottom, chunkH, chunksY_ - 1) + 1;
+
+    for (uint32_t y = beginY; y < endY; y++) {
+        for (uint32_t x = beginX; x < endX; x++) {
+            auto& chunk = chunks_[y * chunksX_ + x];
+            if (chunk.dirty) {
+                rebuild(x, y, chunk);
+            }
+            if (chunk.vertexCount > 0) {
+                out.push_back({blocks_[chunk.slot / SlotsPerBlock]->buffer,
+                               chunk.slot % SlotsPerBlock * ChunkVertices,
+                               chunk.vertexCount});
+            }
+        }
+    }
+}
+
+void Tilemap::rebuild(uint32_t chunkX, uint32_t chunkY, Chunk& chunk) {
+    chunk.dirty = false;
+    release(chunk);
+
+    std::vector<Vertex> vertices;
+    uint32_t endX = std::min(width_, (chunkX + 1) * ChunkSize);
+    uint32_t endY = std::min(height_, (chunkY + 1) * ChunkSize);
+    for (uint32_t y = chunkY * ChunkSize; y < endY; y++) {
+        for (uint32_t x = chunkX * ChunkSize; x < endX; x++) {
+            uint32_t tile = tiles_[y * width_ + x];
+            if (tile == EmptyTile || tile >= columns_ * rows_) {
+                continue;
+            }
+
+            float left = x * tileSize_.w;
+            float top = y * tileSize_.h;
+            float right = left + tileSize_.w;
+            float bottom = top + tileSize_.h;
+            float u0 = static_cast<float>(tile % columns_) / columns_;
+            float v0 = static_cast<float>(tile / columns_) / rows_;
+            float u1 = u0 + 1.0f / columns_;
+            float v1 = v0 + 1.0f / rows_;
+
+            // same winding as the renderer's unit quad
+            Vertex quad[4] = {
+                {Vec{left, top}, Vec{u0, v0}},
+                {Vec{right, top}, Vec{u1, v0}},
+                {Vec{right, bottom}, Vec{u1, v1}},
+                {Vec{left, bottom}, Vec{u0, v1}},
+            };
+            vertices.insert(vertices.end(), {quad[0], quad[1], quad[3], quad[1], quad[2], quad[3]});
+        }
+    }
+
+    if (vertices.empty()) {
+        return;
+    }
+
+    // a fresh slot, the old one may still be read by frames in flight.
+    // The upload joins the frame's batch, so rebuilt chunks cost no extra submits
+    chunk.slot = allocateSlot();
+    auto& block = *blocks_[chunk.slot / SlotsPerBlock];
+    vk::DeviceSize offset = sizeof(Vertex) * ChunkVertices * (chunk.slot % SlotsPerBlock);
+    Context::Instance().uploader->UploadBuffer(block.buffer, offset, vertices.data(), sizeof(Vertex) * vertices.size());
+    chunk.vertexCount = static_cast<uint32_t>(vertices.size());
+}
+
+}
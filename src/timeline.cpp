@@ -0,0 +1,105 @@
+#include "toy2d/timeline.hpp"
+#include "toy2d/context.hpp"
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace toy2d {
+
+Timeline::Timeline(vk::Queue queue): queue_(queue) {
+    vk::SemaphoreTypeCreateInfo typeInfo;
+    typeInfo.setSemaphoreType(vk::SemaphoreType::eTimeline)
+            .setInitialValue(0);
+    vk::SemaphoreCreateInfo createInfo;
+    createInfo.setPNext(&typeInfo);
+    semaphore = Context::Instance().device.createSemaphore(createInfo);
+}
+
+Timeline::~Timeline() {
+    WaitIdle();
+    Collect();
+    Context::Instance().device.destroySemaphore(semaphore);
+}
+
+uint64_t Timeline::Submit(const std::vector<vk::CommandBuffer>& cmds,
+                          const std::vector<Wait>& waits,
+                          const std::vector<vk::Semaphore>& binarySignals) {
+    uint64_t value = pending_ + 1;
+
+    std::vector<vk::Semaphore> waitSems;
+    std::vector<uint64_t> waitValues;
+    std::vector<vk::PipelineStageFlags> waitStages;
+    for (auto& wait : waits) {
+        waitSems.push_back(wait.semaphore);
+        waitValues.push_back(wait.value);
+        waitStages.push_back(wait.stages);
+    }
+
+    std::vector<vk::Semaphore> signalSems = binarySignals;
+    std::vector<uint64_t> signalValues(binarySignals.size(), 0);
+    signalSems.push_back(semaphore);
+    signalValues.push_back(value);
+
+    vk::TimelineSemaphoreSubmitInfo timelineInfo;
+    timelineInfo.setWaitSemaphoreValues(waitValues)
+                .setSignalSemaphoreValues(signalValues);
+    vk::SubmitInfo submit;
+    submit.setCommandBuffers(cmds)
+          .setWaitSemaphores(waitSems)
+          .setWaitDstStageMask(waitStages)
+          .setSignalSemaphores(signalSems)
+          .setPNext(&timelineInfo);
+    queue_.submit(submit);
+
+    pending_ = value;
+    return value;
+}
+
+uint64_t Timeline::Completed() {
+    if (completed_ < pending_) {
+        completed_ = Context::Instance().device.getSemaphoreCounterValue(semaphore);
+    }
+    return completed_;
+}
+
+bool Timeline::IsCompleted(uint64_t value) {
+    return value <= completed_ || value <= Completed();
+}
+
+void Timeline::WaitFor(uint64_t value) {
+    if (IsCompleted(value)) {
+        return;
+    }
+
+    vk::SemaphoreWaitInfo waitInfo;
+    waitInfo.setSemaphores(semaphore)
+            .setValues(value);
+    if (Context::Instance().device.waitSemaphores(waitInfo, std::numeric_limits<uint64_t>::max()) != vk::Result::eSuccess) {
+        throw std::runtime_error("wait for timeline semaphore failed");
+    }
+    completed_ = std::max(completed_, value);
+}
+
+void Timeline::Defer(uint64_t value, std::function<void()> func) {
+    deferred_.push_back({value, std::move(func)});
+}
+
+void Timeline::Collect() {
+    if (deferred_.empty()) {
+        return;
+    }
+
+    // callbacks may defer more work, so run them from a detached list
+    uint64_t completed = Completed();
+    std::vector<Deferred> ready;
+    auto it = std::stable_partition(deferred_.begin(), deferred_.end(),
+                                    [=](const Deferred& d) { return d.value > completed; });
+    std::move(it, deferred_.end(), std::back_inserter(ready));
+    deferred_.erase(it, deferred_.end());
+
+    for (auto& d : ready) {
+        d.func();
+    }
+}
+
+}
@@ -4,8 +4,8 @@ namespace toy2d {
 
 std::unique_ptr<Renderer> renderer_;
 
-void Init(std::vector<const char*>& extensions, Context::GetSurfaceCallback cb, int windowWidth, int windowHeight) {
-    Context::Init(extensions, cb);
+void Init(std::vector<const char*>& extensions, Context::GetSurfaceCallback cb, int windowWidth, int windowHeight, const Config& config) {
+    Context::Init(extensions, cb, config);
     auto& ctx = Context::Instance();
     ctx.initSwapchain(windowWidth, windowHeight);
     ctx.initShaderModules();
@@ -13,17 +13,24 @@ void Init(std::vector<const char*>& extensions, Context::GetSurfaceCallback cb,
     ctx.initGraphicsPipeline();
     ctx.swapchain->InitFramebuffers();
     ctx.initCommandPool();
+    ctx.initTimelines();
+    ctx.initUploader();
     ctx.initSampler();
 
-    int maxFlightCount = 2;
+    int maxFlightCount = std::max<int>(1, config.maxQueuedFrames);
+    FrameClock::Init(maxFlightCount);
     DescriptorSetManager::Init(maxFlightCount);
-    renderer_ = std::make_unique<Renderer>(maxFlightCount);
+    renderer_ = std::make_unique<Renderer>();
     renderer_->SetProject(windowWidth, 0, 0, windowHeight, -1, 1);
 }
 
 void Quit() {
-    Context::Instance().device.waitIdle();
+    auto& ctx = Context::Instance();
+    ctx.device.waitIdle();
     renderer_.reset();
+    // run pending destructions while the managers they use are still alive
+    ctx.ScheduleDeferred(ctx.graphicsTimeline->Pending());
+    ctx.CollectTimelines();
     TextureManager::Instance().Clear();
     DescriptorSetManager::Quit();
     Context::Quit();
@@ -42,13 +49,7 @@ Renderer* GetRenderer() {
 }
 
 void ResizeSwapchainImage(int w, int h) {
-    auto& ctx = Context::Instance();
-    ctx.device.waitIdle();
-
-    ctx.swapchain.reset();
-    ctx.getSurface();
-    ctx.initSwapchain(w, h);
-    ctx.swapchain->InitFramebuffers();
+    renderer_->RequestSwapchainRecreate(w, h);
 }
 
 }
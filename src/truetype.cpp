@@ -0,0 +1,491 @@
+#include "toy2d/truetype.hpp"
+#include "toy2d/tool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace toy2d {
+
+// composite glyphs nest rarely, this only guards against cycles in broken fonts
+static constexpr int MaxCompositeDepth = 8;
+
+TrueTypeFont::TrueTypeFont(const std::string& filename) {
+    auto content = ReadWholeFile(filename);
+    if (content.empty()) {
+        throw std::runtime_error("read font " + filename + " failed");
+    }
+    data_.assign(content.begin(), content.end());
+    parse();
+}
+
+TrueTypeFont::TrueTypeFont(std::vector<uint8_t> data): data_(std::move(data)) {
+    parse();
+}
+
+uint8_t TrueTypeFont::u8(uint32_t offset) const {
+    if (offset >= data_.size()) {
+        throw std::runtime_error("truncated TrueType font");
+    }
+    return data_[offset];
+}
+
+uint16_t TrueTypeFont::u16(uint32_t offset) const {
+    return static_cast<uint16_t>(u8(offset) << 8 | u8(offset + 1));
+}
+
+uint32_t TrueTypeFont::u32(uint32_t offset) const {
+    return static_cast<uint32_t>(u16(offset)) << 16 | u16(offset + 2);
+}
+
+uint32_t TrueTypeFont::findTable(uint32_t fontOffset, const char* tag) const {
+    uint16_t numTables = u16(fontOffset + 4);
+    for (uint16_t i = 0; i < numTables; i++) {
+        uint32_t record = fontOffset + 12 + i * 16;
+        u32(record + 12);
+        if (memcmp(&data_[record], tag, 4) == 0) {
+            return u32(record + 8);
+        }
+    }
+    return 0;
+}
+
+void TrueTypeFont::parse() {
+    // a collection starts with its own header, use its first font
+    uint32_t font = 0;
+    if (data_.size() >= 4 && memcmp(data_.data(), "ttcf", 4) == 0) {
+        font = u32(12);
+    }
+    uint32_t version = u32(font);
+    if (version != 0x00010000 && version != 0x74727565 /* 'true' */) {
+        throw std::runtime_error("not a TrueType font, only glyf outlines are supported");
+    }
+
+    uint32_t head = findTable(font, "head");
+    uint32_t hhea = findTable(font, "hhea");
+    uint32_t maxp = findTable(font, "maxp");
+    uint32_t cmap = findTable(font, "cmap");
+    loca_ = findTable(font, "loca");
+    glyf_ = findTable(font, "glyf");
+    hmtx_ = findTable(font, "hmtx");
+    if (!head || !hhea || !maxp || !cmap || !loca_ || !glyf_ || !hmtx_) {
+        throw std::runtime_error("TrueType font misses a required table");
+    }
+
+    unitsPerEm_ = u16(head + 18);
+    longLoca_ = i16(head + 50) != 0;
+    ascender_ = i16(hhea + 4);
+    descender_ = i16(hhea + 6);
+    lineGap_ = i16(hhea + 8);
+    numHMetrics_ = u16(hhea + 34);
+    numGlyphs_ = u16(maxp + 4);
+    if (unitsPerEm_ == 0 || numHMetrics_ == 0) {
+        throw std::runtime_error("TrueType font has broken metrics");
+    }
+
+    // prefer the full unicode table, then the BMP one
+    uint16_t numSubtables = u16(cmap + 2);
+    uint32_t bmp = 0;
+    for (uint16_t i = 0; i < numSubtables; i++) {
+        uint32_t record = cmap + 4 + i * 8;
+        uint16_t platform = u16(record);
+        uint16_t encoding = u16(record + 2);
+        uint32_t subtable = cmap + u32(record + 4);
+        uint16_t format = u16(subtable);
+        bool unicode = platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10));
+        if (!unicode) {
+            continue;
+        }
+        if (format == 12) {
+            cmap_ = subtable;
+            break;
+        }
+        if (format == 4 && !bmp) {
+            bmp = subtable;
+        }
+    }
+    if (!cmap_) {
+        cmap_ = bmp;
+    }
+    if (!cmap_) {
+        throw std::runtime_error("TrueType font has no unicode cmap");
+    }
+}
+
+Font::Metrics TrueTypeFont::GetMetrics() const {
+    Font::Metrics metrics;
+    metrics.ascent = static_cast<float>(ascender_) / unitsPerEm_;
+    metrics.descent = static_cast<float>(-descender_) / unitsPerEm_;
+    metrics.lineGap = static_cast<float>(lineGap_) / unitsPerEm_;
+    return metrics;
+}
+
+uint32_t TrueTypeFont::GlyphIndex(uint32_t codepoint) const {
+    if (u16(cmap_) == 12) {
+        uint32_t groups = u32(cmap_ + 12);
+        // groups are sorted by their start code
+        uint32_t lo = 0, hi = groups;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            uint32_t group = cmap_ + 16 + mid * 12;
+            if (codepoint < u32(group)) {
+                hi = mid;
+            } else if (codepoint > u32(group + 4)) {
+                lo = mid + 1;
+            } else {
+                return u32(group + 8) + codepoint - u32(group);
+            }
+        }
+        return 0;
+    }
+
+    if (codepoint > 0xFFFF) {
+        return 0;
+    }
+    uint16_t segCount = u16(cmap_ + 6) / 2;
+    uint32_t endCodes = cmap_ + 14;
+    uint32_t startCodes = endCodes + segCount * 2 + 2;
+    uint32_t idDeltas = startCodes + segCount * 2;
+    uint32_t idRangeOffsets = idDeltas + segCount * 2;
+    for (uint16_t i = 0; i < segCount; i++) {
+        if (codepoint > u16(endCodes + i * 2)) {
+            continue;
+        }
+        uint16_t start = u16(startCodes + i * 2);
+        if (codepoint < start) {
+            return 0;
+        }
+        uint16_t delta = u16(idDeltas + i * 2);
+        uint16_t rangeOffset = u16(idRangeOffsets + i * 2);
+        if (rangeOffset == 0) {
+            return static_cast<uint16_t>(codepoint + delta);
+        }
+        uint16_t glyph = u16(idRangeOffsets + i * 2 + rangeOffset + (codepoint - start) * 2);
+        return glyph == 0 ? 0 : static_cast<uint16_t>(glyph + delta);
+    }
+    return 0;
+}
+
+float TrueTypeFont::advance(uint32_t glyph) const {
+    uint32_t metric = std::min<uint32_t>(glyph, numHMetrics_ - 1);
+    return u16(hmtx_ + metric * 4);
+}
+
+void TrueTypeFont::loadOutline(uint32_t glyph, std::vector<Contour>& out, int depth) const {
+    if (glyph >= numGlyphs_ || depth > MaxCompositeDepth) {
+        return;
+    }
+    uint32_t begin = longLoca_ ? u32(loca_ + glyph * 4) : u16(loca_ + glyph * 2) * 2u;
+    uint32_t end = longLoca_ ? u32(loca_ + glyph * 4 + 4) : u16(loca_ + glyph * 2 + 2) * 2u;
+    if (begin >= end) {
+        return; // blank, e.g. space
+    }
+    uint32_t offset = glyf_ + begin;
+    int16_t numContours = i16(offset);
+
+    if (numContours < 0) {
+        // components are other glyphs placed with a 2x2 transform and an offset
+        enum : uint16_t {
+            ArgsAreWords = 0x1,
+            ArgsAreXY = 0x2,
+            HaveScale = 0x8,
+            MoreComponents = 0x20,
+            HaveXYScale = 0x40,
+            HaveTwoByTwo = 0x80,
+        };
+        uint32_t p = offset + 10;
+        uint16_t flags;
+        do {
+            flags = u16(p);
+            uint16_t component = u16(p + 2);
+            p += 4;
+            float dx = 0, dy = 0;
+            if (flags & ArgsAreWords) {
+                dx = i16(p);
+                dy = i16(p + 2);
+                p += 4;
+            } else {
+                dx = static_cast<int8_t>(u8(p));
+                dy = static_cast<int8_t>(u8(p + 1));
+                p += 2;
+            }
+            // point matching placement is rare, such components stay unmoved
+            if (!(flags & ArgsAreXY)) {
+                dx = dy = 0;
+            }
+            auto f2dot14 = [&](uint32_t at) { return i16(at) / 16384.0f; };
+            float a = 1, b = 0, c = 0, d = 1;
+            if (flags & HaveScale) {
+                a = d = f2dot14(p);
+                p += 2;
+            } else if (flags & HaveXYScale) {
+                a = f2dot14(p);
+                d = f2dot14(p + 2);
+                p += 4;
+            } else if (flags & HaveTwoByTwo) {
+                a = f2dot14(p);
+                b = f2dot14(p + 2);
+                c = f2dot14(p + 4);
+                d = f2dot14(p + 6);
+                p += 8;
+            }
+
+            std::vector<Contour> parts;
+            loadOutline(component, parts, depth + 1);
+            for (auto& contour : parts) {
+                for (auto& point : contour) {
+                    float x = point.x, y = point.y;
+                    point.x = a * x + c * y + dx;
+                    point.y = b * x + d * y + dy;
+                }
+                out.push_back(std::move(contour));
+            }
+        } while (flags & MoreComponents);
+        return;
+    }
+
+    enum : uint8_t {
+        OnCurve = 0x1,
+        XShort = 0x2,
+        YShort = 0x4,
+        Repeat = 0x8,
+        XSameOrPositive = 0x10,
+        YSameOrPositive = 0x20,
+    };
+    uint32_t endPoints = offset + 10;
+    uint32_t pointCount = numContours > 0 ? u16(endPoints + (numContours - 1) * 2) + 1u : 0;
+    uint32_t p = endPoints + numContours * 2;
+    p += 2 + u16(p); // skip the hinting instructions
+
+    std::vector<uint8_t> flags(pointCount);
+    for (uint32_t i = 0; i < pointCount;) {
+        uint8_t flag = u8(p++);
+        uint32_t count = 1;
+        if (flag & Repeat) {
+            count += u8(p++);
+        }
+        for (; count > 0 && i < pointCount; count--) {
+            flags[i++] = flag;
+        }
+    }
+
+    // coordinates are deltas, short ones are unsigned with the sign in the flag
+    std::vector<Point> points(pointCount);
+    int32_t value = 0;
+    for (uint32_t i = 0; i < pointCount; i++) {
+        if (flags[i] & XShort) {
+            value += (flags[i] & XSameOrPositive) ? u8(p) : -u8(p);
+            p += 1;
+        } else if (!(flags[i] & XSameOrPositive)) {
+            value += i16(p);
+            p += 2;
+        }
+        points[i].x = static_cast<float>(value);
+        points[i].onCurve = flags[i] & OnCurve;
+    }
+    value = 0;
+    for (uint32_t i = 0; i < pointCount; i++) {
+        if (flags[i] & YShort) {
+            value += (flags[i] & YSameOrPositive) ? u8(p) : -u8(p);
+            p += 1;
+        } else if (!(flags[i] & YSameOrPositive)) {
+            value += i16(p);
+            p += 2;
+        }
+        points[i].y = static_cast<float>(value);
+    }
+
+    uint32_t first = 0;
+    for (int16_t i = 0; i < numContours; i++) {
+        uint32_t last = std::min<uint32_t>(u16(endPoints + i * 2), pointCount - 1);
+        if (last >= first) {
+            out.emplace_back(points.begin() + first, points.begin() + last + 1);
+        }
+        first = last + 1;
+    }
+}
+
+// Signed area coverage accumulation: every line adds the area it covers to the
+// pixels it crosses and the cover change to the pixel after, a running sum over
+// the rows gives the coverage. Points must lie inside [0, width] x [0, height].
+static void accumulateLine(std::vector<float>& acc, uint32_t width, uint32_t height,
+                           float x0, float y0, float x1, float y1) {
+    if (y0 == y1) {
+        return;
+    }
+    float dir = 1;
+    if (y0 > y1) {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+        dir = -1;
+    }
+    float dxdy = (x1 - x0) / (y1 - y0);
+    float x = x0;
+    auto rowEnd = std::min<uint32_t>(height, static_cast<uint32_t>(std::ceil(y1)));
+    for (auto row = static_cast<uint32_t>(std::max(y0, 0.0f)); row < rowEnd; row++) {
+        size_t start = static_cast<size_t>(row) * width;
+        float dy = std::min(row + 1.0f, y1) - std::max(static_cast<float>(row), y0);
+        float xnext = x + dxdy * dy;
+        float d = dy * dir;
+        float left = std::min(x, xnext);
+        float right = std::max(x, xnext);
+        float leftFloor = std::floor(left);
+        auto li = static_cast<int32_t>(leftFloor);
+        float rightCeil = std::ceil(right);
+        auto ri = static_cast<int32_t>(rightCeil);
+
+        if (ri <= li + 1) {
+            // inside one pixel column
+            float mid = 0.5f * (x + xnext) - leftFloor;
+            acc[start + li] += d - d * mid;
+            acc[start + li + 1] += d * mid;
+        } else {
+            float s = 1.0f / (right - left);
+            float leftFrac = left - leftFloor;
+            float a0 = 0.5f * s * (1 - leftFrac) * (1 - leftFrac);
+            float rightFrac = right - rightCeil + 1;
+            float am = 0.5f * s * rightFrac * rightFrac;
+            acc[start + li] += d * a0;
+            if (ri == li + 2) {
+                acc[start + li + 1] += d * (1 - a0 - am);
+            } else {
+                float a1 = s * (1.5f - leftFrac);
+                acc[start + li + 1] += d * (a1 - a0);
+                for (int32_t xi = li + 2; xi < ri - 1; xi++) {
+                    acc[start + xi] += d * s;
+                }
+                float a2 = a1 + (ri - li - 3) * s;
+                acc[start + ri - 1] += d * (1 - a2 - am);
+            }
+            acc[start + ri] += d * am;
+        }
+        x = xnext;
+    }
+}
+
+bool TrueTypeFont::Rasterize(uint32_t codepoint, float pixelSize, GlyphBitmap& out) const {
+    uint32_t glyph = GlyphIndex(codepoint);
+    if (glyph == 0) {
+        return false;
+    }
+
+    float scale = pixelSize / unitsPerEm_;
+    out = GlyphBitmap{};
+    out.advance = advance(glyph) * scale;
+
+    std::vector<Contour> contours;
+    loadOutline(glyph, contours, 0);
+    float minX = std::numeric_limits<float>::max(), maxX = std::numeric_limits<float>::lowest();
+    float minY = minX, maxY = maxX;
+    for (auto& contour : contours) {
+        for (auto& point : contour) {
+            minX = std::min(minX, point.x);
+            maxX = std::max(maxX, point.x);
+            minY = std::min(minY, point.y);
+            maxY = std::max(maxY, point.y);
+        }
+    }
+    if (minX > maxX) {
+        return true;
+    }
+
+    // font units are y up, the bitmap is y down with the pen on the baseline
+    float left = std::floor(minX * scale);
+    float top = std::floor(-maxY * scale);
+    out.width = static_cast<uint32_t>(std::ceil(maxX * scale) - left);
+    out.height = static_cast<uint32_t>(std::ceil(-minY * scale) - top);
+    out.offsetX = left;
+    out.offsetY = top;
+    if (out.width == 0 || out.height == 0) {
+        out.width = out.height = 0;
+        return true;
+    }
+
+    // spare pixels, lines ending on the right edge add to the pixel after it
+    std::vector<float> acc(out.width * out.height + 4, 0);
+    auto line = [&](const Vec& a, const Vec& b) {
+        accumulateLine(acc, out.width, out.height, a.x, a.y, b.x, b.y);
+    };
+    auto toBitmap = [&](float x, float y) {
+        return Vec{std::clamp(x * scale - left, 0.0f, static_cast<float>(out.width)),
+                   std::clamp(-y * scale - top, 0.0f, static_cast<float>(out.height))};
+    };
+    auto curve = [&](const Vec& a, const Vec& control, const Vec& b) {
+        // enough segments to keep the error well below a pixel
+        float dx = a.x - 2 * control.x + b.x;
+        float dy = a.y - 2 * control.y + b.y;
+        auto segments = static_cast<uint32_t>(std::ceil(std::sqrt(std::sqrt(dx * dx + dy * dy) * 2)));
+        segments = std::clamp<uint32_t>(segments, 1, 32);
+        Vec previous = a;
+        for (uint32_t i = 1; i <= segments; i++) {
+            float t = static_cast<float>(i) / segments;
+            float u = 1 - t;
+            Vec next{u * u * a.x + 2 * u * t * control.x + t * t * b.x,
+                     u * u * a.y + 2 * u * t * control.y + t * t * b.y};
+            line(previous, next);
+            previous = next;
+        }
+    };
+
+    for (auto& contour : contours) {
+        size_t count = contour.size();
+        if (count < 2) {
+            continue;
+        }
+        // start on an on-curve point, or between two off-curve ones
+        size_t startIndex = 0;
+        while (startIndex < count && !contour[startIndex].onCurve) {
+            startIndex++;
+        }
+        Vec start;
+        if (startIndex == count) {
+            startIndex = 0;
+            start = toBitmap((contour[0].x + contour[1].x) * 0.5f, (contour[0].y + contour[1].y) * 0.5f);
+        } else {
+            start = toBitmap(contour[startIndex].x, contour[startIndex].y);
+        }
+
+        Vec pen = start;
+        bool haveControl = false;
+        Vec control;
+        for (size_t k = 1; k <= count; k++) {
+            auto& point = contour[(startIndex + k) % count];
+            Vec p = toBitmap(point.x, point.y);
+            if (point.onCurve) {
+                if (haveControl) {
+                    curve(pen, control, p);
+                } else {
+                    line(pen, p);
+                }
+                pen = p;
+                haveControl = false;
+            } else if (haveControl) {
+                // two off-curve points imply an on-curve one between them
+                Vec mid{(control.x + p.x) * 0.5f, (control.y + p.y) * 0.5f};
+                curve(pen, control, mid);
+                pen = mid;
+                control = p;
+            } else {
+                control = p;
+                haveControl = true;
+            }
+        }
+        if (haveControl) {
+            curve(pen, control, start);
+        } else {
+            line(pen, start);
+        }
+    }
+
+    // overlapping contours add up, the nonzero winding rule just clamps
+    out.coverage.resize(out.width * out.height);
+    float sum = 0;
+    for (size_t i = 0; i < out.coverage.size(); i++) {
+        sum += acc[i];
+        out.coverage[i] = static_cast<uint8_t>(std::min(std::abs(sum), 1.0f) * 255.0f + 0.5f);
+    }
+    return true;
+}
+
+}
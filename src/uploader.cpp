@@ -0,0 +1,335 @@
+#include "toy2d/uploader.hpp"
+#include "toy2d/context.hpp"
+#include "toy2d/buffer.hpp"
+#include "toy2d/debug_utils.hpp"
+#include <algorithm>
+
+namespace toy2d {
+
+// graphics stages that read uploaded data
+static const vk::PipelineStageFlags ConsumerStages = vk::PipelineStageFlagBits::eVertexInput|
+                                                     vk::PipelineStageFlagBits::eVertexShader|
+                                                     vk::PipelineStageFlagBits::eFragmentShader;
+
+Uploader::Uploader() {
+    auto& ctx = Context::Instance();
+    transferFamily_ = ctx.queueInfo.transferIndex.value();
+    graphicsFamily_ = ctx.queueInfo.graphicsIndex.value();
+    ownershipTransfer_ = transferFamily_ != graphicsFamily_;
+    separateQueue_ = ctx.transferQueue != ctx.graphicsQueue;
+
+    // the graphics queue reads it too, for image updates
+    std::vector<uint32_t> families = {transferFamily_};
+    if (ownershipTransfer_) {
+        families.push_back(graphicsFamily_);
+    }
+    ring_.reset(new Buffer(vk::BufferUsageFlagBits::eTransferSrc,
+                           StagingSize,
+                           vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent,
+                           families));
+    SetDebugName(ring_->buffer, "upload staging ring");
+}
+
+Uploader::~Uploader() {
+    auto& ctx = Context::Instance();
+    // uploads nobody flushed can't be used anymore
+    if (cmd_) {
+        EndDebugLabel(cmd_);
+        cmd_.end();
+        ctx.transferCommandManager->FreeCmd(cmd_);
+    }
+    ctx.transferTimeline->WaitIdle();
+    ctx.transferTimeline->Collect();
+    ctx.graphicsTimeline->WaitIdle();
+}
+
+void Uploader::reclaim() {
+    auto& ctx = Context::Instance();
+    while (!batches_.empty() &&
+           ctx.transferTimeline->IsCompleted(batches_.front().transferValue) &&
+           ctx.graphicsTimeline->IsCompleted(batches_.front().graphicsValue)) {
+        used_ -= batches_.front().bytes;
+        batches_.pop_front();
+    }
+}
+
+Uploader::Staging Uploader::stage(const void* data, vk::DeviceSize size) {
+    vk::DeviceSize aligned = (size + StagingAlignment - 1) / StagingAlignment * StagingAlignment;
+    if (aligned > StagingSize) {
+        std::vector<uint32_t> families = {transferFamily_};
+        if (ownershipTransfer_) {
+            families.push_back(graphicsFamily_);
+        }
+        oversized_.emplace_back(new Buffer(vk::BufferUsageFlagBits::eTransferSrc,
+                                           size,
+                                           vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent,
+                                           families));
+        memcpy(oversized_.back()->map, data, size);
+        return Staging{oversized_.back()->buffer, 0};
+    }
+
+    vk::DeviceSize skipped;
+    for (;;) {
+        reclaim();
+        if (used_ == 0) {
+            head_ = 0;
+        }
+        // the end of the ring is skipped if the data doesn't fit there
+        skipped = head_ + aligned > StagingSize ? StagingSize - head_ : 0;
+        if (used_ + skipped + aligned <= StagingSize) {
+            break;
+        }
+        // full, wait for the oldest batch that reads from it
+        if (batchBytes_ > 0) {
+            Flush();
+        }
+        auto& ctx = Context::Instance();
+        ctx.transferTimeline->WaitFor(batches_.front().transferValue);
+        ctx.graphicsTimeline->WaitFor(batches_.front().graphicsValue);
+    }
+
+    vk::DeviceSize offset = skipped > 0 ? 0 : head_;
+    head_ = offset + aligned;
+    used_ += skipped + aligned;
+    batchBytes_ += skipped + aligned;
+    memcpy(static_cast<char*>(ring_->map) + offset, data, size);
+    return Staging{ring_->buffer, offset};
+}
+
+vk::CommandBuffer Uploader::recording() {
+    if (!cmd_) {
+        cmd_ = Context::Instance().transferCommandManager->CreateOneCommandBuffer();
+        vk::CommandBufferBeginInfo beginInfo;
+        beginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+        cmd_.begin(beginInfo);
+        BeginDebugLabel(cmd_, "uploads");
+    }
+    return cmd_;
+}
+
+void Uploader::UploadBuffer(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size) {
+    auto staging = stage(data, size);
+    auto cmd = recording();
+
+    // a later copy to the same bytes must not race the earlier one
+    vk::DeviceSize end = dstOffset + size;
+    if (std::any_of(written_.begin(), written_.end(), [&](const Written& written) {
+            return written.buffer == dst && written.begin < end && dstOffset < written.end;
+        })) {
+        vk::MemoryBarrier barrier;
+        barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+               .setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
+                            {}, barrier, nullptr, nullptr);
+        written_.clear();
+    }
+    written_.push_back(Written{dst, dstOffset, end});
+
+    vk::BufferCopy region;
+    region.setSrcOffset(staging.offset)
+          .setDstOffset(dstOffset)
+          .setSize(size);
+    cmd.copyBuffer(staging.buffer, dst, region);
+
+    vk::BufferMemoryBarrier barrier;
+    barrier.setBuffer(dst)
+           .setOffset(dstOffset)
+           .setSize(size)
+           .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+           .setDstAccessMask(vk::AccessFlagBits::eVertexAttributeRead|vk::AccessFlagBits::eIndexRead|
+                             vk::AccessFlagBits::eUniformRead|vk::AccessFlagBits::eShaderRead)
+           .setSrcQueueFamilyIndex(ownershipTransfer_ ? transferFamily_ : VK_QUEUE_FAMILY_IGNORED)
+           .setDstQueueFamilyIndex(ownershipTransfer_ ? graphicsFamily_ : VK_QUEUE_FAMILY_IGNORED);
+    bufferReleases_.push_back(barrier);
+
+    if (ownershipTransfer_) {
+        barrier.setSrcAccessMask({});
+        bufferAcquires_.push_back(barrier);
+    }
+}
+
+void Uploader::UploadImage(vk::Image dst, uint32_t width, uint32_t height, const void* data, vk::DeviceSize size) {
+    auto staging = stage(data, size);
+    auto cmd = recording();
+
+    vk::ImageSubresourceRange range;
+    range.setAspectMask(vk::ImageAspectFlagBits::eColor)
+         .setBaseMipLevel(0)
+         .setLevelCount(1)
+         .setBaseArrayLayer(0)
+         .setLayerCount(1);
+
+    vk::ImageMemoryBarrier toTransfer;
+    toTransfer.setImage(dst)
+              .setOldLayout(vk::ImageLayout::eUndefined)
+              .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+              .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+              .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+              .setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
+              .setSubresourceRange(range);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+                        {}, {}, nullptr, toTransfer);
+
+    vk::ImageSubresourceLayers subsource;
+    subsource.setAspectMask(vk::ImageAspectFlagBits::eColor)
+             .setBaseArrayLayer(0)
+             .setMipLevel(0)
+             .setLayerCount(1);
+    vk::BufferImageCopy region;
+    region.setBufferOffset(staging.offset)
+          .setBufferRowLength(0)
+          .setBufferImageHeight(0)
+          .setImageOffset(0)
+          .setImageExtent({width, height, 1})
+          .setImageSubresource(subsource);
+    cmd.copyBufferToImage(staging.buffer, dst, vk::ImageLayout::eTransferDstOptimal, region);
+
+    // with an ownership transfer the layout change is part of both the release and the acquire
+    vk::ImageMemoryBarrier toShader;
+    toShader.setImage(dst)
+            .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+            .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+            .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+            .setDstAccessMask(vk::AccessFlagBits::eShaderRead)
+            .setSrcQueueFamilyIndex(ownershipTransfer_ ? transferFamily_ : VK_QUEUE_FAMILY_IGNORED)
+            .setDstQueueFamilyIndex(ownershipTransfer_ ? graphicsFamily_ : VK_QUEUE_FAMILY_IGNORED)
+            .setSubresourceRange(range);
+    imageReleases_.push_back(toShader);
+
+    if (ownershipTransfer_) {
+        toShader.setSrcAccessMask({});
+        imageAcquires_.push_back(toShader);
+    }
+}
+
+void Uploader::UpdateImage(vk::Image dst, const vk::Rect2D& region, const void* data, vk::DeviceSize size) {
+    imageUpdates_.push_back(ImageUpdate{dst, region, stage(data, size)});
+}
+
+uint64_t Uploader::submitTransfer() {
+    if (!cmd_) {
+        return 0;
+    }
+    auto& ctx = Context::Instance();
+    auto& timeline = *ctx.transferTimeline;
+
+    if (separateQueue_) {
+        // release half, the semaphore wait in Flush() orders the graphics queue after it
+        for (auto& barrier : bufferReleases_) {
+            barrier.setDstAccessMask({});
+        }
+        for (auto& barrier : imageReleases_) {
+            barrier.setDstAccessMask({});
+        }
+        cmd_.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+                             {}, {}, bufferReleases_, imageReleases_);
+    } else {
+        cmd_.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, ConsumerStages,
+                             {}, {}, bufferReleases_, imageReleases_);
+    }
+    EndDebugLabel(cmd_);
+    cmd_.end();
+
+    uint64_t value = timeline.Submit({cmd_});
+    auto cmd = cmd_;
+    timeline.Defer(value, [cmd]() {
+        Context::Instance().transferCommandManager->FreeCmd(cmd);
+    });
+
+    cmd_ = nullptr;
+    written_.clear();
+    bufferReleases_.clear();
+    imageReleases_.clear();
+    return value;
+}
+
+void Uploader::recordImageUpdates(vk::CommandBuffer cmd) {
+    vk::ImageSubresourceRange range;
+    range.setAspectMask(vk::ImageAspectFlagBits::eColor)
+         .setBaseMipLevel(0)
+         .setLevelCount(1)
+         .setBaseArrayLayer(0)
+         .setLayerCount(1);
+
+    // earlier frames only read the images, so waiting for them is enough before the copies
+    std::vector<vk::ImageMemoryBarrier> toTransfer, toShader;
+    for (auto& update : imageUpdates_) {
+        vk::ImageMemoryBarrier barrier;
+        barrier.setImage(update.image)
+               .setOldLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+               .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+               .setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
+               .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+               .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+               .setSubresourceRange(range);
+        // an image updated twice is transitioned once
+        if (std::none_of(toTransfer.begin(), toTransfer.end(),
+                         [&](const vk::ImageMemoryBarrier& other) { return other.image == update.image; })) {
+            toTransfer.push_back(barrier);
+            barrier.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+                   .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+                   .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                   .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+            toShader.push_back(barrier);
+        }
+    }
+
+    BeginDebugLabel(cmd, "update images");
+    cmd.pipelineBarrier(ConsumerStages, vk::PipelineStageFlagBits::eTransfer, {}, {}, nullptr, toTransfer);
+    vk::ImageSubresourceLayers subsource;
+    subsource.setAspectMask(vk::ImageAspectFlagBits::eColor)
+             .setBaseArrayLayer(0)
+             .setMipLevel(0)
+             .setLayerCount(1);
+    for (auto& update : imageUpdates_) {
+        vk::BufferImageCopy region;
+        region.setBufferOffset(update.staging.offset)
+              .setBufferRowLength(0)
+              .setBufferImageHeight(0)
+              .setImageOffset({update.region.offset.x, update.region.offset.y, 0})
+              .setImageExtent({update.region.extent.width, update.region.extent.height, 1})
+              .setImageSubresource(subsource);
+        cmd.copyBufferToImage(update.staging.buffer, update.image, vk::ImageLayout::eTransferDstOptimal, region);
+    }
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, ConsumerStages, {}, {}, nullptr, toShader);
+    EndDebugLabel(cmd);
+    imageUpdates_.clear();
+}
+
+void Uploader::Flush() {
+    auto& ctx = Context::Instance();
+    uint64_t transferValue = submitTransfer();
+
+    uint64_t graphicsValue = 0;
+    std::vector<Timeline::Wait> waits;
+    if (separateQueue_ && transferValue) {
+        waits.push_back({ctx.transferTimeline->semaphore, transferValue,
+                         ConsumerStages|vk::PipelineStageFlagBits::eTransfer});
+    }
+    if (!bufferAcquires_.empty() || !imageAcquires_.empty() || !imageUpdates_.empty()) {
+        graphicsValue = ctx.commandManager->SubmitCmd(*ctx.graphicsTimeline, [&](vk::CommandBuffer& cmd) {
+            if (!bufferAcquires_.empty() || !imageAcquires_.empty()) {
+                BeginDebugLabel(cmd, "acquire uploads");
+                cmd.pipelineBarrier(ConsumerStages, ConsumerStages, {}, {}, bufferAcquires_, imageAcquires_);
+                EndDebugLabel(cmd);
+            }
+            if (!imageUpdates_.empty()) {
+                recordImageUpdates(cmd);
+            }
+        }, waits);
+    } else if (!waits.empty()) {
+        // same family on another queue, the wait alone makes the data visible
+        graphicsValue = ctx.graphicsTimeline->Submit({}, waits);
+    }
+    bufferAcquires_.clear();
+    imageAcquires_.clear();
+
+    if (batchBytes_ > 0 || !oversized_.empty()) {
+        batches_.push_back(Batch{batchBytes_, transferValue, graphicsValue, std::move(oversized_)});
+        batchBytes_ = 0;
+        oversized_.clear();
+    }
+    reclaim();
+}
+
+}
@@ -0,0 +1,276 @@
+#include "image.hpp"
+#include "toy2d/stb_image.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+
+bool LoadPNG(const std::string& filename, Image& out) {
+    int w, h, channels;
+    stbi_uc* pixels = stbi_load(filename.c_str(), &w, &h, &channels, STBI_rgb);
+    if (!pixels) {
+        return false;
+    }
+    out = Image(static_cast<uint32_t>(w), static_cast<uint32_t>(h));
+    std::copy(pixels, pixels + out.rgb.size(), out.rgb.begin());
+    stbi_image_free(pixels);
+    return true;
+}
+
+namespace {
+
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return table;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t adler32(const std::vector<uint8_t>& data) {
+    uint32_t a = 1, b = 0;
+    for (auto byte : data) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    return b << 16 | a;
+}
+
+class BitWriter {
+public:
+    std::vector<uint8_t> bytes;
+
+    // deflate packs values starting at the least significant bit
+    void Write(uint32_t value, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++) {
+            if (used_ == 0) {
+                bytes.push_back(0);
+            }
+            bytes.back() |= ((value >> i) & 1) << used_;
+            used_ = (used_ + 1) & 7;
+        }
+    }
+
+    // Huffman codes go most significant bit first
+    void WriteCode(uint32_t code, uint32_t length) {
+        uint32_t reversed = 0;
+        for (uint32_t i = 0; i < length; i++) {
+            reversed |= ((code >> i) & 1) << (length - 1 - i);
+        }
+        Write(reversed, length);
+    }
+
+private:
+    uint32_t used_ = 0;
+};
+
+// the fixed literal/length code of deflate
+void writeLiteral(BitWriter& out, uint32_t value) {
+    if (value < 144) {
+        out.WriteCode(0x30 + value, 8);
+    } else if (value < 256) {
+        out.WriteCode(0x190 + value - 144, 9);
+    } else if (value < 280) {
+        out.WriteCode(value - 256, 7);
+    } else {
+        out.WriteCode(0xC0 + value - 280, 8);
+    }
+}
+
+constexpr uint16_t LengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                     35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr uint8_t LengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                     3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr uint16_t DistanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                       257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                       8193, 12289, 16385, 24577};
+constexpr uint8_t DistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                       7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+void writeMatch(BitWriter& out, uint32_t length, uint32_t distance) {
+    uint32_t l = 28;
+    while (LengthBase[l] > length) {
+        l--;
+    }
+    writeLiteral(out, 257 + l);
+    out.Write(length - LengthBase[l], LengthExtra[l]);
+
+    uint32_t d = 29;
+    while (DistanceBase[d] > distance) {
+        d--;
+    }
+    out.WriteCode(d, 5);
+    out.Write(distance - DistanceBase[d], DistanceExtra[d]);
+}
+
+// One fixed Huffman block with greedy hash chain matching. Rendered test images
+// are mostly flat areas, which this already compresses well.
+std::vector<uint8_t> deflate(const std::vector<uint8_t>& data) {
+    constexpr uint32_t Window = 32768;
+    constexpr uint32_t MaxMatch = 258;
+    constexpr uint32_t MaxChain = 64;
+    constexpr uint32_t HashSize = 1 << 15;
+
+    BitWriter out;
+    out.Write(1, 1); // final block
+    out.Write(1, 2); // fixed codes
+
+    std::vector<int32_t> head(HashSize, -1);
+    std::vector<int32_t> prev(data.size(), -1);
+    auto hash = [&](size_t i) {
+        return ((data[i] << 10) ^ (data[i + 1] << 5) ^ data[i + 2]) & (HashSize - 1);
+    };
+    auto insert = [&](size_t i) {
+        if (i + 2 < data.size()) {
+            auto h = hash(i);
+            prev[i] = head[h];
+            head[h] = static_cast<int32_t>(i);
+        }
+    };
+
+    size_t i = 0;
+    while (i < data.size()) {
+        uint32_t bestLength = 0, bestDistance = 0;
+        if (i + 2 < data.size()) {
+            int32_t candidate = head[hash(i)];
+            uint32_t limit = static_cast<uint32_t>(std::min<size_t>(MaxMatch, data.size() - i));
+            for (uint32_t chain = 0; candidate >= 0 && chain < MaxChain; chain++) {
+                uint32_t distance = static_cast<uint32_t>(i - candidate);
+                if (distance > Window) {
+                    break;
+                }
+                uint32_t length = 0;
+                while (length < limit && data[candidate + length] == data[i + length]) {
+                    length++;
+                }
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestDistance = distance;
+                    if (length == limit) {
+                        break;
+                    }
+                }
+                candidate = prev[candidate];
+            }
+        }
+
+        if (bestLength >= 3) {
+            writeMatch(out, bestLength, bestDistance);
+            for (uint32_t k = 0; k < bestLength; k++) {
+                insert(i + k);
+            }
+            i += bestLength;
+        } else {
+            writeLiteral(out, data[i]);
+            insert(i);
+            i++;
+        }
+    }
+    writeLiteral(out, 256);
+    return out.bytes;
+}
+
+void writeU32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(value >> 24);
+    out.push_back((value >> 16) & 0xFF);
+    out.push_back((value >> 8) & 0xFF);
+    out.push_back(value & 0xFF);
+}
+
+void writeChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+    writeU32(out, static_cast<uint32_t>(data.size()));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    writeU32(out, crc32(&out[start], out.size() - start));
+}
+
+}
+
+bool WritePNG(const std::string& filename, const Image& image) {
+    // every row starts with its filter type, 0 keeps the bytes as they are
+    std::vector<uint8_t> raw;
+    size_t rowSize = static_cast<size_t>(image.width) * 3;
+    raw.reserve((rowSize + 1) * image.height);
+    for (uint32_t y = 0; y < image.height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), image.rgb.begin() + y * rowSize, image.rgb.begin() + (y + 1) * rowSize);
+    }
+
+    std::vector<uint8_t> header;
+    writeU32(header, image.width);
+    writeU32(header, image.height);
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8 bit RGB, no interlace
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    auto compressed = deflate(raw);
+    zlib.insert(zlib.end(), compressed.begin(), compressed.end());
+    writeU32(zlib, adler32(raw));
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    writeChunk(png, "IHDR", header);
+    writeChunk(png, "IDAT", zlib);
+    writeChunk(png, "IEND", {});
+
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = fwrite(png.data(), 1, png.size(), file) == png.size();
+    return fclose(file) == 0 && ok;
+}
+
+CompareResult CompareImages(const Image& actual, const Image& expected, uint32_t tolerance, Image* diff) {
+    CompareResult result;
+    result.sizeMatches = actual.width == expected.width && actual.height == expected.height;
+    if (!result.sizeMatches) {
+        return result;
+    }
+    result.totalPixels = actual.width * actual.height;
+    if (diff) {
+        *diff = Image(actual.width, actual.height);
+    }
+
+    for (uint32_t y = 0; y < actual.height; y++) {
+        for (uint32_t x = 0; x < actual.width; x++) {
+            const uint8_t* a = actual.Pixel(x, y);
+            const uint8_t* e = expected.Pixel(x, y);
+            uint32_t pixelDiff = 0;
+            for (int c = 0; c < 3; c++) {
+                pixelDiff = std::max<uint32_t>(pixelDiff, std::abs(a[c] - e[c]));
+            }
+            result.maxDiff = std::max(result.maxDiff, pixelDiff);
+            bool differs = pixelDiff > tolerance;
+            if (differs) {
+                result.differingPixels++;
+            }
+            if (diff) {
+                uint8_t* d = diff->Pixel(x, y);
+                if (differs) {
+                    d[0] = 255;
+                    d[1] = d[2] = 0;
+                } else {
+                    for (int c = 0; c < 3; c++) {
+                        d[c] = e[c] / 4;
+                    }
+                }
+            }
+        }
+    }
+    return result;
+}
+
+bool ImagesMatch(const CompareResult& result, float maxDifferingRatio) {
+    return result.sizeMatches && result.differingPixels <= maxDifferingRatio * result.totalPixels;
+}
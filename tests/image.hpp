@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 8 bit RGB image, rows top to bottom without padding
+struct Image {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> rgb;
+
+    Image() = default;
+    Image(uint32_t width, uint32_t height): width(width), height(height), rgb(width * height * 3, 0) {}
+
+    uint8_t* Pixel(uint32_t x, uint32_t y) { return &rgb[(y * width + x) * 3]; }
+    const uint8_t* Pixel(uint32_t x, uint32_t y) const { return &rgb[(y * width + x) * 3]; }
+};
+
+// any PNG stb_image reads, alpha is dropped
+bool LoadPNG(const std::string& filename, Image& out);
+// 8 bit RGB PNG
+bool WritePNG(const std::string& filename, const Image& image);
+
+struct CompareResult {
+    bool sizeMatches = false;
+    uint32_t maxDiff = 0;        // largest channel difference
+    uint32_t differingPixels = 0; // pixels with a channel differing more than the tolerance
+    uint32_t totalPixels = 0;
+};
+
+// per channel comparison. `diff` receives the differing pixels in red over a
+// dimmed copy of `expected`, if not null and the sizes match
+CompareResult CompareImages(const Image& actual, const Image& expected, uint32_t tolerance, Image* diff = nullptr);
+
+// at most `maxDifferingRatio` of the pixels may differ by more than the tolerance,
+// which leaves room for edge pixels where rasterizers legally disagree
+bool ImagesMatch(const CompareResult& result, float maxDifferingRatio);
@@ -0,0 +1,53 @@
+#include "image.hpp"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+// png_compare ACTUAL EXPECTED [--tolerance N] [--max-differing RATIO] [--diff FILE]
+// exits with 0 if the images match, 1 if they don't and 2 on bad arguments or files
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s ACTUAL EXPECTED [--tolerance N] [--max-differing RATIO] [--diff FILE]\n", argv[0]);
+        return 2;
+    }
+    std::string actualFile = argv[1];
+    std::string expectedFile = argv[2];
+    uint32_t tolerance = 0;
+    float maxDiffering = 0;
+    std::string diffFile;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--tolerance") == 0) {
+            tolerance = static_cast<uint32_t>(std::stoul(argv[i + 1]));
+        } else if (strcmp(argv[i], "--max-differing") == 0) {
+            maxDiffering = std::stof(argv[i + 1]);
+        } else if (strcmp(argv[i], "--diff") == 0) {
+            diffFile = argv[i + 1];
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    Image actual, expected;
+    if (!LoadPNG(actualFile, actual)) {
+        fprintf(stderr, "read %s failed\n", actualFile.c_str());
+        return 2;
+    }
+    if (!LoadPNG(expectedFile, expected)) {
+        fprintf(stderr, "read %s failed\n", expectedFile.c_str());
+        return 2;
+    }
+
+    Image diff;
+    auto result = CompareImages(actual, expected, tolerance, diffFile.empty() ? nullptr : &diff);
+    if (!result.sizeMatches) {
+        printf("size differs: %ux%u, expected %ux%u\n", actual.width, actual.height, expected.width, expected.height);
+        return 1;
+    }
+    printf("max channel difference %u, %u of %u pixels differ by more than %u\n",
+           result.maxDiff, result.differingPixels, result.totalPixels, tolerance);
+    if (!diffFile.empty() && !WritePNG(diffFile, diff)) {
+        fprintf(stderr, "write %s failed\n", diffFile.c_str());
+    }
+    return ImagesMatch(result, maxDiffering) ? 0 : 1;
+}
@@ -0,0 +1,579 @@
+#include "toy2d/toy2d.hpp"
+#include "image.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// render_tests image|perf SCENE --golden-dir DIR --baselines FILE [options]
+//
+// Renders one of the canonical scenes on a CPU Vulkan device (lavapipe) through a
+// headless surface. `image` compares the frame with the golden PNG, `perf` renders
+// it repeatedly and compares the frame time and draw calls with the baseline file.
+// --update rewrites the golden or the baseline from this run instead. Scenes without
+// a golden or a baseline yet are skipped, they only come from --update on a real device.
+
+using namespace toy2d;
+
+// CTest reports the test as skipped, see SKIP_RETURN_CODE in tests/CMakeLists.txt
+constexpr int SkipTest = 77;
+
+struct Options {
+    std::string mode;
+    std::string scene;
+    std::string goldenDir;
+    std::string baselines;
+    std::string outputDir = ".";
+    uint32_t tolerance = 3;
+    float maxDiffering = 0.01f;
+    float timeTolerance = 0.5f;
+    bool update = false;
+};
+
+// Textures of the scenes, generated so the tests don't depend on resource files.
+// Unorm textures hold premultiplied alpha as the blend state expects
+struct Resources {
+    Texture* tile;   // 8x8 opaque, sRGB
+    Texture* marker; // 16x16 opaque, sRGB
+    Texture* glow;   // 32x32 radial alpha, premultiplied
+    Texture* mask;   // 16x16 checker of opaque and clear 4x4 cells, premultiplied
+};
+
+struct Scene {
+    const char* name;
+    // swapchain sizes in order, each one is a frame and a golden image
+    std::vector<vk::Extent2D> sizes;
+    std::function<void(Renderer&, const Resources&, const vk::Extent2D&)> draw;
+};
+
+static Resources createResources() {
+    auto& textures = TextureManager::Instance();
+    Resources res;
+
+    std::vector<uint8_t> pixels(8 * 8 * 4);
+    for (uint32_t y = 0; y < 8; y++) {
+        for (uint32_t x = 0; x < 8; x++) {
+            uint8_t* p = &pixels[(y * 8 + x) * 4];
+            p[0] = 32 + x * 28;
+            p[1] = 32 + y * 28;
+            p[2] = (x + y) % 2 ? 224 : 96;
+            p[3] = 255;
+        }
+    }
+    res.tile = textures.Create(pixels.data(), 8, 8);
+
+    pixels.assign(16 * 16 * 4, 0);
+    for (uint32_t y = 0; y < 16; y++) {
+        for (uint32_t x = 0; x < 16; x++) {
+            uint8_t* p = &pixels[(y * 16 + x) * 4];
+            p[0] = x * 16 + 8;
+            p[1] = 128;
+            p[2] = y * 16 + 8;
+            p[3] = 255;
+        }
+    }
+    res.marker = textures.Create(pixels.data(), 16, 16);
+
+    // integer math only, so the texture is the same on every platform
+    pixels.assign(32 * 32 * 4, 0);
+    for (int y = 0; y < 32; y++) {
+        for (int x = 0; x < 32; x++) {
+            // squared distance to the center in half texels, 1024 is the radius
+            int dx = 2 * x + 1 - 32, dy = 2 * y + 1 - 32;
+            int alpha = 255 * std::max(0, 1024 - (dx * dx + dy * dy)) / 1024;
+            uint8_t* p = &pixels[(y * 32 + x) * 4];
+            p[0] = 255 * alpha / 255;
+            p[1] = 153 * alpha / 255;
+            p[2] = 51 * alpha / 255;
+            p[3] = alpha;
+        }
+    }
+    res.glow = textures.Create(pixels.data(), 32, 32, vk::Format::eR8G8B8A8Unorm);
+
+    pixels.assign(16 * 16 * 4, 0);
+    for (uint32_t y = 0; y < 16; y++) {
+        for (uint32_t x = 0; x < 16; x++) {
+            if ((x / 4 + y / 4) % 2 == 0) {
+                uint8_t* p = &pixels[(y * 16 + x) * 4];
+                p[0] = 40;
+                p[1] = 200;
+                p[2] = 255;
+                p[3] = 255;
+            }
+        }
+    }
+    res.mask = textures.Create(pixels.data(), 16, 16, vk::Format::eR8G8B8A8Unorm);
+    return res;
+}
+
+static void destroyResources(const Resources& res) {
+    DestroyTexture(res.tile);
+    DestroyTexture(res.marker);
+    DestroyTexture(res.glow);
+    DestroyTexture(res.mask);
+}
+
+static Rect whole(const Texture& texture) {
+    float w = static_cast<float>(texture.width), h = static_cast<float>(texture.height);
+    return Rect{Vec{w * 0.5f, h * 0.5f}, Size{w, h}};
+}
+
+// 1024 batched sprites with tints and flips covering the image, then a few unbatched ones
+static void drawSprites(Renderer& renderer, const Resources& res, const vk::Extent2D&) {
+    const Color tints[] = {{1, 1, 1}, {1, 0.5, 0.5}, {0.5, 1, 0.5}, {0.5, 0.5, 1}};
+    for (uint32_t y = 0; y < 32; y++) {
+        for (uint32_t x = 0; x < 32; x++) {
+            renderer.SetDrawColor(tints[(x + y) % 4]);
+            renderer.DrawTextureEx(*res.tile, whole(*res.tile),
+                                   Rect{Vec{x * 8 + 4.0f, y * 8 + 4.0f}, Size{8, 8}},
+                                   0, Vec{0, 0}, x % 2 ? Flip::Horizontal : Flip::None);
+        }
+    }
+    renderer.SetDrawColor(Color{1, 1, 1});
+    for (uint32_t i = 0; i < 4; i++) {
+        renderer.DrawTexture(Rect{Vec{32 + 64.0f * i, 128}, Size{16, 16}}, *res.marker);
+    }
+}
+
+// aliased lines, thick lines with every cap, a polyline and a rect outline
+static void drawLines(Renderer& renderer, const Resources&, const vk::Extent2D&) {
+    renderer.SetLineWidth(0);
+    renderer.SetDrawColor(Color{1, 1, 1});
+    renderer.DrawLine(Vec{16, 16.5}, Vec{240, 16.5});
+    renderer.SetDrawColor(Color{1, 0.5, 0});
+    renderer.DrawLine(Vec{16, 24.5}, Vec{240, 24.5});
+    renderer.SetDrawColor(Color{0, 1, 1});
+    renderer.DrawLine(Vec{8.5, 32}, Vec{8.5, 240});
+    renderer.DrawLine(Vec{247.5, 32}, Vec{247.5, 240});
+
+    renderer.SetLineWidth(6);
+    renderer.SetLineCap(LineCap::Butt);
+    renderer.SetDrawColor(Color{1, 0, 0});
+    renderer.DrawLine(Vec{40, 60}, Vec{216, 60});
+    renderer.SetLineCap(LineCap::Square);
+    renderer.SetDrawColor(Color{0, 1, 0});
+    renderer.DrawLine(Vec{40, 90}, Vec{216, 110});
+    renderer.SetLineCap(LineCap::Round);
+    renderer.SetDrawColor(Color{0.2, 0.4, 1});
+    renderer.DrawLine(Vec{40, 140}, Vec{60, 220});
+    renderer.SetLineWidth(2.5);
+    renderer.SetDrawColor(Color{1, 1, 1});
+    renderer.DrawLine(Vec{70, 130}, Vec{90, 225});
+    // thinner than a pixel, drawn a pixel wide with half the coverage
+    renderer.SetLineWidth(0.5);
+    renderer.DrawLine(Vec{40, 232}, Vec{216, 236});
+    renderer.SetLineWidth(8);
+    renderer.SetDrawColor(Color{1, 1, 0});
+    renderer.DrawPolyline({{100, 150}, {140, 215}, {180, 150}, {220, 215}});
+
+    renderer.SetLineWidth(0);
+    renderer.SetLineCap(LineCap::Butt);
+    renderer.SetDrawColor(Color{0.6, 0.6, 0.6});
+    renderer.DrawRect(Rect{Vec{128, 128}, Size{252, 252}}, 2);
+}
+
+// premultiplied textures over stripes, overlapping, tinted and magnified
+static void drawAlpha(Renderer& renderer, const Resources& res, const vk::Extent2D&) {
+    const Color stripes[] = {{1, 1, 1}, {0, 0, 0}, {0.8, 0.1, 0.1}, {0.1, 0.3, 0.9}};
+    for (uint32_t i = 0; i < 4; i++) {
+        renderer.SetDrawColor(stripes[i]);
+        renderer.FillRect(Rect{Vec{32 + 64.0f * i, 128}, Size{64, 256}});
+    }
+
+    renderer.SetDrawColor(Color{1, 1, 1});
+    for (uint32_t i = 0; i < 4; i++) {
+        renderer.DrawTextureEx(*res.glow, whole(*res.glow), Rect{Vec{32 + 64.0f * i, 64}, Size{32, 32}});
+    }
+    renderer.SetDrawColor(Color{0.5, 1, 1});
+    for (uint32_t i = 0; i < 4; i++) {
+        renderer.DrawTextureEx(*res.glow, whole(*res.glow), Rect{Vec{64 + 24.0f * i, 144}, Size{32, 32}});
+    }
+
+    renderer.SetDrawColor(Color{1, 1, 1});
+    renderer.DrawTextureEx(*res.mask, whole(*res.mask), Rect{Vec{64, 216}, Size{32, 32}});
+    renderer.DrawTextureEx(*res.mask, whole(*res.mask), Rect{Vec{128, 216}, Size{16, 16}});
+    renderer.DrawTextureEx(*res.mask, whole(*res.mask), Rect{Vec{192, 216}, Size{32, 32}}, 0, Vec{0, 0}, Flip::Vertical);
+}
+
+// shapes anchored to the corners and the center of whatever the swapchain size is
+static void drawResize(Renderer& renderer, const Resources&, const vk::Extent2D& extent) {
+    float w = static_cast<float>(extent.width), h = static_cast<float>(extent.height);
+    renderer.SetProject(extent.width, 0, 0, extent.height, -1, 1);
+    renderer.SetDrawColor(Color{0.05, 0.05, 0.2});
+    renderer.FillRect(Rect{Vec{w * 0.5f, h * 0.5f}, Size{w, h}});
+    renderer.SetDrawColor(Color{1, 0, 0});
+    renderer.FillRect(Rect{Vec{8, 8}, Size{16, 16}});
+    renderer.SetDrawColor(Color{0, 1, 0});
+    renderer.FillRect(Rect{Vec{w - 8, 8}, Size{16, 16}});
+    renderer.SetDrawColor(Color{0, 0, 1});
+    renderer.FillRect(Rect{Vec{8, h - 8}, Size{16, 16}});
+    renderer.SetDrawColor(Color{1, 1, 1});
+    renderer.FillRect(Rect{Vec{w - 8, h - 8}, Size{16, 16}});
+    renderer.SetDrawColor(Color{1, 1, 0});
+    renderer.FillRect(Rect{Vec{w * 0.5f, h * 0.5f}, Size{32, 32}});
+}
+
+static const std::vector<Scene>& scenes() {
+    static const std::vector<Scene> scenes = {
+        {"sprites", {{256, 256}}, drawSprites},
+        {"lines", {{256, 256}}, drawLines},
+        {"alpha", {{256, 256}}, drawAlpha},
+        {"resize", {{256, 256}, {320, 180}, {128, 200}}, drawResize},
+    };
+    return scenes;
+}
+
+// name of a CPU device that can present to a headless surface, empty if there is none
+static std::string findSoftwareDevice() {
+    auto available = vk::enumerateInstanceExtensionProperties();
+    for (const char* required : {VK_KHR_SURFACE_EXTENSION_NAME, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME}) {
+        bool found = std::any_of(available.begin(), available.end(), [&](const vk::ExtensionProperties& ext) {
+            return strcmp(ext.extensionName.data(), required) == 0;
+        });
+        if (!found) {
+            return "";
+        }
+    }
+
+    vk::ApplicationInfo appInfo;
+    appInfo.setApiVersion(VK_API_VERSION_1_2);
+    vk::InstanceCreateInfo createInfo;
+    createInfo.setPApplicationInfo(&appInfo);
+    auto instance = vk::createInstance(createInfo);
+    std::string name;
+    for (auto& device : instance.enumeratePhysicalDevices()) {
+        auto properties = device.getProperties();
+        if (properties.deviceType == vk::PhysicalDeviceType::eCpu) {
+            name = properties.deviceName.data();
+            break;
+        }
+    }
+    instance.destroy();
+    return name;
+}
+
+static std::string sizeSuffix(const Scene& scene, const vk::Extent2D& size) {
+    if (scene.sizes.size() == 1) {
+        return "";
+    }
+    return "_" + std::to_string(size.width) + "x" + std::to_string(size.height);
+}
+
+// the swapchain is RGBA or BGRA, alpha isn't compared
+static Image toImage(const ReadbackResult& result) {
+    bool bgra = result.format == vk::Format::eB8G8R8A8Unorm || result.format == vk::Format::eB8G8R8A8Srgb;
+    Image image(result.width, result.height);
+    for (uint32_t y = 0; y < result.height; y++) {
+        const uint8_t* row = result.Data() + y * result.RowPitch();
+        for (uint32_t x = 0; x < result.width; x++) {
+            const uint8_t* p = row + x * 4;
+            uint8_t* out = image.Pixel(x, y);
+            out[0] = bgra ? p[2] : p[0];
+            out[1] = p[1];
+            out[2] = bgra ? p[0] : p[2];
+        }
+    }
+    return image;
+}
+
+// the frame with `size`, resizing the swapchain first if needed
+static bool renderFrame(Renderer& renderer, const Scene& scene, const Resources& res,
+                        vk::Extent2D& current, const vk::Extent2D& size, ReadbackCallback readback = nullptr) {
+    if (current != size) {
+        ResizeSwapchainImage(size.width, size.height);
+        current = size;
+    }
+    if (!renderer.StartRender()) {
+        return false;
+    }
+    scene.draw(renderer, res, size);
+    if (readback) {
+        renderer.RequestReadback(std::move(readback));
+    }
+    renderer.EndRender();
+    return true;
+}
+
+static std::string goldenFile(const Scene& scene, const vk::Extent2D& size, const Options& options) {
+    return options.goldenDir + "/" + scene.name + sizeSuffix(scene, size) + ".png";
+}
+
+static int runImage(Renderer& renderer, const Scene& scene, const Resources& res, const Options& options) {
+    int failures = 0;
+    vk::Extent2D current = scene.sizes.front();
+    for (auto& size : scene.sizes) {
+        std::string name = scene.name + sizeSuffix(scene, size);
+        std::optional<Image> actual;
+        if (!renderFrame(renderer, scene, res, current, size, [&](const ReadbackResult& result) {
+                actual = toImage(result);
+            })) {
+            fprintf(stderr, "%s: nothing to render to\n", name.c_str());
+            return 1;
+        }
+        // the callback runs from a later StartRender once the frame finished
+        for (int i = 0; i < 8 && !actual; i++) {
+            renderFrame(renderer, scene, res, current, size);
+        }
+        if (!actual) {
+            fprintf(stderr, "%s: readback didn't finish\n", name.c_str());
+            return 1;
+        }
+
+        std::string golden = goldenFile(scene, size, options);
+        if (options.update) {
+            std::error_code error;
+            std::filesystem::create_directories(options.goldenDir, error);
+            if (!WritePNG(golden, *actual)) {
+                fprintf(stderr, "write %s failed\n", golden.c_str());
+                return 1;
+            }
+            printf("%s: wrote %s\n", name.c_str(), golden.c_str());
+            continue;
+        }
+
+        Image expected;
+        if (!LoadPNG(golden, expected)) {
+            fprintf(stderr, "%s: read %s failed\n", name.c_str(), golden.c_str());
+            return 1;
+        }
+        Image diff;
+        auto result = CompareImages(*actual, expected, options.tolerance, &diff);
+        if (!result.sizeMatches) {
+            printf("%s: size %ux%u, expected %ux%u\n", name.c_str(),
+                   actual->width, actual->height, expected.width, expected.height);
+        } else {
+            printf("%s: max channel difference %u, %u of %u pixels differ by more than %u\n", name.c_str(),
+                   result.maxDiff, result.differingPixels, result.totalPixels, options.tolerance);
+        }
+        if (!ImagesMatch(result, options.maxDiffering)) {
+            // next to the golden's name, so they can be looked at side by side
+            std::string output = options.outputDir + "/" + name;
+            WritePNG(output + ".png", *actual);
+            if (result.sizeMatches) {
+                WritePNG(output + "_diff.png", diff);
+            }
+            printf("%s: doesn't match the golden, see %s.png\n", name.c_str(), output.c_str());
+            failures++;
+        }
+    }
+    return failures ? 1 : 0;
+}
+
+struct Baseline {
+    uint32_t drawCalls = 0;
+    float frameMs = 0;
+};
+
+// "scene draw_calls frame_ms" per line, '#' starts a comment
+static std::map<std::string, Baseline> readBaselines(const std::string& filename, std::vector<std::string>& lines) {
+    std::map<std::string, Baseline> baselines;
+    std::ifstream file(filename);
+    std::string line;
+    // lines keep their '\r', so an update doesn't change the line endings
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+        std::istringstream stream(line);
+        std::string scene;
+        Baseline baseline;
+        if (stream >> scene && scene[0] != '#' && stream >> baseline.drawCalls >> baseline.frameMs) {
+            baselines[scene] = baseline;
+        }
+    }
+    return baselines;
+}
+
+static bool writeBaseline(const std::string& filename, std::vector<std::string> lines,
+                          const std::string& scene, const Baseline& baseline) {
+    char entry[128];
+    snprintf(entry, sizeof(entry), "%s %u %.3f", scene.c_str(), baseline.drawCalls, baseline.frameMs);
+    auto it = std::find_if(lines.begin(), lines.end(), [&](const std::string& line) {
+        std::istringstream stream(line);
+        std::string name;
+        return stream >> name && name == scene;
+    });
+    if (it != lines.end()) {
+        *it = entry + std::string(!it->empty() && it->back() == '\r' ? "\r" : "");
+    } else {
+        if (lines.empty()) {
+            lines.push_back("# scene draw_calls frame_ms");
+            lines.push_back("# written by the update_render_baselines target on the reference machine");
+        }
+        lines.push_back(entry);
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+    for (auto& line : lines) {
+        file << line << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+static int runPerf(Renderer& renderer, const Scene& scene, const Resources& res, const Options& options) {
+    constexpr int WarmupFrames = 10;
+    constexpr int MeasuredFrames = 100;
+    // a resize sequence switches the size every few frames
+    constexpr int FramesPerSize = 10;
+
+    vk::Extent2D current = scene.sizes.front();
+    auto sizeOf = [&](int frame) { return scene.sizes[(frame / FramesPerSize) % scene.sizes.size()]; };
+    for (int i = 0; i < WarmupFrames; i++) {
+        renderFrame(renderer, scene, res, current, sizeOf(i));
+    }
+
+    double cpuMs = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < MeasuredFrames; i++) {
+        if (!renderFrame(renderer, scene, res, current, sizeOf(WarmupFrames + i))) {
+            fprintf(stderr, "%s: nothing to render to\n", scene.name);
+            return 1;
+        }
+        cpuMs += renderer.GetFrameStats().cpuMs;
+    }
+    // the frames in flight are part of the measured work
+    Context::Instance().device.waitIdle();
+    Baseline measured;
+    measured.frameMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() / MeasuredFrames;
+    measured.drawCalls = renderer.GetFrameStats().drawCalls;
+    printf("%s: %.3f ms per frame, %.3f cpu ms, %u draw calls\n",
+           scene.name, measured.frameMs, cpuMs / MeasuredFrames, measured.drawCalls);
+
+    std::vector<std::string> lines;
+    auto baselines = readBaselines(options.baselines, lines);
+    if (options.update) {
+        if (!writeBaseline(options.baselines, lines, scene.name, measured)) {
+            fprintf(stderr, "write %s failed\n", options.baselines.c_str());
+            return 1;
+        }
+        printf("%s: wrote the baseline to %s\n", scene.name, options.baselines.c_str());
+        return 0;
+    }
+
+    auto it = baselines.find(scene.name);
+    if (it == baselines.end()) {
+        fprintf(stderr, "%s: no baseline in %s\n", scene.name, options.baselines.c_str());
+        return 1;
+    }
+    auto& baseline = it->second;
+    int failures = 0;
+    // fewer draws fail as well, so the baseline keeps guarding the improvement
+    if (measured.drawCalls != baseline.drawCalls) {
+        printf("%s: %u draw calls, the baseline is %u\n", scene.name, measured.drawCalls, baseline.drawCalls);
+        failures++;
+    }
+    float limit = baseline.frameMs * (1 + options.timeTolerance);
+    if (measured.frameMs > limit) {
+        printf("%s: %.3f ms per frame exceeds the baseline %.3f ms by more than %.0f%%\n",
+               scene.name, measured.frameMs, baseline.frameMs, options.timeTolerance * 100);
+        failures++;
+    }
+    return failures ? 1 : 0;
+}
+
+static bool hasReference(const Scene& scene, const Options& options) {
+    if (options.mode == "perf") {
+        std::vector<std::string> lines;
+        return readBaselines(options.baselines, lines).count(scene.name) > 0;
+    }
+    return std::all_of(scene.sizes.begin(), scene.sizes.end(), [&](const vk::Extent2D& size) {
+        return std::filesystem::exists(goldenFile(scene, size, options));
+    });
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+    if (argc < 3) {
+        return false;
+    }
+    options.mode = argv[1];
+    options.scene = argv[2];
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--update") == 0) {
+            options.update = true;
+        } else if (i + 1 == argc) {
+            return false;
+        } else if (strcmp(argv[i], "--golden-dir") == 0) {
+            options.goldenDir = argv[++i];
+        } else if (strcmp(argv[i], "--baselines") == 0) {
+            options.baselines = argv[++i];
+        } else if (strcmp(argv[i], "--output-dir") == 0) {
+            options.outputDir = argv[++i];
+        } else if (strcmp(argv[i], "--tolerance") == 0) {
+            options.tolerance = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (strcmp(argv[i], "--max-differing") == 0) {
+            options.maxDiffering = std::stof(argv[++i]);
+        } else if (strcmp(argv[i], "--time-tolerance") == 0) {
+            options.timeTolerance = std::stof(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return (options.mode == "image" && !options.goldenDir.empty()) ||
+           (options.mode == "perf" && !options.baselines.empty());
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "usage: %s image|perf SCENE --golden-dir DIR --baselines FILE [--output-dir DIR] "
+                        "[--tolerance N] [--max-differing RATIO] [--time-tolerance RATIO] [--update]\n", argv[0]);
+        return 2;
+    }
+    auto scene = std::find_if(scenes().begin(), scenes().end(), [&](const Scene& candidate) {
+        return options.scene == candidate.name;
+    });
+    if (scene == scenes().end()) {
+        fprintf(stderr, "unknown scene %s\n", options.scene.c_str());
+        return 2;
+    }
+
+    if (!options.update && !hasReference(*scene, options)) {
+        printf("%s has no %s yet, create it with the update_render_baselines target on lavapipe, skipped\n",
+               scene->name, options.mode == "image" ? "golden" : "baseline");
+        return SkipTest;
+    }
+
+    // goldens are only comparable between runs on the same rasterizer
+    std::string device = findSoftwareDevice();
+    if (device.empty()) {
+        printf("no CPU Vulkan device with VK_EXT_headless_surface, e.g. lavapipe, skipped\n");
+        return SkipTest;
+    }
+
+    std::vector<const char*> extensions = {VK_KHR_SURFACE_EXTENSION_NAME, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME};
+    Config config;
+    config.preferredDevice = device;
+    auto& size = scene->sizes.front();
+    Init(extensions,
+        [](VkInstance instance) {
+            auto create = reinterpret_cast<PFN_vkCreateHeadlessSurfaceEXT>(
+                vkGetInstanceProcAddr(instance, "vkCreateHeadlessSurfaceEXT"));
+            VkHeadlessSurfaceCreateInfoEXT createInfo{VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT};
+            VkSurfaceKHR surface = VK_NULL_HANDLE;
+            if (create) {
+                create(instance, &createInfo, nullptr, &surface);
+            }
+            return surface;
+        }, size.width, size.height, config);
+
+    int result;
+    if (Context::Instance().phyDevice.getProperties().deviceType != vk::PhysicalDeviceType::eCpu) {
+        // e.g. TOY2D_DEVICE picked another one
+        printf("%s isn't used, skipped\n", device.c_str());
+        result = SkipTest;
+    } else {
+        auto res = createResources();
+        auto& renderer = *GetRenderer();
+        result = options.mode == "image" ? runImage(renderer, *scene, res, options)
+                                         : runPerf(renderer, *scene, res, options);
+        destroyResources(res);
+    }
+    Quit();
+    return result;
+}
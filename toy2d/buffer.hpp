@@ -11,7 +11,9 @@ struct Buffer {
     size_t size;
     size_t requireSize;
 
-    Buffer(vk::BufferUsageFlags usage, size_t size, vk::MemoryPropertyFlags memProperty);
+    // shared concurrently if `queueFamilies` names more than one family, otherwise exclusive
+    Buffer(vk::BufferUsageFlags usage, size_t size, vk::MemoryPropertyFlags memProperty,
+           const std::vector<uint32_t>& queueFamilies = {});
     ~Buffer();
 
     Buffer(const Buffer&) = delete;
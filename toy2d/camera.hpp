@@ -0,0 +1,42 @@
+#pragma once
+
+#include "toy2d/math.hpp"
+
+namespace toy2d {
+
+// 2D view for Renderer::SetCamera. The world point at `GetPosition()` is shown at
+// the center of the projected area, magnified by the zoom and turned by the rotation.
+// Changing it only touches CPU state, the renderer writes the resulting view
+// matrix into the frame's uniform buffer when a render scope opens.
+class Camera final {
+public:
+    void SetPosition(const Vec& position) { position_ = position; }
+    const Vec& GetPosition() const { return position_; }
+    // pan by `delta` world units
+    void Move(const Vec& delta);
+
+    // > 1 magnifies, must be positive
+    void SetZoom(float zoom);
+    float GetZoom() const { return zoom_; }
+    // multiply the zoom, e.g. by 1.1 per mouse wheel step
+    void Zoom(float factor);
+
+    // radians, the world appears turned the other way
+    void SetRotation(float radians) { rotation_ = radians; }
+    float GetRotation() const { return rotation_; }
+    void Rotate(float radians) { rotation_ += radians; }
+
+    // Move towards `target`, covering half the remaining distance every `halfLife`
+    // seconds, so it's smooth and independent of the frame rate. 0 snaps to the target
+    void Follow(const Vec& target, float dt, float halfLife = 0);
+
+    // world to the space of the projection, `center` is the center of the projected area
+    Transform2D GetViewTransform(const Vec& center) const;
+
+private:
+    Vec position_ = Vec{0, 0};
+    float zoom_ = 1;
+    float rotation_ = 0;
+};
+
+}
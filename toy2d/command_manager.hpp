@@ -1,27 +1,34 @@
 #pragma once
 
 #include "vulkan/vulkan.hpp"
+#include "toy2d/timeline.hpp"
 #include <functional>
 
 namespace toy2d {
 
 class CommandManager final {
 public:
+    // commands for the graphics queue family
     CommandManager();
+    explicit CommandManager(uint32_t queueFamily);
     ~CommandManager();
 
     vk::CommandBuffer CreateOneCommandBuffer();
     std::vector<vk::CommandBuffer> CreateCommandBuffers(std::uint32_t count);
+    std::vector<vk::CommandBuffer> CreateSecondaryCommandBuffers(std::uint32_t count);
     void ResetCmds();
     void FreeCmd(const vk::CommandBuffer&);
 
     using RecordCmdFunc = std::function<void(vk::CommandBuffer&)>;
-    void ExecuteCmd(vk::Queue, RecordCmdFunc);
+    // record and submit a one-time command buffer and wait only for it
+    void ExecuteCmd(Timeline&, RecordCmdFunc);
+    // same without waiting, returns the timeline value that marks its completion
+    uint64_t SubmitCmd(Timeline&, RecordCmdFunc, const std::vector<Timeline::Wait>& waits = {});
 
 private:
     vk::CommandPool pool_;
 
-    vk::CommandPool createCommandPool();
+    vk::CommandPool createCommandPool(uint32_t queueFamily);
 };
 
 }
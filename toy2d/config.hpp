@@ -0,0 +1,40 @@
+#pragma once
+
+#include "vulkan/vulkan.hpp"
+#include <vector>
+#include <string>
+#include <functional>
+
+// build-time default of Config::debugLevel, set by the TOY2D_DEBUG_LEVEL cmake option
+#ifndef TOY2D_DEBUG_LEVEL
+#define TOY2D_DEBUG_LEVEL Release
+#endif
+
+namespace toy2d {
+
+enum class DebugLevel {
+    Release,    // no layers, no debug utils
+    Validation, // validation layer, its messages go to Config::logger
+    Profile,    // no validation, object names and command buffer labels for captures
+};
+
+struct Config final {
+    // present modes in order of preference, the first one the surface supports is used.
+    // FIFO is always supported and is the final fallback
+    std::vector<vk::PresentModeKHR> presentModes = {vk::PresentModeKHR::eFifo};
+    // swapchain image count, 0 means minImageCount + 1. Clamped to what the surface supports
+    uint32_t swapchainImageCount = 0;
+    // how many frames the CPU may queue ahead of the GPU (frames in flight)
+    uint32_t maxQueuedFrames = 2;
+    // physical device to use: an index in enumeration order, a device UUID or part of the device name.
+    // The TOY2D_DEVICE environment variable overrides it. Empty picks the highest scoring device
+    std::string preferredDevice;
+    // the TOY2D_DEBUG environment variable (release, validation or profile) overrides it
+    DebugLevel debugLevel = DebugLevel::TOY2D_DEBUG_LEVEL;
+    // receives validation messages, debug setup and configuration warnings and the device
+    // selection log at every debug level. If it's empty they go to std::cerr, except at
+    // DebugLevel::Release where only the configuration warnings are printed
+    std::function<void(const std::string&)> logger;
+};
+
+}
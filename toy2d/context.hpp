@@ -13,22 +13,42 @@
 #include "tool.hpp"
 #include "command_manager.hpp"
 #include "shader.hpp"
+#include "config.hpp"
+#include "timeline.hpp"
+#include "uploader.hpp"
 
 namespace toy2d {
 
 class Context {
 public:
     using GetSurfaceCallback = std::function<VkSurfaceKHR(VkInstance)>;
-    friend void Init(std::vector<const char*>&, GetSurfaceCallback, int, int);
+    friend void Init(std::vector<const char*>&, GetSurfaceCallback, int, int, const Config&);
     friend void ResizeSwapchainImage(int w, int h);
 
-    static void Init(std::vector<const char*>& extensions, GetSurfaceCallback);
+    static void Init(std::vector<const char*>& extensions, GetSurfaceCallback, const Config&);
     static void Quit();
     static Context& Instance();
 
+    // create a new swapchain from the current one without waiting for the GPU,
+    // the returned old swapchain must be kept until the frames using it are finished
+    std::unique_ptr<Swapchain> RecreateSwapchain(int windowWidth, int windowHeight);
+
+    // destroy something the frame being recorded may use, once the GPU finished that frame
+    void DeferDestroy(std::function<void()> func);
+    // hand the destructions queued by DeferDestroy to the graphics timeline, to run once it reached `value`
+    void ScheduleDeferred(uint64_t value);
+    // run the deferred work of every timeline that is finished
+    void CollectTimelines();
+
     struct QueueInfo {
         std::optional<std::uint32_t> graphicsIndex;
         std::optional<std::uint32_t> presentIndex;
+        // dedicated families when the device has them, otherwise the graphics family.
+        // The queue index is > 0 when they use an extra queue of that family
+        std::optional<std::uint32_t> transferIndex;
+        std::optional<std::uint32_t> computeIndex;
+        std::uint32_t transferQueueIndex = 0;
+        std::uint32_t computeQueueIndex = 0;
     } queueInfo;
 
     vk::Instance instance;
@@ -36,31 +56,65 @@ public:
     vk::Device device;
     vk::Queue graphicsQueue;
     vk::Queue presentQueue;
+    vk::Queue transferQueue;
+    vk::Queue computeQueue;
     std::unique_ptr<Swapchain> swapchain;
     std::unique_ptr<RenderProcess> renderProcess;
     std::unique_ptr<CommandManager> commandManager;
+    std::unique_ptr<CommandManager> transferCommandManager;
+    std::unique_ptr<CommandManager> computeCommandManager;
+    std::unique_ptr<Timeline> graphicsTimeline;
+    std::unique_ptr<Timeline> transferTimeline;
+    std::unique_ptr<Timeline> computeTimeline;
+    std::unique_ptr<Uploader> uploader;
     std::unique_ptr<Shader> shader;
+    std::unique_ptr<Shader> lineShader;
+    std::unique_ptr<Shader> textShader;
+    std::unique_ptr<Shader> particleShader;
     vk::Sampler sampler;
+    Config config;
+    // effective debug level after the environment override
+    DebugLevel debugLevel = DebugLevel::Release;
+    // VK_EXT_debug_utils is enabled, its functions are loaded into `dispatch`
+    bool debugUtils = false;
+    // VK_KHR_incremental_present is enabled, presents can name the regions that changed
+    bool incrementalPresent = false;
+    vk::DispatchLoaderDynamic dispatch;
 
 private:
     static Context* instance_;
     vk::SurfaceKHR surface_ = nullptr;
 
     GetSurfaceCallback getSurfaceCb_ = nullptr;
+    vk::DebugUtilsMessengerEXT debugMessenger_ = nullptr;
+    std::vector<std::function<void()>> frameGarbage_;
 
-    Context(std::vector<const char*>& extensions, GetSurfaceCallback);
+    Context(std::vector<const char*>& extensions, GetSurfaceCallback, const Config&);
     ~Context();
 
     void initRenderProcess();
     void initSwapchain(int windowWidth, int windowHeight);
     void initGraphicsPipeline();
     void initCommandPool();
+    void initTimelines();
+    void initUploader();
     void initShaderModules();
     void initSampler();
     void getSurface();
 
     vk::Instance createInstance(std::vector<const char*>& extensions);
+    void resolveDebugLevel();
+    // diagnostics to Config::logger, or std::cerr if it isn't set and the level isn't Release
+    void log(const std::string& message) const;
+    // like log() but never dropped, for mistakes in the configuration
+    void warn(const std::string& message) const;
+    static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT,
+                                                       VkDebugUtilsMessageTypeFlagsEXT,
+                                                       const VkDebugUtilsMessengerCallbackDataEXT*,
+                                                       void* userData);
     vk::PhysicalDevice pickupPhysicalDevice();
+    // -1 if the device can't run the renderer
+    int scoreDevice(vk::PhysicalDevice);
     vk::Device createDevice(vk::SurfaceKHR);
 
     void queryQueueInfo(vk::SurfaceKHR);
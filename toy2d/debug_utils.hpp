@@ -0,0 +1,21 @@
+#pragma once
+
+#include "vulkan/vulkan.hpp"
+#include <string>
+#include <array>
+
+namespace toy2d {
+
+// VK_EXT_debug_utils object names and command buffer labels, shown by validation
+// messages and capture tools. They do nothing when the debug level is Release.
+void SetDebugName(vk::ObjectType type, uint64_t handle, const std::string& name);
+
+template <typename T>
+void SetDebugName(T handle, const std::string& name) {
+    SetDebugName(T::objectType, (uint64_t)static_cast<typename T::CType>(handle), name);
+}
+
+void BeginDebugLabel(vk::CommandBuffer, const std::string& name, const std::array<float, 4>& color = {1, 1, 1, 1});
+void EndDebugLabel(vk::CommandBuffer);
+
+}
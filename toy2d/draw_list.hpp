@@ -0,0 +1,55 @@
+#pragma once
+
+#include "vulkan/vulkan.hpp"
+#include "toy2d/math.hpp"
+#include <vector>
+
+namespace toy2d {
+
+struct DrawCmd final {
+    uint64_t key;
+    vk::Pipeline pipeline;
+    vk::DescriptorSet textureSet;
+    vk::Buffer vertexBuffer;
+    vk::Buffer indexBuffer; // null for non-indexed draws
+    uint32_t firstVertex;
+    uint32_t firstIndex;
+    uint32_t count;
+    uint32_t instanceCount = 1;
+    uint32_t firstInstance = 0;
+    vk::Buffer indirectBuffer; // if set, the draw parameters are read from it instead
+    Transform2D transform;
+    Color color;
+};
+
+// Draw commands captured during a frame and recorded in sort key order.
+// Sorting is stable, so draws with equal keys keep their submission order.
+class DrawList final {
+public:
+    // | layer: 8 | pipeline: 8 | texture: 24 | depth: 24 |
+    // Groups draws by state, overlapping draws of different pipelines or textures
+    // in one layer may change their order
+    static uint64_t MakeKey(uint8_t layer, uint8_t pipeline, uint32_t texture, float depth);
+    // | layer: 8 | depth: 24 | sequence: 32 |
+    // keeps the submission order for draws of the same depth, e.g. blended ones
+    static uint64_t MakeOrderedKey(uint8_t layer, float depth, uint32_t sequence);
+
+    void Push(const DrawCmd& cmd) { cmds_.push_back(cmd); }
+    void Sort();
+    void Clear();
+
+    bool Empty() const { return cmds_.empty(); }
+    size_t Size() const { return cmds_.size(); }
+
+    // i-th command in sorted order, only valid after Sort()
+    const DrawCmd& Get(size_t i) const { return cmds_[order_[i]]; }
+
+    uint32_t CountStateChanges(bool sorted) const;
+
+private:
+    std::vector<DrawCmd> cmds_;
+    std::vector<uint32_t> order_;
+    std::vector<uint32_t> swap_;
+};
+
+}
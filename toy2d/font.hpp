@@ -0,0 +1,110 @@
+#pragma once
+
+#include "toy2d/math.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace toy2d {
+
+class Texture;
+class TrueTypeFont;
+
+// Coverage of one glyph, as produced by a font rasterizer.
+struct GlyphBitmap {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> coverage; // width * height, 255 is inside
+    // from the pen position on the baseline to the top-left of the bitmap, y down
+    float offsetX = 0;
+    float offsetY = 0;
+    float advance = 0;
+};
+
+// Rasterize `codepoint` at `pixelSize` pixels per em. TrueTypeFont::Rasterize is the
+// default, a custom one (e.g. FreeType) can handle other formats or add hinting.
+// Returns false if the font lacks the glyph.
+// Blank glyphs such as space return true with an empty bitmap and their advance
+using GlyphRasterizer = std::function<bool(uint32_t codepoint, float pixelSize, GlyphBitmap& out)>;
+
+// Signed distance field glyphs packed into a growable atlas texture. Glyphs are
+// rasterized once at RasterSize on first use; the distance field lets them be
+// drawn at any size from that single copy.
+class Font final {
+public:
+    // vertical metrics in ems, i.e. for a font size of 1
+    struct Metrics {
+        float ascent = 0.8f;
+        float descent = 0.2f;
+        float lineGap = 0;
+    };
+
+    static constexpr float RasterSize = 32;
+    // distance range in pixels around the outline that the field covers
+    static constexpr uint32_t Spread = 4;
+
+    // rasterized by the built-in TrueTypeFont, metrics from the file
+    explicit Font(const std::string& ttfFilename);
+    explicit Font(GlyphRasterizer rasterizer);
+    Font(GlyphRasterizer rasterizer, const Metrics& metrics);
+    ~Font();
+
+    Font(const Font&) = delete;
+    Font& operator=(const Font&) = delete;
+
+    // width and height of utf8 text at `size` pixels per em, '\n' starts a new line
+    Size Measure(const std::string& utf8, float size);
+    float LineHeight(float size) const { return (metrics_.ascent + metrics_.descent + metrics_.lineGap) * size; }
+
+    // Append two triangles per glyph to `out`, `position` is the top-left of the text.
+    // Texcoords are in atlas pixels so they stay valid when the atlas grows
+    void Layout(const std::string& utf8, const Vec& position, float size, const Color& color, std::vector<Vertex>& out);
+
+    // The atlas texture. Glyphs added since the last call are copied into it,
+    // it is only re-created after the atlas grew
+    Texture* GetTexture();
+
+private:
+    struct Glyph {
+        // in the atlas, including the spread
+        uint32_t x = 0;
+        uint32_t y = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        float offsetX = 0;
+        float offsetY = 0;
+        float advance = 0;
+    };
+
+    struct Shelf {
+        uint32_t y;
+        uint32_t height;
+        uint32_t x;
+    };
+
+    GlyphRasterizer rasterizer_;
+    Metrics metrics_;
+    std::unordered_map<uint32_t, Glyph> glyphs_;
+
+    std::vector<uint8_t> atlas_; // R8 distances, 128 is the outline
+    uint32_t atlasWidth_ = 256;
+    uint32_t atlasHeight_ = 256;
+    std::vector<Shelf> shelves_;
+    // atlas pixels changed since the last upload, empty if x0 >= x1
+    uint32_t dirtyX0_ = 0;
+    uint32_t dirtyY0_ = 0;
+    uint32_t dirtyX1_ = 0;
+    uint32_t dirtyY1_ = 0;
+    bool resized_ = false;
+    Texture* texture_ = nullptr;
+
+    explicit Font(std::shared_ptr<const TrueTypeFont> font);
+
+    const Glyph* getGlyph(uint32_t codepoint);
+    bool pack(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y);
+    void grow();
+};
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+namespace toy2d {
+
+// Rolling window of the last `WindowSize` intervals in milliseconds, bucketed
+// into a histogram so hitches show up even when the average looks fine.
+class FrameHistogram final {
+public:
+    static constexpr size_t WindowSize = 240;
+    static constexpr size_t BucketCount = 20;
+    // bucket i holds [i * BucketWidthMs, (i + 1) * BucketWidthMs), the last one everything above
+    static constexpr float BucketWidthMs = 2.0f;
+
+    void Add(float ms);
+    void Clear();
+
+    size_t Count() const { return count_; }
+    float Last() const { return last_; }
+    float Average() const { return count_ == 0 ? 0 : static_cast<float>(sum_ / count_); }
+    float Max() const;
+    // p in [0, 1], e.g. 0.99 for the 99th percentile
+    float Percentile(float p) const;
+    const std::array<uint32_t, BucketCount>& Buckets() const { return buckets_; }
+
+private:
+    std::array<float, WindowSize> samples_ = {};
+    std::array<uint32_t, BucketCount> buckets_ = {};
+    size_t next_ = 0;
+    size_t count_ = 0;
+    double sum_ = 0;
+    float last_ = 0;
+
+    static size_t bucketOf(float ms);
+};
+
+}
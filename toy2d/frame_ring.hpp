@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+namespace toy2d {
+
+// Frame counter shared by everything that keeps per-frame resources.
+// The renderer begins a frame only after the GPU finished the frame that
+// used the same slot `FlightCount()` frames ago.
+class FrameClock final {
+public:
+    static void Init(uint32_t flightCount);
+
+    static uint32_t FlightCount() { return flightCount_; }
+    // slot of the current frame
+    static uint32_t Index() { return index_; }
+    // slot the next frame will use
+    static uint32_t NextIndex() { return static_cast<uint32_t>((number_ + 1) % flightCount_); }
+    // number of the current frame, starts from 1, 0 means no frame has begun
+    static uint64_t Number() { return number_; }
+    // true if every frame up to and including `number` has finished on the GPU
+    static bool IsFinished(uint64_t number) { return number + flightCount_ <= number_; }
+
+    static void BeginFrame();
+
+private:
+    static uint32_t flightCount_;
+    static uint32_t index_;
+    static uint64_t number_;
+};
+
+// One T per frame in flight. Current() returns the slot of the current frame;
+// the first time a slot is touched in a new frame `onReuse` runs on it, which is
+// safe because the GPU has finished the frame that used it before.
+template <typename T>
+class FrameRing final {
+public:
+    using CreateFunc = std::function<T(uint32_t index)>;
+    using ReuseFunc = std::function<void(T&)>;
+
+    FrameRing() = default;
+
+    explicit FrameRing(CreateFunc create, ReuseFunc onReuse = nullptr) {
+        Init(std::move(create), std::move(onReuse));
+    }
+
+    void Init(CreateFunc create, ReuseFunc onReuse = nullptr) {
+        uint32_t count = FrameClock::FlightCount();
+        slots_.clear();
+        slots_.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            slots_.push_back(create(i));
+        }
+        lastUsed_.assign(count, 0);
+        onReuse_ = std::move(onReuse);
+    }
+
+    void Clear() {
+        slots_.clear();
+        lastUsed_.clear();
+    }
+
+    T& Current() {
+        uint32_t index = FrameClock::Index();
+        uint64_t number = FrameClock::Number();
+        if (lastUsed_[index] != number) {
+            if (onReuse_ && lastUsed_[index] != 0) {
+                onReuse_(slots_[index]);
+            }
+            lastUsed_[index] = number;
+        }
+        return slots_[index];
+    }
+
+    // direct access, doesn't trigger the reuse callback
+    T& operator[](uint32_t index) { return slots_[index]; }
+    const T& operator[](uint32_t index) const { return slots_[index]; }
+
+    uint32_t Size() const { return static_cast<uint32_t>(slots_.size()); }
+    auto begin() { return slots_.begin(); }
+    auto end() { return slots_.end(); }
+
+private:
+    std::vector<T> slots_;
+    std::vector<uint64_t> lastUsed_;
+    ReuseFunc onReuse_;
+};
+
+}
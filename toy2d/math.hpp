@@ -15,16 +15,67 @@ struct Vec final {
     static std::vector<vk::VertexInputBindingDescription> GetBindingDescription();
 };
 
+struct Color final {
+    float r, g, b;
+};
+
 struct Vertex final {
     Vec position;
     Vec texcoord;
+    // multiplied with the draw color, lets batched shapes carry their own color
+    Color color = {1, 1, 1};
 };
 
-struct Color final {
-    float r, g, b;
+using Size = Vec;
+
+enum class LineCap {
+    Butt,   // ends at the end point
+    Square, // extends half the width past the end point
+    Round,
 };
 
-using Size = Vec;
+// corners between the segments of a thick polyline
+enum class LineJoin {
+    Miter, // sharp, a bevel where the tip is longer than 4 half widths
+    Bevel,
+    Round,
+};
+
+// mirroring of a sprite's texture, the quad itself keeps its place
+enum class Flip {
+    None,
+    Horizontal,
+    Vertical,
+    Both,
+};
+
+// per instance data of a thick line segment
+struct LineInstance final {
+    Vec p0;
+    Vec p1;
+    Color color;
+    float width; // in pixels
+    Vec caps;    // LineCap at p0 and p1, or JoinCap + LineJoin where the neighbour continues
+    Vec prev;    // the previous segment's p0 if p0 is a join
+    Vec next;    // the next segment's p1 if p1 is a join
+
+    static constexpr float JoinCap = 3;
+
+    static std::vector<vk::VertexInputAttributeDescription> GetAttributeDescription();
+    static std::vector<vk::VertexInputBindingDescription> GetBindingDescription();
+};
+
+// per instance data of a live particle, written by particle.comp
+struct ParticleInstance final {
+    Color color;
+    float alpha;
+    Vec position;
+    float size;
+    float padding;
+
+    static std::vector<vk::VertexInputAttributeDescription> GetAttributeDescription();
+    static std::vector<vk::VertexInputBindingDescription> GetBindingDescription();
+};
 
 class Mat4 {
 public:
@@ -50,6 +101,34 @@ private:
     float data_[4 * 4];
 };
 
+// 2D affine transform stored as a column major 3x2 matrix:
+// | a c tx |
+// | b d ty |
+class Transform2D final {
+public:
+    static Transform2D CreateIdentity();
+    static Transform2D CreateTranslate(const Vec&);
+    static Transform2D CreateScale(const Vec&);
+    static Transform2D CreateRotate(float radians);
+
+    Transform2D();
+    const float* GetData() const { return data_; }
+    void Set(int col, int row, float value) {
+        data_[col * 2 + row] = value;
+    }
+    float Get(int col, int row) const {
+        return data_[col * 2 + row];
+    }
+
+    // result = this * m, so m is applied first
+    Transform2D Mul(const Transform2D& m) const;
+    Transform2D Inverse() const;
+    Vec Apply(const Vec&) const;
+
+private:
+    float data_[3 * 2];
+};
+
 struct Rect {
     Vec position;
     Size size;
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "vulkan/vulkan.hpp"
+#include "toy2d/math.hpp"
+#include <memory>
+#include <vector>
+
+namespace toy2d {
+
+class Texture;
+class Renderer;
+struct Buffer;
+
+// where and how particles are spawned, and how they change over their life.
+// Changes apply to the particles alive at the next step as well
+struct ParticleEmitter {
+    Vec position = {0, 0};
+    Vec area = {0, 0};          // particles spawn in this box around `position`
+    float rate = 100;           // particles per second
+    float lifetime = 1;         // seconds
+    float lifetimeVariance = 0; // +/- seconds
+    Vec velocity = {0, -100};   // units per second
+    float spread = 0;           // radians around the velocity direction
+    float speedVariance = 0;    // +/- fraction of the speed
+    Vec gravity = {0, 0};
+    float drag = 0;             // fraction of the velocity lost per second
+    float startSize = 8;
+    float endSize = 0;
+    Color startColor = {1, 1, 1};
+    Color endColor = {1, 1, 1};
+    float startAlpha = 1;
+    float endAlpha = 0;
+};
+
+// Particles living in GPU buffers. particle.comp moves, spawns and kills them
+// on the compute queue and writes the live ones with the count of an indirect
+// draw, so the CPU only sets emitter parameters. The simulation runs when the
+// system is drawn with Renderer::DrawParticles, at most once per frame.
+class ParticleSystem final {
+public:
+    friend class Renderer;
+
+    // `texture` null uses the renderer's white texture
+    explicit ParticleSystem(uint32_t capacity, Texture* texture = nullptr);
+    ~ParticleSystem();
+
+    ParticleSystem(const ParticleSystem&) = delete;
+    ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+    // advance the time of the next step and emit for it at the emitter's rate
+    void Update(float dt);
+    // emit `count` particles at the next step, in addition to the rate
+    void Burst(uint32_t count);
+
+    uint32_t GetCapacity() const { return capacity_; }
+    Texture* GetTexture() const { return texture_; }
+
+    ParticleEmitter emitter;
+
+private:
+    // must match the push constants of particle.comp
+    struct Params {
+        float startColor[4];
+        float endColor[4];
+        Vec position;
+        Vec area;
+        Vec velocity;
+        Vec gravity;
+        float dt;
+        float lifetime;
+        float lifetimeVariance;
+        float spread;
+        float speedVariance;
+        float drag;
+        float startSize;
+        float endSize;
+        uint32_t emitCount;
+        uint32_t seed;
+        uint32_t capacity;
+    };
+
+    // written by one step and read by the frame drawing it
+    struct FrameOutput {
+        std::unique_ptr<Buffer> instances;
+        std::unique_ptr<Buffer> indirect;
+        vk::DescriptorSet set;
+    };
+
+    // longest step, so a system that wasn't drawn for a while doesn't jump
+    static constexpr float MaxStep = 0.1f;
+    static constexpr uint32_t WorkgroupSize = 64;
+
+    uint32_t capacity_;
+    Texture* texture_;
+    float pendingTime_ = 0;
+    float pendingEmit_ = 0;
+    uint32_t pendingBurst_ = 0;
+    uint32_t seed_ = 0;
+    bool cleared_ = false;
+    uint64_t lastFrame_ = 0;
+    uint64_t lastValue_ = 0; // compute timeline value of the last step
+
+    std::unique_ptr<Buffer> particles_;
+    std::vector<FrameOutput> outputs_;
+    vk::ShaderModule module_;
+    vk::DescriptorSetLayout setLayout_;
+    vk::PipelineLayout layout_;
+    vk::Pipeline pipeline_;
+    vk::DescriptorPool pool_;
+
+    void createPipeline();
+    void createBuffers();
+    void createDescriptorSets();
+    // run one step into the current frame's output, returns the compute timeline value to wait for
+    uint64_t simulate();
+    const FrameOutput& currentOutput() const;
+};
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "vulkan/vulkan.hpp"
+#include "toy2d/timeline.hpp"
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace toy2d {
+
+struct Buffer;
+
+// part of the target to read, a zero width or height means the whole target
+struct ReadbackRegion {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+// Pixels of a finished readback, only valid inside the callback.
+// 4 bytes per pixel in the order of `format` (RGBA or BGRA, as the swapchain)
+class ReadbackResult final {
+public:
+    friend class ReadbackRing;
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    vk::Format format = vk::Format::eUndefined;
+
+    const uint8_t* Data() const { return data_; }
+    size_t RowPitch() const { return static_cast<size_t>(width) * 4; }
+    // copy into user memory whose rows are `dstRowPitch` bytes apart
+    void CopyTo(void* dst, size_t dstRowPitch) const;
+
+private:
+    const uint8_t* data_ = nullptr;
+};
+
+using ReadbackCallback = std::function<void(const ReadbackResult&)>;
+
+// Host cached buffers that receive image copies. A buffer is reused once the
+// callback of its copy ran, which happens from Timeline::Collect() after the
+// submission that contained the copy finished, so nothing waits for the GPU.
+class ReadbackRing final {
+public:
+    ReadbackRing() = default;
+    ~ReadbackRing();
+
+    ReadbackRing(const ReadbackRing&) = delete;
+    ReadbackRing& operator=(const ReadbackRing&) = delete;
+
+    // `image` must be in TransferSrcOptimal and `region` inside it
+    void Record(vk::CommandBuffer, vk::Image, vk::Format, const ReadbackRegion&, ReadbackCallback);
+    // the copies recorded since the last call finish when `timeline` reaches `value`
+    void Submitted(Timeline& timeline, uint64_t value);
+
+private:
+    struct Slot {
+        std::unique_ptr<Buffer> buffer;
+        bool busy = false;
+    };
+
+    struct Recorded {
+        size_t slot;
+        ReadbackResult result;
+        ReadbackCallback callback;
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<Recorded> recorded_;
+    Timeline* timeline_ = nullptr;
+
+    size_t acquireSlot(vk::DeviceSize size);
+    void complete(const Recorded&);
+};
+
+}
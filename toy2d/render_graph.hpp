@@ -0,0 +1,127 @@
+#pragma once
+
+#include "vulkan/vulkan.hpp"
+#include "toy2d/texture.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace toy2d {
+
+class Renderer;
+
+// Frame graph made of render passes that each write one color target.
+// Passes run in declaration order, barriers and layout transitions between
+// them are generated from the declared reads/writes, passes that don't
+// contribute to an output are culled, and transient images whose lifetimes
+// don't overlap share device memory.
+class RenderGraph final {
+public:
+    friend class Renderer;
+
+    using ResourceID = uint32_t;
+    using ExecuteFunc = std::function<void(Renderer&)>;
+
+    struct ImageDesc {
+        // size relative to the swapchain extent
+        float scale = 1.0f;
+    };
+
+    struct Stats {
+        uint32_t passCount = 0;
+        uint32_t culledPassCount = 0;
+        uint32_t imageCount = 0;
+        uint32_t memoryBlockCount = 0;
+        vk::DeviceSize memorySize = 0;
+        vk::DeviceSize unaliasedMemorySize = 0;
+    };
+
+    RenderGraph();
+    ~RenderGraph();
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    // the swapchain image of the current frame, it can only be written
+    ResourceID GetBackbuffer() const { return BackbufferID; }
+    ResourceID CreateImage(const std::string& name, const ImageDesc& desc = {});
+    // keep passes writing `id` alive even if nothing reads it
+    void MarkOutput(ResourceID id);
+    void AddPass(const std::string& name, const std::vector<ResourceID>& reads, ResourceID write, ExecuteFunc func);
+
+    // must be called again after the swapchain was resized. Doesn't wait for the GPU,
+    // the old images are released once the frames using them finished
+    void Compile();
+    bool IsCompiled() const { return compiled_; }
+
+    // sample a transient image in a later pass, valid after Compile()
+    Texture& GetTexture(ResourceID id);
+    const Stats& GetStats() const { return stats_; }
+
+private:
+    static constexpr ResourceID BackbufferID = 0;
+
+    struct Resource {
+        std::string name;
+        ImageDesc desc;
+        bool output = false;
+
+        // compiled data
+        int firstUse = -1;
+        int lastUse = -1;
+        vk::Extent2D extent;
+        vk::Image image;
+        vk::ImageView view;
+        vk::Framebuffer framebuffer;
+        vk::MemoryRequirements requirements;
+        int memoryBlock = -1;
+        std::unique_ptr<Texture> texture;
+        // state after the last pass, where a readback picks it up
+        vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
+        vk::PipelineStageFlags finalStages;
+        vk::AccessFlags finalAccess;
+    };
+
+    struct Pass {
+        std::string name;
+        std::vector<ResourceID> reads;
+        ResourceID write;
+        ExecuteFunc func;
+
+        // compiled data
+        bool culled = false;
+        bool clearTarget = false;
+        std::vector<vk::ImageMemoryBarrier> barriers;
+        vk::PipelineStageFlags srcStages;
+        vk::PipelineStageFlags dstStages;
+    };
+
+    struct MemoryBlock {
+        vk::DeviceMemory memory;
+        vk::DeviceSize size;
+        uint32_t typeBits;
+        int lastUse;
+    };
+
+    std::vector<Resource> resources_;
+    std::vector<Pass> passes_;
+    std::vector<MemoryBlock> memoryBlocks_;
+    vk::RenderPass clearRenderPass_ = nullptr;
+    vk::RenderPass loadRenderPass_ = nullptr;
+    bool compiled_ = false;
+    vk::Extent2D compiledExtent_;
+    uint64_t executedFrame_ = 0;
+    Stats stats_;
+
+    void release();
+    void cullPasses();
+    void computeLifetimes();
+    void createImages();
+    void aliasMemory();
+    void createViewsAndFramebuffers();
+    void computeBarriers();
+    vk::RenderPass createRenderPass(vk::AttachmentLoadOp);
+};
+
+}
@@ -10,20 +10,30 @@ class RenderProcess {
 public:
     vk::Pipeline graphicsPipelineWithTriangleTopology = nullptr;
     vk::Pipeline graphicsPipelineWithLineTopology = nullptr;
+    // instanced segments expanded to quads by line.vert, see LineInstance
+    vk::Pipeline thickLinePipeline = nullptr;
+    // shader.vert with the distance field text.frag
+    vk::Pipeline textPipeline = nullptr;
+    // instanced quads of the live particles, see ParticleSystem
+    vk::Pipeline particlePipeline = nullptr;
     vk::RenderPass renderPass = nullptr;
     vk::PipelineLayout layout = nullptr;
 
     RenderProcess();
     ~RenderProcess();
 
-    void CreateGraphicsPipeline(const Shader& shader);
+    void CreateGraphicsPipeline(const Shader& shader, const Shader& lineShader, const Shader& textShader,
+                                const Shader& particleShader);
     void CreateRenderPass();
 
 private:
     vk::PipelineCache pipelineCache_ = nullptr;
 
     vk::PipelineLayout createLayout();
-    vk::Pipeline createGraphicsPipeline(const Shader& shader, vk::PrimitiveTopology);
+    vk::Pipeline createGraphicsPipeline(const Shader& shader, vk::PrimitiveTopology,
+                                        const std::vector<vk::VertexInputBindingDescription>&,
+                                        const std::vector<vk::VertexInputAttributeDescription>&,
+                                        vk::CullModeFlags);
     vk::RenderPass createRenderPass();
     vk::PipelineCache createPipelineCache();
 };
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "vulkan/vulkan.hpp"
+#include "toy2d/math.hpp"
+#include "toy2d/texture.hpp"
+#include <memory>
+
+namespace toy2d {
+
+class Renderer;
+
+// Offscreen color image that can be rendered into with Renderer::BeginTarget
+// and drawn like any Texture afterwards, e.g. to cache a layer that rarely
+// changes. Its content is kept between frames; redraw it when MarkDirty() was called.
+class RenderTarget final {
+public:
+    friend class Renderer;
+
+    RenderTarget(uint32_t width, uint32_t height);
+    ~RenderTarget();
+
+    RenderTarget(const RenderTarget&) = delete;
+    RenderTarget& operator=(const RenderTarget&) = delete;
+
+    // valid once something was rendered into the target
+    Texture& GetTexture() { return *texture_; }
+    uint32_t GetWidth() const { return width_; }
+    uint32_t GetHeight() const { return height_; }
+
+    // projection while rendering into the target, like Renderer::SetProject.
+    // Defaults to the target's pixels with y pointing down
+    void SetProject(int right, int left, int bottom, int top, int far, int near);
+    void SetClearColor(const Color& color, float alpha = 0);
+
+    // the target needs to be redrawn, cleared by Renderer::EndTarget
+    void MarkDirty() { dirty_ = true; }
+    bool IsDirty() const { return dirty_; }
+
+private:
+    uint32_t width_;
+    uint32_t height_;
+    vk::Image image_;
+    vk::DeviceMemory memory_;
+    vk::ImageView view_;
+    vk::RenderPass clearRenderPass_;
+    vk::RenderPass loadRenderPass_;
+    vk::Framebuffer framebuffer_;
+    std::unique_ptr<Texture> texture_;
+    Mat4 project_;
+    vk::ClearColorValue clearColor_;
+    bool rendered_ = false; // false while the image content is undefined
+    bool dirty_ = true;
+
+    void createImage();
+    void createViewAndFramebuffer();
+    vk::RenderPass createRenderPass(vk::AttachmentLoadOp);
+};
+
+}
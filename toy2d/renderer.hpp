@@ -7,59 +7,407 @@
 #include "toy2d/math.hpp"
 #include "toy2d/buffer.hpp"
 #include "toy2d/texture.hpp"
+#include "toy2d/draw_list.hpp"
+#include "toy2d/stream_buffer.hpp"
+#include "toy2d/thread_pool.hpp"
+#include "toy2d/render_graph.hpp"
+#include "toy2d/frame_ring.hpp"
+#include "toy2d/debug_utils.hpp"
+#include "toy2d/readback.hpp"
+#include "toy2d/frame_pacing.hpp"
+#include "toy2d/tessellate.hpp"
+#include "toy2d/font.hpp"
+#include "toy2d/tilemap.hpp"
+#include "toy2d/static_batch.hpp"
+#include "toy2d/particles.hpp"
+#include "toy2d/render_target.hpp"
+#include "toy2d/camera.hpp"
+#include "toy2d/sprite_scene.hpp"
 #include <limits>
+#include <bitset>
+#include <chrono>
+#include <optional>
+#include <future>
 
 namespace toy2d {
 
 class Renderer {
 public:
-    Renderer(int maxFlightCount);
+    enum class RecordMode {
+        Immediate,  // record commands when draw functions are called
+        Deferred,   // capture draws, sort them by state and record them in EndRender
+    };
+
+    struct DrawListStats {
+        uint32_t drawCount = 0;
+        uint32_t stateChanges = 0;
+        uint32_t stateChangesSaved = 0;
+    };
+
+    // Input latency: time from MarkInput() until the GPU finished the first frame
+    // submitted after it, i.e. the frame is queued for presentation. Completion is
+    // observed by polling the graphics timeline, so the resolution is about one frame.
+    struct LatencyStats {
+        float lastMs = 0;
+        float averageMs = 0;
+        float maxMs = 0;
+        uint32_t samples = 0;
+    };
+
+    // CPU side cost of the last finished frame, from StartRender until its submission
+    struct FrameStats {
+        uint64_t frameNumber = 0;
+        float cpuMs = 0;
+        uint32_t drawCalls = 0;
+        uint32_t readbacks = 0;
+        // inside the damage with damage tracking, otherwise the whole image
+        uint32_t redrawnPixels = 0;
+    };
+
+    // Intervals of recent frames. `gpu` comes from timestamp queries and stays
+    // empty if the graphics queue doesn't support them
+    struct FramePacing {
+        FrameHistogram frame;   // StartRender to StartRender
+        FrameHistogram cpu;     // StartRender until the frame is submitted
+        FrameHistogram gpu;     // execution of the frame's command buffer
+        FrameHistogram present; // between presents
+    };
+
+    Renderer();
     ~Renderer();
 
+    // takes effect from the next render scope, i.e. the next frame, render target or graph pass
     void SetProject(int right, int left, int bottom, int top, int far, int near);
+    // View of the frame's scopes, null draws without one. The camera is read when a
+    // scope opens and by GetVisibleArea, so it can change every frame at no GPU cost.
+    // Render targets use their own projection and no camera
+    void SetCamera(Camera* camera);
+    Camera* GetCamera() const { return camera_; }
     void DrawTexture(const Rect&, Texture& texture);
+    void DrawTexture(const Rect&, float rotation, Texture& texture);
+    // draw the unit quad [-0.5, 0.5] transformed by `transform`
+    void DrawTexture(const Transform2D& transform, Texture& texture);
+    // `src` in texels of `texture`, e.g. a frame of a sprite sheet, drawn to `dst`
+    // rotated by `rotation` radians around `dst.position + origin`. The quad is built
+    // on the CPU and batched with the following sprites of the same texture like the shapes
+    void DrawTextureEx(Texture& texture, const Rect& src, const Rect& dst,
+                       float rotation = 0, const Vec& origin = Vec{0, 0}, Flip flip = Flip::None);
+    // a one pixel line, or a thick anti-aliased one if a line width is set
     void DrawLine(const Vec& p1, const Vec& p2);
+    // thick polylines get the line join between segments and the line cap at their ends
+    void DrawPolyline(const std::vector<Vec>& points, bool closed = false);
+    // width in pixels, 0 draws aliased one pixel lines with the line topology.
+    // Thick lines are instanced quads batched like the filled shapes
+    void SetLineWidth(float width);
+    void SetLineCap(LineCap);
+    // Each segment draws its half of a join, split at the bisector, so corners of
+    // translucent lines are blended once
+    void SetLineJoin(LineJoin);
+    // Filled shapes in the draw color. Consecutive shapes are batched into one
+    // draw until something else is drawn (in immediate mode), the layer or depth
+    // changes, or the render target changes
+    void FillRect(const Rect&);
+    void DrawRect(const Rect&, float thickness = 1);
+    // the segment count follows the radius on screen
+    void FillCircle(const Vec& center, float radius);
+    // convex or concave, points in either winding. Self intersecting polygons are skipped
+    void FillPolygon(const std::vector<Vec>& points);
+    // utf8 text in the draw color, `position` is its top-left and `size` the font size in pixels.
+    // Text of one font is batched into one draw like the shapes
+    void DrawString(Font& font, const std::string& utf8, const Vec& position, float size);
+    // one draw per chunk in view, tinted with the draw color
+    void DrawTilemap(Tilemap& map);
+    // the sprites of `scene` overlapping GetVisibleArea(), tinted with the draw color and
+    // batched like DrawTextureEx. The scene's stats tell how many were culled
+    void DrawSpriteScene(SpriteScene& scene);
+    // one draw per texture run of a baked batch, tinted with the draw color
+    void DrawStaticBatch(const StaticBatch& batch, const Transform2D& transform = Transform2D::CreateIdentity());
+    // step the simulation on the compute queue, once per frame, and draw the live
+    // particles with one indirect draw tinted with the draw color. The frame waits for the step
+    void DrawParticles(ParticleSystem& system);
+
+    // world space area covered by the current projection, position is its center
+    Rect GetVisibleArea() const;
     void SetDrawColor(const Color&);
 
-    void StartRender();
+    // takes effect from the next StartRender
+    void SetRecordMode(RecordMode);
+
+    // Damage tracking, for content that changes in small parts. The frame is drawn
+    // into a persistent offscreen copy where only the bounds of the damage are cleared
+    // and redrawn, scissored to it, then the copy goes to the swapchain image. With
+    // VK_KHR_incremental_present only the damage is presented. Everything is redrawn
+    // on the first frame, after a resize and when the projection or camera changed.
+    // Takes effect from the next StartRender
+    void SetDamageTracking(bool enable);
+    bool IsDamageTracking() const { return pendingDamageTracking_; }
+    // `area` changed since the last frame, in world space like the draws. Call it
+    // before anything is drawn to the swapchain image in this frame
+    void AddDamage(const Rect& area);
+    // redraw everything in the next frame
+    void DamageAll();
+    // layer is the most significant part of the sort key, lower layers are drawn first
+    void SetLayer(uint8_t layer);
+    // Deferred mode sorts the draws of a layer by pipeline and texture, so only the
+    // order across layers is kept and overlapping blended draws of different textures
+    // may swap. Draws of an ordered layer keep their submission order, sorted only
+    // by depth, at the cost of more state changes
+    void SetLayerOrdered(uint8_t layer, bool ordered);
+    // depth in [0, 1], lower depth is drawn first inside a layer and pipeline/texture group
+    void SetDepth(float depth);
+    // record deferred draw lists on `count` threads into secondary command buffers,
+    // 1 records everything on the calling thread
+    void SetRecordThreads(uint32_t count);
+    // statistics of the last finished frame
+    const DrawListStats& GetDrawListStats() const { return drawListStats_; }
+    const FrameStats& GetFrameStats() const { return frameStats_; }
+    const FramePacing& GetFramePacing() const { return framePacing_; }
+
+    // sleep in StartRender so frames don't start more often than `fps`, 0 disables it
+    void SetTargetFrameRate(float fps);
+
+    // call when an input event arrives, only the earliest one per frame is tracked
+    void MarkInput();
+    const LatencyStats& GetLatencyStats() const { return latencyStats_; }
+
+    // the swapchain is recreated at the next StartRender, without waiting for the GPU.
+    // Out of date and suboptimal swapchains are recreated automatically as well
+    void RequestSwapchainRecreate(int windowWidth, int windowHeight);
+
+    // Returns false if there is nothing to render to, e.g. the window is minimized.
+    // It sleeps a bit then, skip the frame's draws and EndRender
+    bool StartRender();
+    // run the passes of `graph`, compiling it first if needed. Must be called
+    // before anything else is drawn to the swapchain image in this frame.
+    void ExecuteGraph(RenderGraph& graph);
+    // Draws until EndTarget go to `target`, with its projection. Like ExecuteGraph
+    // this must happen before anything is drawn to the swapchain image in this frame.
+    // The target is cleared if `clear` is set or it was never rendered
+    void BeginTarget(RenderTarget& target, bool clear = true);
+    void EndTarget();
     void EndRender();
 
+    // Copy the swapchain image of the current frame once it is rendered. Nothing
+    // waits for the GPU: `callback` runs from a later StartRender after the frame
+    // finished. Can be called any time between StartRender and EndRender, it's
+    // ignored if StartRender returned false
+    void RequestReadback(ReadbackCallback callback, const ReadbackRegion& region = {});
+    // tightly packed pixels, the future is ready after a later StartRender
+    std::future<std::vector<uint8_t>> RequestReadback(const ReadbackRegion& region = {});
+    // copy an output image of `graph`, which must have been executed in this frame
+    void RequestReadback(RenderGraph& graph, RenderGraph::ResourceID id,
+                         ReadbackCallback callback, const ReadbackRegion& region = {});
+
 private:
-    int maxFlightCount_;
-    int curFrame_;
+    using Clock = std::chrono::steady_clock;
+
+    // A frame executes a secondary of every thread per deferred scope. The primary
+    // still references the secondaries of earlier scopes, so each flush takes
+    // unused ones, they are recycled when the frame's pool is reset
+    struct SecondaryRecorder {
+        std::unique_ptr<CommandManager> cmdMgr;
+        std::vector<vk::CommandBuffer> cmds;
+        size_t used = 0;
+
+        vk::CommandBuffer Next();
+    };
+
+    struct FrameData {
+        uint64_t timelineValue = 0; // graphics timeline value signaled when the frame finished
+        uint32_t firstQuery = 0;    // begin and end timestamps in the query pool
+        bool timestamped = false;
+        vk::Semaphore imageAvaliableSem;
+        vk::Semaphore renderFinishSem;
+        vk::CommandBuffer cmdBuf;
+        std::unique_ptr<StreamBuffer> vertexStream;
+        // project and view matrices of each render scope, bound with a dynamic offset
+        std::unique_ptr<Buffer> uniformBuffer;
+        uint32_t uniformSlots = 0;
+        DescriptorSetManager::SetInfo descriptorSet;
+        std::vector<SecondaryRecorder> recorders;
+        std::optional<Clock::time_point> input;
+    };
+
+    FrameRing<FrameData> frames_;
     uint32_t imageIndex_;
-    std::vector<vk::Fence> fences_;
-    std::vector<vk::Semaphore> imageAvaliableSems_;
-    std::vector<vk::Semaphore> renderFinishSems_;
-    std::vector<vk::CommandBuffer> cmdBufs_;
     std::unique_ptr<Buffer> rectVerticesBuffer_;
     std::unique_ptr<Buffer> rectIndicesBuffer_;
-    std::unique_ptr<Buffer> lineVerticesBuffer_;
     Mat4 projectMat_;
-    Mat4 viewMat_;
-    std::vector<std::unique_ptr<Buffer>> uniformBuffers_;
-    std::vector<std::unique_ptr<Buffer>> deviceUniformBuffers_;
-    std::vector<DescriptorSetManager::SetInfo> descriptorSets_;
+    Camera* camera_ = nullptr;
     vk::Sampler sampler;
     Texture* whiteTexture;
     Color drawColor_ = {1, 1, 1};
 
-    void createFences();
-    void createSemaphores();
-    void createCmdBuffers();
+    RecordMode recordMode_ = RecordMode::Immediate;
+    RecordMode pendingRecordMode_ = RecordMode::Immediate;
+    uint8_t layer_ = 0;
+    float depth_ = 0;
+    std::bitset<256> orderedLayers_;
+    uint32_t drawSequence_ = 0; // submission order of the scope's draws in ordered layers
+    DrawList drawList_;
+    DrawListStats drawListStats_;
+    std::vector<Vertex> shapeVertices_;
+    std::vector<LineInstance> lineInstances_;
+    std::vector<Vertex> textVertices_;
+    Font* textFont_ = nullptr;
+    std::vector<Vertex> spriteVertices_;
+    Texture* spriteTexture_ = nullptr;
+    std::vector<Tilemap::ChunkDraw> visibleChunks_;
+    std::vector<const SpriteScene::Sprite*> visibleSprites_;
+    float lineWidth_ = 0;
+    LineCap lineCap_ = LineCap::Butt;
+    LineJoin lineJoin_ = LineJoin::Round;
+    FrameStats frameStats_;
+    Clock::time_point frameStart_;
+    bool frameActive_ = false;
+    uint64_t computeWait_ = 0; // compute timeline value the frame must wait for
+
+    FramePacing framePacing_;
+    std::optional<Clock::time_point> lastFrameStart_;
+    std::optional<Clock::time_point> lastPresent_;
+    Clock::duration targetFrameInterval_ = Clock::duration::zero();
+    Clock::time_point nextFrameTime_;
+    vk::QueryPool timestampPool_ = nullptr;
+    float timestampPeriod_ = 0; // nanoseconds per tick
+    uint64_t timestampMask_ = 0;
+
+    // how long StartRender sleeps while the surface has no area
+    static constexpr std::chrono::milliseconds HiddenSleep{50};
+    bool surfaceHidden_ = false;
+
+    enum PipelineID: uint8_t {
+        TrianglePipeline = 0,
+        LinePipeline,
+        ThickLinePipeline,
+        TextPipeline,
+        ParticlePipeline,
+    };
+
+    enum BatchType {
+        ShapeBatch,
+        LineBatch,
+        TextBatch,
+        SpriteBatch,
+    };
+
+    struct BoundState {
+        vk::Pipeline pipeline;
+        vk::DescriptorSet textureSet;
+        vk::Buffer vertexBuffer;
+        vk::Buffer indexBuffer;
+        uint32_t drawCount = 0;
+        uint32_t stateChanges = 0;
+    } boundState_;
+
+    // each worker records a contiguous chunk of the sorted draw list
+    static constexpr size_t MinDrawsPerRecordThread = 512;
+    struct RenderScope {
+        vk::RenderPass renderPass;
+        vk::Framebuffer framebuffer;
+        vk::Extent2D extent;
+        vk::ClearColorValue clearColor;
+        bool backbuffer;
+        const char* name; // debug label
+        const Mat4* project = nullptr; // null uses the renderer's matrices
+        uint32_t uniformOffset = 0;
+        bool partial = false; // only the damage is cleared and drawn, the rest is loaded
+    };
+    RenderScope scope_;
+    bool scopeOpen_ = false;
+    RenderTarget* target_ = nullptr;
+    // render scopes per frame, each takes a slice of the frame's uniform buffer
+    static constexpr uint32_t MaxScopesPerFrame = 64;
+    vk::DeviceSize uniformStride_;
+    bool backbufferUsed_ = false;
+    uint32_t unsortedStateChanges_ = 0;
+
+    // damage tracking draws the backbuffer scopes into the canvas
+    bool damageTracking_ = false;
+    bool pendingDamageTracking_ = false;
+    std::unique_ptr<RenderTarget> canvas_;
+    vk::Rect2D damage_;  // in pixels, bounds of the frame's damage
+    bool fullDamage_ = true;
+    Mat4 canvasProject_; // matrices the canvas was last drawn with
+    Mat4 canvasView_;
+
+    // old swapchains are destroyed once every frame that used them has finished
+    struct RetiredSwapchain {
+        std::unique_ptr<Swapchain> swapchain;
+        uint64_t retireFrame;
+    };
+    std::vector<RetiredSwapchain> retiredSwapchains_;
+    bool swapchainDirty_ = false;
+    int windowWidth_;
+    int windowHeight_;
+
+    std::optional<Clock::time_point> pendingInput_;
+    LatencyStats latencyStats_;
+
+    uint32_t recordThreads_ = 1;
+    std::unique_ptr<ThreadPool> threadPool_;
+
+    struct ReadbackRequest {
+        vk::Image image; // null for the swapchain image
+        vk::ImageLayout layout;
+        vk::PipelineStageFlags stages;
+        vk::AccessFlags access;
+        ReadbackRegion region;
+        ReadbackCallback callback;
+    };
+    std::vector<ReadbackRequest> readbackRequests_;
+    ReadbackRing readbacks_;
+
+    FrameData createFrame(uint32_t index);
+    void resetFrame(FrameData&);
+    void destroyFrame(FrameData&);
+    FrameData& frame() { return frames_[FrameClock::Index()]; }
+    void createRecorders(FrameData&);
     void createBuffers();
-    void createUniformBuffers(int flightCount);
 
     void bufferRectData();
     void bufferRectVertexData();
     void bufferRectIndicesData();
 
-    void bufferLineData(const Vec& p1, const Vec& p2);
+    bool keepsOrder() const;
+    uint64_t drawKey(PipelineID, uint32_t texture);
+    void submitDraw(const DrawCmd&);
+    void pushDraw(const DrawCmd&);
+    bool beginBatch(BatchType);
+    void flushBatches();
+    void flushShapes();
+    void flushLines();
+    void flushText();
+    void flushSprites();
+    void pushSprite(Texture&, const Rect& dst, float rotation, const Vec& origin,
+                    const Vec& uv0, const Vec& uv1, const Color&);
+    float pixelsPerUnit() const;
+    void recordDraw(vk::CommandBuffer, const DrawCmd&, BoundState&);
+    void flushDrawList(vk::CommandBuffer);
+    void recordDrawListParallel(vk::CommandBuffer, uint32_t chunkCount);
+    void beginRenderPass(vk::CommandBuffer, vk::SubpassContents);
+    void setViewportAndScissor(vk::CommandBuffer);
+    void clearDamage(vk::CommandBuffer);
+    void prepareCanvas();
+    void copyCanvas(vk::CommandBuffer);
+    RenderScope backbufferScope() const;
+    void openScope(const RenderScope&);
+    void closeScope();
+    void pollLatency(FrameData&, bool signaled);
+    bool acquireNextImage();
+    bool surfaceHidden();
+    void limitFrameRate();
+    void createTimestampPool();
+    void readGpuTime(FrameData&);
+    void recreateSwapchain();
+    void releaseRetiredSwapchains();
+    ReadbackRegion clampRegion(const ReadbackRegion&, vk::Extent2D) const;
+    void recordReadbacks(vk::CommandBuffer);
 
-    void bufferMVPData();
+    uint32_t pushMatrices(const Mat4& project, const Mat4& view);
     void initMats();
-    void updateDescriptorSets();
-    void transformBuffer2Device(Buffer& src, Buffer& dst, size_t srcOffset, size_t dstOffset, size_t size);
+    Mat4 viewMatrix() const;
+    Transform2D worldToNdc() const;
+    void updateDescriptorSet(FrameData&);
     void createWhiteTexture();
 
     std::uint32_t queryBufferMemTypeIndex(std::uint32_t, vk::MemoryPropertyFlags);
@@ -7,6 +7,12 @@ namespace toy2d {
 
 class Shader {
 public:
+    // push constant layout, must match shader.vert, shader.frag, line.vert, line.frag and particle.*
+    static constexpr uint32_t ModelPushConstantOffset = 0;
+    // framebuffer size in pixels, only read by line.vert
+    static constexpr uint32_t ViewportPushConstantOffset = 24;
+    static constexpr uint32_t ColorPushConstantOffset = 32;
+
     Shader(const std::vector<char>& vertexSource, const std::vector<char>& fragSource);
     ~Shader();
 
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "toy2d/math.hpp"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace toy2d {
+
+class Texture;
+
+// Sprites binned into a uniform grid of square cells. Renderer::DrawSpriteScene
+// only visits the cells overlapping the visible area, so the cost of a frame
+// follows what is on screen rather than the size of the world. Moving a sprite
+// within its cells is O(1), otherwise only the cells it leaves and enters change.
+class SpriteScene final {
+public:
+    using SpriteID = uint32_t;
+
+    struct Sprite {
+        Texture* texture;
+        Rect rect;      // world space, position is the center
+        float rotation; // radians around the center
+        Color color;    // multiplied with the draw color
+    };
+
+    // of the last CollectVisible
+    struct Stats {
+        uint32_t drawn = 0;
+        uint32_t culled = 0;
+        uint32_t cellsVisited = 0;
+    };
+
+    // `cellSize` in world units, a few times the typical sprite size works well
+    explicit SpriteScene(float cellSize = 256);
+
+    SpriteScene(const SpriteScene&) = delete;
+    SpriteScene& operator=(const SpriteScene&) = delete;
+
+    // ids of removed sprites are reused
+    SpriteID Add(Texture& texture, const Rect& rect, float rotation = 0, const Color& color = Color{1, 1, 1});
+    void Remove(SpriteID);
+    void Clear();
+
+    void SetRect(SpriteID, const Rect&);
+    void SetPosition(SpriteID, const Vec&);
+    void SetRotation(SpriteID, float radians);
+    void SetColor(SpriteID id, const Color& color) { sprites_[id].sprite.color = color; }
+    void SetTexture(SpriteID id, Texture& texture) { sprites_[id].sprite.texture = &texture; }
+    const Sprite& Get(SpriteID id) const { return sprites_[id].sprite; }
+
+    uint32_t GetCount() const { return count_; }
+    float GetCellSize() const { return cellSize_; }
+
+    // sprites whose bounds overlap `area` (world space, position is the center),
+    // in ascending id order so overlapping sprites keep a stable order
+    void CollectVisible(const Rect& area, std::vector<const Sprite*>& out);
+    const Stats& GetStats() const { return stats_; }
+
+private:
+    // inclusive range of cells covered by a sprite's bounds
+    struct CellRange {
+        int32_t x0, y0, x1, y1;
+        bool operator==(const CellRange& o) const {
+            return x0 == o.x0 && y0 == o.y0 && x1 == o.x1 && y1 == o.y1;
+        }
+    };
+
+    struct Entry {
+        Sprite sprite;
+        CellRange cells;
+        Rect bounds;        // axis aligned bounds of the rotated rect
+        uint32_t stamp = 0; // last query that collected it, a sprite spanning cells is listed once
+        bool alive = false;
+    };
+
+    float cellSize_;
+    std::vector<Entry> sprites_;
+    std::vector<SpriteID> freeIDs_;
+    std::unordered_map<uint64_t, std::vector<SpriteID>> cells_;
+    uint32_t count_ = 0;
+    uint32_t stamp_ = 0;
+    Stats stats_;
+    std::vector<SpriteID> visible_;
+
+    static uint64_t cellKey(int32_t x, int32_t y) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+    }
+    int32_t toCell(float value) const;
+    void updateBounds(Entry&);
+    void insert(SpriteID, const CellRange&);
+    void erase(SpriteID, const CellRange&);
+};
+
+}
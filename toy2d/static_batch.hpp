@@ -0,0 +1,79 @@
+#pragma once
+
+#include "toy2d/math.hpp"
+#include <memory>
+#include <vector>
+
+namespace toy2d {
+
+class Texture;
+class Renderer;
+struct Buffer;
+
+// Geometry built once and baked into device local buffers together with its
+// list of draws, for backgrounds and UI chrome that don't change. Drawing it with
+// Renderer::DrawStaticBatch costs one draw per texture run and no vertex work.
+// Items keep the order they were added in, the whole batch sorts as one draw
+// with the layer and depth current when it is drawn.
+class StaticBatch final {
+public:
+    friend class Renderer;
+
+    StaticBatch() = default;
+    ~StaticBatch();
+
+    StaticBatch(const StaticBatch&) = delete;
+    StaticBatch& operator=(const StaticBatch&) = delete;
+
+    // state for the items added after it, like the renderer's
+    void SetColor(const Color& color) { color_ = color; }
+    void SetLineWidth(float width) { lineWidth_ = width; }
+    void SetLineCap(LineCap cap) { lineCap_ = cap; }
+    void SetLineJoin(LineJoin join) { lineJoin_ = join; }
+
+    void AddTexture(const Rect&, Texture&);
+    void AddTexture(const Transform2D&, Texture&);
+    void FillRect(const Rect&);
+    void DrawRect(const Rect&, float thickness = 1);
+    // segments are chosen for a scale of one world unit per pixel
+    void FillCircle(const Vec& center, float radius);
+    void FillPolygon(const std::vector<Vec>& points);
+    // anti-aliased lines, SetLineWidth is in pixels
+    void AddLine(const Vec& p1, const Vec& p2);
+    void AddPolyline(const std::vector<Vec>& points, bool closed = false);
+
+    // upload everything added so far, the host copy is dropped. Nothing can be added afterwards
+    void Bake();
+    bool IsBaked() const { return baked_; }
+    // drop the geometry and the buffers, the batch can be built again
+    void Clear();
+
+private:
+    struct Range {
+        Texture* texture; // null for the renderer's white texture
+        bool lines;
+        uint32_t first;   // first index, or first instance for lines
+        uint32_t count;   // index count, or instance count for lines
+    };
+
+    Color color_ = {1, 1, 1};
+    float lineWidth_ = 1;
+    LineCap lineCap_ = LineCap::Butt;
+    LineJoin lineJoin_ = LineJoin::Round;
+
+    std::vector<Vertex> vertices_;
+    std::vector<uint32_t> indices_;
+    std::vector<LineInstance> lines_;
+    std::vector<Range> ranges_;
+
+    bool baked_ = false;
+    std::unique_ptr<Buffer> vertexBuffer_;
+    std::unique_ptr<Buffer> indexBuffer_;
+    std::unique_ptr<Buffer> lineBuffer_;
+
+    void addRange(Texture* texture, bool lines, uint32_t count);
+    void addTriangles(size_t firstVertex);
+    void checkNotBaked() const;
+};
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "toy2d/buffer.hpp"
+#include <vector>
+#include <memory>
+
+namespace toy2d {
+
+// host visible linear allocator for per-frame transient data, grows by chunks
+class StreamBuffer final {
+public:
+    struct Allocation {
+        vk::Buffer buffer;
+        vk::DeviceSize offset;
+        void* map;
+    };
+
+    StreamBuffer(vk::BufferUsageFlags usage, size_t chunkSize);
+
+    Allocation Alloc(size_t size, size_t alignment = 4);
+    void Reset();
+
+private:
+    vk::BufferUsageFlags usage_;
+    size_t chunkSize_;
+    std::vector<std::unique_ptr<Buffer>> chunks_;
+    size_t curChunk_ = 0;
+    size_t offset_ = 0;
+
+    void addChunk(size_t size);
+};
+
+}
@@ -11,15 +11,22 @@ public:
         vk::ImageView view;
     };
 
-    vk::SurfaceKHR surface = nullptr;
+    vk::SurfaceKHR surface = nullptr; // owned by Context
     vk::SwapchainKHR swapchain = nullptr;
     std::vector<Image> images;
     std::vector<vk::Framebuffer> framebuffers;
 
     const auto& GetExtent() const { return surfaceInfo_.extent; }
     const auto& GetFormat() const { return surfaceInfo_.format; }
-
-    Swapchain(vk::SurfaceKHR, int windowWidth, int windowHeight);
+    vk::PresentModeKHR GetPresentMode() const { return surfaceInfo_.presentMode; }
+    std::uint32_t GetImageCount() const { return static_cast<std::uint32_t>(images.size()); }
+    // images can be copied from, needed to read back rendered frames
+    bool SupportsReadback() const { return static_cast<bool>(surfaceInfo_.usage & vk::ImageUsageFlagBits::eTransferSrc); }
+    // images can be copied to, needed by the renderer's damage tracking
+    bool SupportsCopyTo() const { return static_cast<bool>(surfaceInfo_.usage & vk::ImageUsageFlagBits::eTransferDst); }
+
+    // `oldSwapchain` is retired by the new one but must be destroyed by the caller
+    Swapchain(vk::SurfaceKHR, int windowWidth, int windowHeight, vk::SwapchainKHR oldSwapchain = nullptr);
     ~Swapchain();
 
     void InitFramebuffers();
@@ -30,12 +37,15 @@ private:
         vk::Extent2D extent;
         std::uint32_t count;
         vk::SurfaceTransformFlagBitsKHR transform;
+        vk::PresentModeKHR presentMode;
+        vk::ImageUsageFlags usage;
     } surfaceInfo_;
 
-    vk::SwapchainKHR createSwapchain();
+    vk::SwapchainKHR createSwapchain(vk::SwapchainKHR oldSwapchain);
 
     void querySurfaceInfo(int windowWidth, int windowHeight);
     vk::SurfaceFormatKHR querySurfaceeFormat();
+    vk::PresentModeKHR queryPresentMode();
     vk::Extent2D querySurfaceExtent(const vk::SurfaceCapabilitiesKHR& capability, int windowWidth, int windowHeight);
     void createImageAndViews();
     void createFramebuffers();
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "toy2d/math.hpp"
+#include <vector>
+
+namespace toy2d {
+
+// Shape tessellation into triangle lists, three vertices per triangle appended
+// to `out`. Every triangle gets the winding of the renderer's unit quad, so the
+// result survives its back face culling whatever order the input points are in.
+
+// segments for a circle of `radius` pixels whose edges stay within `tolerance` pixels of the real circle
+uint32_t CircleSegmentCount(float radius, float tolerance = 0.25f);
+
+// `rect.position` is the center, as in Renderer::DrawTexture
+void TessellateRect(const Rect& rect, const Color& color, std::vector<Vertex>& out);
+// outline inside `rect`
+void TessellateRectOutline(const Rect& rect, float thickness, const Color& color, std::vector<Vertex>& out);
+void TessellateCircle(const Vec& center, float radius, uint32_t segments, const Color& color, std::vector<Vertex>& out);
+
+// `dst` rotated by `rotation` radians around `dst.position + origin`, textured
+// from `uv0` at its top-left corner to `uv1` at its bottom-right corner. Two triangles
+void TessellateSprite(const Rect& dst, float rotation, const Vec& origin,
+                      const Vec& uv0, const Vec& uv1, const Color& color, std::vector<Vertex>& out);
+
+// one instance per segment, `cap` at the ends of an open polyline and `join` between segments
+void TessellatePolyline(const std::vector<Vec>& points, bool closed, const Color& color, float width,
+                        LineCap cap, LineJoin join, std::vector<LineInstance>& out);
+
+bool IsConvexPolygon(const std::vector<Vec>& points);
+// Simple polygon in either winding. Convex ones become a fan, concave ones are
+// ear clipped. Returns false and appends nothing if it can't be triangulated,
+// e.g. it intersects itself
+bool TessellatePolygon(const std::vector<Vec>& points, const Color& color, std::vector<Vertex>& out);
+
+}
@@ -9,29 +9,38 @@
 namespace toy2d {
 
 class TextureManager;
+class RenderGraph;
 
 class Texture final {
 public:
     friend class TextureManager;
+    friend class RenderGraph;
+    friend class RenderTarget;
     ~Texture();
 
     vk::Image image;
     vk::DeviceMemory memory;
     vk::ImageView view;
     DescriptorSetManager::SetInfo set;
+    uint32_t id; // unique per texture, used to sort draws
+    uint32_t width;
+    uint32_t height;
 
 private:
+    bool ownImage_ = true;
+    vk::Format format_ = vk::Format::eR8G8B8A8Srgb;
+
     Texture(std::string_view filename);
 
-    Texture(void* data, uint32_t w, uint32_t h);
+    Texture(void* data, uint32_t w, uint32_t h, vk::Format format);
+
+    // wrap an image view owned by someone else, it must be in ShaderReadOnlyOptimal when sampled
+    Texture(vk::ImageView view, uint32_t w, uint32_t h);
 
     void createImage(uint32_t w, uint32_t h);
     void createImageView();
     void allocMemory();
     uint32_t queryImageMemoryIndex();
-    void transitionImageLayoutFromUndefine2Dst();
-    void transitionImageLayoutFromDst2Optimal();
-    void transformData2Image(Buffer&, uint32_t w, uint32_t h);
     void updateDescriptorSet();
 
     void init(void* data, uint32_t w, uint32_t h);
@@ -48,8 +57,8 @@ public:
 
     Texture* Load(const std::string& filename);
 
-    // data must be a RGBA8888 format data
-    Texture* Create(void* data, uint32_t w, uint32_t h);
+    // data must be tightly packed pixels of `format`, R8G8B8A8 or R8 formats are supported
+    Texture* Create(void* data, uint32_t w, uint32_t h, vk::Format format = vk::Format::eR8G8B8A8Srgb);
     void Destroy(Texture*);
     void Clear();
 
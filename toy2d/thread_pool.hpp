@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace toy2d {
+
+class ThreadPool final {
+public:
+    // the calling thread takes part in the work, so `threadCount - 1` workers are spawned
+    explicit ThreadPool(uint32_t threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    uint32_t Size() const { return static_cast<uint32_t>(workers_.size()) + 1; }
+
+    // run func(i) for every i in [0, count), returns when all of them finished
+    void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+private:
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable taskCv_;
+    std::condition_variable doneCv_;
+
+    const std::function<void(uint32_t)>* task_ = nullptr;
+    uint32_t taskCount_ = 0;
+    uint32_t nextTask_ = 0;
+    uint32_t finishedTask_ = 0;
+    uint64_t generation_ = 0;
+    bool quit_ = false;
+
+    void workerLoop();
+    void runTasks(std::unique_lock<std::mutex>&);
+};
+
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "vulkan/vulkan.hpp"
+#include "toy2d/math.hpp"
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace toy2d {
+
+class Texture;
+struct Buffer;
+
+// Grid of tiles cut from one tileset texture. The tiles are split into chunks of
+// ChunkSize x ChunkSize whose vertices live in fixed-size slots of a few large
+// device local buffers, so a static map costs no uploads and one draw per visible
+// chunk. Changing a tile only rebuilds its chunk, the next time that chunk is visible.
+class Tilemap final {
+public:
+    static constexpr uint32_t ChunkSize = 32;
+    static constexpr uint32_t EmptyTile = std::numeric_limits<uint32_t>::max();
+    // a full chunk, two triangles per tile
+    static constexpr uint32_t ChunkVertices = ChunkSize * ChunkSize * 6;
+
+    struct ChunkDraw {
+        vk::Buffer buffer;
+        uint32_t firstVertex;
+        uint32_t vertexCount;
+    };
+
+    // `tileset` is a grid of `columns` x `rows` tiles, tile ids count row by row from its top-left.
+    // Every tile starts empty
+    Tilemap(Texture& tileset, uint32_t columns, uint32_t rows,
+            uint32_t width, uint32_t height, const Size& tileSize);
+    ~Tilemap();
+
+    Tilemap(const Tilemap&) = delete;
+    Tilemap& operator=(const Tilemap&) = delete;
+
+    void SetTile(uint32_t x, uint32_t y, uint32_t tile);
+    uint32_t GetTile(uint32_t x, uint32_t y) const { return tiles_[y * width_ + x]; }
+    void Fill(uint32_t tile);
+
+    uint32_t GetWidth() const { return width_; }
+    uint32_t GetHeight() const { return height_; }
+    const Size& GetTileSize() const { return tileSize_; }
+    Texture& GetTileset() const { return tileset_; }
+
+    // chunks with tiles overlapping `area` (world space, position is the center),
+    // changed chunks among them are uploaded first
+    void CollectVisible(const Rect& area, std::vector<ChunkDraw>& out);
+
+    // world position of the map's top-left corner
+    Vec position = Vec{0, 0};
+
+private:
+    static constexpr uint32_t SlotsPerBlock = 16;
+    static constexpr uint32_t NoSlot = std::numeric_limits<uint32_t>::max();
+
+    struct Chunk {
+        uint32_t slot = NoSlot;
+        uint32_t vertexCount = 0;
+        bool dirty = true;
+    };
+
+    Texture& tileset_;
+    uint32_t columns_;
+    uint32_t rows_;
+    uint32_t width_;
+    uint32_t height_;
+    Size tileSize_;
+    std::vector<uint32_t> tiles_;
+
+    uint32_t chunksX_;
+    uint32_t chunksY_;
+    std::vector<Chunk> chunks_;
+
+    // SlotsPerBlock chunk slots each, slot i lives in block i / SlotsPerBlock
+    std::vector<std::unique_ptr<Buffer>> blocks_;
+    // shared with the deferred releases, which may run after the map is gone
+    std::shared_ptr<std::vector<uint32_t>> freeSlots_;
+
+    Chunk& chunkOf(uint32_t x, uint32_t y) { return chunks_[(y / ChunkSize) * chunksX_ + x / ChunkSize]; }
+    void rebuild(uint32_t chunkX, uint32_t chunkY, Chunk&);
+    void release(Chunk&);
+    uint32_t allocateSlot();
+};
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "vulkan/vulkan.hpp"
+#include <functional>
+#include <vector>
+
+namespace toy2d {
+
+// Monotonic progress counter of one queue, backed by a timeline semaphore.
+// Every submission through Submit() signals the next value, so "is this work
+// done" becomes "has the timeline reached N", which can be checked without
+// blocking and waited on without idling the whole device.
+class Timeline final {
+public:
+    struct Wait {
+        vk::Semaphore semaphore;
+        uint64_t value; // ignored for binary semaphores
+        vk::PipelineStageFlags stages;
+    };
+
+    explicit Timeline(vk::Queue queue);
+    ~Timeline();
+
+    Timeline(const Timeline&) = delete;
+    Timeline& operator=(const Timeline&) = delete;
+
+    // submit and signal the next value, which is returned
+    uint64_t Submit(const std::vector<vk::CommandBuffer>& cmds,
+                    const std::vector<Wait>& waits = {},
+                    const std::vector<vk::Semaphore>& binarySignals = {});
+
+    // last value handed out by Submit()
+    uint64_t Pending() const { return pending_; }
+    // last value the GPU reached
+    uint64_t Completed();
+    bool IsCompleted(uint64_t value);
+    void WaitFor(uint64_t value);
+    void WaitIdle() { WaitFor(pending_); }
+
+    // run `func` once the timeline reached `value`, from Collect()
+    void Defer(uint64_t value, std::function<void()> func);
+    void Collect();
+
+    vk::Queue GetQueue() const { return queue_; }
+
+    vk::Semaphore semaphore;
+
+private:
+    struct Deferred {
+        uint64_t value;
+        std::function<void()> func;
+    };
+
+    vk::Queue queue_;
+    uint64_t pending_ = 0;
+    uint64_t completed_ = 0;
+    std::vector<Deferred> deferred_;
+};
+
+}
@@ -8,7 +8,7 @@
 
 namespace toy2d {
 
-void Init(std::vector<const char*>& extensions, Context::GetSurfaceCallback, int windowWidth, int windowHeight);
+void Init(std::vector<const char*>& extensions, Context::GetSurfaceCallback, int windowWidth, int windowHeight, const Config& config = Config{});
 void Quit();
 Texture* LoadTexture(const std::string& filename);
 void DestroyTexture(Texture*);
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "toy2d/font.hpp"
+#include <string>
+#include <vector>
+
+namespace toy2d {
+
+// Built-in glyph source for Font: reads a TrueType (.ttf/.ttc) file and rasterizes
+// its quadratic glyf outlines with exact area coverage, in the spirit of stb_truetype.
+// Understands cmap formats 4 and 12 and composite glyphs; fonts with CFF outlines
+// (most .otf files) need a GlyphRasterizer of their own, e.g. FreeType.
+class TrueTypeFont final {
+public:
+    // throws std::runtime_error if the file can't be read or has no TrueType outlines
+    explicit TrueTypeFont(const std::string& filename);
+    explicit TrueTypeFont(std::vector<uint8_t> data);
+
+    // a GlyphRasterizer, false if the font has no glyph for `codepoint`
+    bool Rasterize(uint32_t codepoint, float pixelSize, GlyphBitmap& out) const;
+    // ascent, descent and line gap of the hhea table in ems
+    Font::Metrics GetMetrics() const;
+
+    uint32_t GlyphIndex(uint32_t codepoint) const;
+
+private:
+    struct Point {
+        float x, y;
+        bool onCurve;
+    };
+    using Contour = std::vector<Point>;
+
+    std::vector<uint8_t> data_;
+    uint32_t cmap_ = 0; // offset of the chosen cmap subtable
+    uint32_t loca_ = 0;
+    uint32_t glyf_ = 0;
+    uint32_t hmtx_ = 0;
+    uint16_t unitsPerEm_ = 0;
+    uint16_t numGlyphs_ = 0;
+    uint16_t numHMetrics_ = 0;
+    bool longLoca_ = false;
+    int16_t ascender_ = 0;
+    int16_t descender_ = 0;
+    int16_t lineGap_ = 0;
+
+    void parse();
+    uint32_t findTable(uint32_t fontOffset, const char* tag) const;
+    uint8_t u8(uint32_t offset) const;
+    uint16_t u16(uint32_t offset) const;
+    int16_t i16(uint32_t offset) const { return static_cast<int16_t>(u16(offset)); }
+    uint32_t u32(uint32_t offset) const;
+
+    float advance(uint32_t glyph) const;
+    void loadOutline(uint32_t glyph, std::vector<Contour>& out, int depth) const;
+};
+
+}
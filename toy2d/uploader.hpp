@@ -0,0 +1,100 @@
+#pragma once
+
+#include "vulkan/vulkan.hpp"
+#include <vector>
+#include <memory>
+#include <deque>
+
+namespace toy2d {
+
+struct Buffer;
+
+// Copies host data into device-local buffers and images on the transfer queue.
+// Uploads are recorded into one command buffer and submitted together by Flush(),
+// which the renderer calls before it submits a frame, so uploads overlap rendering
+// instead of stalling it. When the transfer queue belongs to another family the
+// resources are released there and acquired on the graphics queue in one batch.
+// The data is staged in a persistent ring, uploads larger than it get their own buffer.
+class Uploader final {
+public:
+    Uploader();
+    ~Uploader();
+
+    Uploader(const Uploader&) = delete;
+    Uploader& operator=(const Uploader&) = delete;
+
+    // `dst` must have been created with TransferDst usage
+    void UploadBuffer(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size);
+    // upload a whole single-mip color image in undefined layout, it ends in ShaderReadOnlyOptimal
+    void UploadImage(vk::Image dst, uint32_t width, uint32_t height, const void* data, vk::DeviceSize size);
+    // Overwrite `region` of an image already in ShaderReadOnlyOptimal that frames keep
+    // sampling, e.g. a glyph atlas. `data` holds the region's rows tightly packed. The copy
+    // runs on the graphics queue, after the frames submitted before Flush()
+    void UpdateImage(vk::Image dst, const vk::Rect2D& region, const void* data, vk::DeviceSize size);
+
+    // submit the recorded uploads and make graphics work submitted from now on see them
+    void Flush();
+
+    // true if transfers run on another queue than rendering
+    bool IsAsync() const { return separateQueue_; }
+
+private:
+    static constexpr vk::DeviceSize StagingSize = 16 * 1024 * 1024;
+    // satisfies the offset rules of buffer to image copies for every format
+    static constexpr vk::DeviceSize StagingAlignment = 16;
+
+    struct Staging {
+        vk::Buffer buffer;
+        vk::DeviceSize offset;
+    };
+
+    // bytes of the ring a flushed batch reads, freed in submission order once
+    // the transfer and graphics submissions reading them finished
+    struct Batch {
+        vk::DeviceSize bytes;
+        uint64_t transferValue;
+        uint64_t graphicsValue;
+        std::vector<std::unique_ptr<Buffer>> oversized;
+    };
+
+    struct Written {
+        vk::Buffer buffer;
+        vk::DeviceSize begin;
+        vk::DeviceSize end;
+    };
+
+    struct ImageUpdate {
+        vk::Image image;
+        vk::Rect2D region;
+        Staging staging;
+    };
+
+    bool ownershipTransfer_;
+    bool separateQueue_;
+    uint32_t transferFamily_;
+    uint32_t graphicsFamily_;
+
+    std::unique_ptr<Buffer> ring_;
+    vk::DeviceSize head_ = 0;
+    vk::DeviceSize used_ = 0;
+    vk::DeviceSize batchBytes_ = 0;
+    std::deque<Batch> batches_;
+    std::vector<std::unique_ptr<Buffer>> oversized_;
+
+    vk::CommandBuffer cmd_ = nullptr; // transfer commands recording since the last Flush()
+    std::vector<Written> written_;     // copy destinations of the batch
+    std::vector<vk::BufferMemoryBarrier> bufferReleases_;
+    std::vector<vk::ImageMemoryBarrier> imageReleases_;
+
+    std::vector<vk::BufferMemoryBarrier> bufferAcquires_;
+    std::vector<vk::ImageMemoryBarrier> imageAcquires_;
+    std::vector<ImageUpdate> imageUpdates_;
+
+    Staging stage(const void* data, vk::DeviceSize size);
+    void reclaim();
+    vk::CommandBuffer recording();
+    uint64_t submitTransfer();
+    void recordImageUpdates(vk::CommandBuffer);
+};
+
+}